@@ -4,12 +4,14 @@
  * All rights reserved
  */
 #include "BatteryManager.h"
+#include "LedManager.h"
 #include "IOPin.h"
 #include "Common.h"
 #include "Fingerprint.h"
 #include "BluetoothManager.h"
 
 extern Fingerprint fingerprint;
+extern LedManager ledManager;
 extern BluetoothManager bluetoothManager;
 /* VBAT */
 const float battery_min = 3.0; // (V) minimum voltage of battery before shutdown
@@ -38,7 +40,7 @@ void ARDUINO_ISR_ATTR adcComplete() {
 }
 
 BatteryManager::BatteryManager(int adcPin, int testPin) 
-  : adcPin(adcPin), testPin(testPin)
+  : adcPin(adcPin), testPin(testPin), lastCheckTime(0)
 {
    
 }
@@ -111,14 +113,29 @@ float BatteryManager::calculateBatteryPercent(float voltage) {
     return percent;
 }
 
+void BatteryManager::loop() {
+    if (millis() - lastCheckTime >= CHECK_INTERVAL_MS) {
+        updateLevel();
+    }
+}
+
 void BatteryManager::CheckBatteryLow(){
+    updateLevel();
+    warnIfLow();
+}
+
+void BatteryManager::updateLevel(){
+    lastCheckTime = millis();
     float batteryVoltage = readVoltage();
     batteryPercentage = calculateBatteryPercent(batteryVoltage);
     bluetoothManager.setBatteryLevel((uint8_t)batteryPercentage);
     Serial.printf("Battery Voltage: %.2f V, Percentage: %.2f%%\n", batteryVoltage, batteryPercentage);
+}
+
+void BatteryManager::warnIfLow(){
     // 如果电池电量低于阈值，发出警告
     if (batteryPercentage < 20.0) {
-      fingerprint.setLEDCmd(Fingerprint::LED_CODE_BLINK,0x04,0x11,0x00,12);  // 红色闪烁灯
+      ledManager.requestLedEffect(Fingerprint::LED_CODE_BLINK,0x04,0x11,0x00,12);  // 红色闪烁灯
       Serial.println(">>>Warning<<<: Battery level is low! Please charge the device.");
     }
   }
\ No newline at end of file
@@ -17,12 +17,20 @@ public:
     float readVoltage();
     float calculateBatteryPercent(float voltage);
     void CheckBatteryLow();
+    // 测量电量并更新蓝牙电量，不提示
+    void updateLevel();
+    // 按最近一次测量的电量提示低电量，不读 ADC，每次触摸后调用
+    void warnIfLow();
+    // 由主循环调用，按固定间隔测量电量
+    void loop();
 private:
     // 内部ADC读取方法
     uint32_t readADC();
 private:
     int adcPin;  // ADC引脚
     int testPin; // 测试引脚
+    uint32_t lastCheckTime; // 上次检查电量的时间
+    static const uint32_t CHECK_INTERVAL_MS = 60000; // 电量检查间隔
 };
 
 #endif
\ No newline at end of file
@@ -4,6 +4,7 @@
  * All rights reserved
  */
 #include "BluetoothHandle.h"
+#include "LedManager.h"
 #include "Fingerprint.h"
 #include "BluetoothManager.h"
 #include "ConfigManager.h"
@@ -12,12 +13,18 @@
 #include "Common.h"
 #include "BluetoothOTA.h"
 #include "SleepManager.h"
+#include "EnrollManager.h"
+#include "UnlockManager.h"
+#include "Log.h"
+#include <freertos/stream_buffer.h>
 
 extern Fingerprint fingerprint;
+extern LedManager ledManager;
 extern BluetoothManager bluetoothManager;
 extern ConfigManager configManager;
 extern VersionInfo versionInfo;
-extern bool bCancelRegister;
+extern EnrollManager enrollManager;
+extern UnlockManager unlockManager;
 extern SleepManager sleepManager;
 BluetoothOTA bluetoothOTA;
 
@@ -28,6 +35,242 @@ BluetoothOTA bluetoothOTA;
 // 全局队列句柄
 static QueueHandle_t bluetoothMsgQueue = NULL;
 
+// 模板导入和固件升级的数据块可能来自消息队列任务（逐块应答）或批量任务，
+// 下面的导入缓冲、出错标记和固件写入都在这个锁内访问
+static SemaphoreHandle_t transferMutex = NULL;
+
+// 模板导入缓冲，一次只缓存一个模板
+static uint8_t* templateImportBuffer = nullptr;
+static size_t templateImportLength = 0;
+static int templateImportId = -1;
+
+static void releaseTemplateImport() {
+    delete[] templateImportBuffer;
+    templateImportBuffer = nullptr;
+    templateImportLength = 0;
+    templateImportId = -1;
+}
+
+// 固件升级数据块写入出错后，批量通道中后续的数据块不再逐块报告
+static bool firmwareChunkFailed = false;
+
+// 模板导入数据块 [id, flags, data]；ackChunks 为 false（批量通道）时中间块不单独应答，由通道额度限速，
+// 最后一块和出错时仍然返回结果
+static void handleTemplateImport(const uint8_t* data, size_t length, bool ackChunks) {
+    if (length < 2) {
+        LOGW("[Task] Invalid template import data");
+        bluetoothManager.sendMessage(MSG_TEMPLATE_IMPORT, &MSG_CMD_FAILURE, 1);
+        return;
+    }
+    int id = data[0];
+    uint8_t flags = data[1];
+    length -= 2;
+
+    if (flags & TEMPLATE_FLAG_FIRST) {
+        if (templateImportBuffer == nullptr) {
+            templateImportBuffer = new uint8_t[TEMPLATE_MAX_SIZE];
+        }
+        templateImportLength = 0;
+        templateImportId = id;
+    }
+    if (templateImportBuffer == nullptr || id != templateImportId || id >= MAX_FINGERPRINT_NUM ||
+        templateImportLength + length > TEMPLATE_MAX_SIZE) {
+        LOGW("[Task] Template import out of sequence, id %d", id);
+        releaseTemplateImport();
+        bluetoothManager.sendMessage(MSG_TEMPLATE_IMPORT, &MSG_CMD_FAILURE, 1);
+        return;
+    }
+    memcpy(templateImportBuffer + templateImportLength, &data[2], length);
+    templateImportLength += length;
+    sleepManager.resetActivity();
+
+    if (!(flags & TEMPLATE_FLAG_LAST)) {
+        if (ackChunks) {
+            bluetoothManager.sendMessage(MSG_TEMPLATE_IMPORT, &MSG_CMD_SUCCESS, 1);
+        }
+        return;
+    }
+
+    // 模板接收完整，写入模组
+    bool success = fingerprint.downloadTemplate(id, templateImportBuffer, templateImportLength);
+    releaseTemplateImport();
+    if (success) {
+        String name;
+        if (!configManager.getFingerprintName(id, name)) {
+            String name_prefix = "指纹";
+            configManager.setFingerprintName(id, name_prefix + String(id + 1));
+        }
+        bluetoothManager.sendMessage(MSG_TEMPLATE_IMPORT, &MSG_CMD_SUCCESS, 1);
+    } else {
+        bluetoothManager.sendMessage(MSG_TEMPLATE_IMPORT, &MSG_CMD_FAILURE, 1);
+    }
+}
+
+// 固件升级数据块；ackChunks 为 false（批量通道）时只报告第一次出错
+static void handleFirmwareChunk(const uint8_t* data, size_t length, bool ackChunks) {
+    LOGD("[Task] Processing firmware update >CHUNK<");
+    if (!ackChunks && firmwareChunkFailed) {
+        return;
+    }
+    if (length < 1) {
+        LOGW("[Task] Invalid firmware update data");
+        firmwareChunkFailed = true;
+        bluetoothManager.sendMessage(MSG_FIRMWARE_UPDATE_CHUNK, &MSG_CMD_FAILURE, 1);
+        return;
+    }
+    // 固件更新数据写入
+    if (!bluetoothOTA.receiveData(data, length)) {
+        LOGW("[Task] Failed to write firmware chunk data");
+        firmwareChunkFailed = true;
+        bluetoothManager.sendMessage(MSG_FIRMWARE_UPDATE_CHUNK, &MSG_CMD_FAILURE, 1);
+        return;
+    }
+    LOGD("[Task] Write firmware chunk success");
+    if (ackChunks) {
+        bluetoothManager.sendMessage(MSG_FIRMWARE_UPDATE_CHUNK, &MSG_CMD_SUCCESS, 1);
+    }
+}
+
+// PackBits 压缩：控制字节 0~127 后跟 n+1 个原样字节，-1~-127 表示下一个字节重复 1-n 次
+// 每个数据包单独压缩，结果可以直接拼接；最坏情况每128个字节多一个控制字节
+static size_t packBits(const uint8_t* in, size_t length, uint8_t* out) {
+    size_t outLength = 0;
+    size_t i = 0;
+    while (i < length) {
+        size_t run = 1;
+        while (i + run < length && run < 128 && in[i + run] == in[i]) {
+            run++;
+        }
+        if (run >= 3) {
+            out[outLength++] = (uint8_t)(1 - (int)run);
+            out[outLength++] = in[i];
+            i += run;
+            continue;
+        }
+        // 原样字节，直到出现3个以上的重复字节或者满128个（2个重复字节单独编码反而更长）
+        size_t start = i;
+        while (i < length && i - start < 128 && !(i + 2 < length && in[i + 1] == in[i] && in[i + 2] == in[i])) {
+            i++;
+        }
+        out[outLength++] = (uint8_t)(i - start - 1);
+        memcpy(out + outLength, in + start, i - start);
+        outLength += i - start;
+    }
+    return outLength;
+}
+
+// 诊断图像上传：调度任务从模组串口逐包接收图像写入流缓冲区，本任务同时取出数据分块发送，
+// 两端并行，耗时取决于较慢的一端；缓冲区写满时接收端等待，模组继续发来的数据暂存在串口接收缓冲中
+static void handleImageUpload(uint8_t flags) {
+    uint32_t startTime = millis();
+    bool compress = flags & IMAGE_FLAG_RLE;
+    MsgImageResult response = {};
+    response.result = MSG_CMD_FAILURE;
+    response.flags = compress ? IMAGE_FLAG_RLE : 0;
+
+    StreamBufferHandle_t stream = xStreamBufferCreate(IMAGE_STREAM_BUFFER_SIZE, IMAGE_CHUNK_SIZE);
+    if (stream == NULL) {
+        LOGE("[Task] Failed to allocate image stream buffer");
+        bluetoothManager.sendMessage(MSG_IMAGE_UPLOAD, (uint8_t*)&response, sizeof(response));
+        return;
+    }
+
+    FingerprintImageResult image = {};
+    image.captureCode = CONFIRM_NO_RESPONSE;
+    image.featureCode = CONFIRM_NO_RESPONSE;
+    volatile bool cancelled = false;
+    FingerprintFuture future = fingerprint.scheduler().submit(FingerprintScheduler::PRIORITY_MANAGE, [&]() -> bool {
+        return fingerprint.uploadImage(IMAGE_WAIT_MS, image, [&](const uint8_t* data, uint16_t length, bool) {
+            uint8_t packed[FingerprintFrame::MAX_PAYLOAD_LENGTH + FingerprintFrame::MAX_PAYLOAD_LENGTH / 128 + 1];
+            if (cancelled) {
+                return false;
+            }
+            if (compress) {
+                length = packBits(data, length, packed);
+                data = packed;
+            }
+            return xStreamBufferSend(stream, data, length, pdMS_TO_TICKS(IMAGE_STALL_MS)) == length;
+        });
+    });
+
+    // 数据块：[序号, data]，序号用于检查丢块，最后以 MSG_IMAGE_UPLOAD 的结果结束
+    uint8_t chunk[1 + IMAGE_CHUNK_SIZE];
+    size_t chunkSize = min((size_t)IMAGE_CHUNK_SIZE, (size_t)bluetoothManager.maxPayload() - 4); // 填满一条通知
+    bool sent = future.valid();
+    while (future.valid()) {
+        // 先确认事务已结束再取数据，结束之后缓冲区中剩下的就是全部数据
+        bool finished = future.ready();
+        size_t n = xStreamBufferReceive(stream, chunk + 1, chunkSize, finished ? 0 : pdMS_TO_TICKS(100));
+        if (n == 0) {
+            if (finished) {
+                break;
+            }
+            continue;
+        }
+        sleepManager.resetActivity();
+        chunk[0] = (uint8_t)response.chunks++;
+        response.sentBytes += n;
+        if (sent && !bluetoothManager.sendMessage(MSG_IMAGE_DATA, chunk, 1 + n)) {
+            LOGW("[Task] Image chunk %u not sent, cancelling", chunk[0]);
+            sent = false;
+            cancelled = true; // 接收端在下一个数据包时中止，这里继续取完缓冲区
+        }
+    }
+    vStreamBufferDelete(stream);
+
+    response.result = sent && future.result() ? MSG_CMD_SUCCESS : MSG_CMD_FAILURE;
+    response.captureCode = image.captureCode;
+    response.featureCode = image.featureCode;
+    response.imageBytes = image.bytes;
+    response.captureMs = image.captureMs;
+    response.uploadMs = image.uploadMs;
+    response.totalMs = millis() - startTime;
+    LOGI("[Task] Image upload %s: capture %02X, feature %02X, %u bytes, %u sent in %u chunks, %u ms",
+         response.result == MSG_CMD_SUCCESS ? "OK" : "failed", response.captureCode, response.featureCode,
+         response.imageBytes, response.sentBytes, response.chunks, response.totalMs);
+    bluetoothManager.sendMessage(MSG_IMAGE_UPLOAD, (uint8_t*)&response, sizeof(response));
+}
+
+// 通知发送吞吐量测试：连续入队 count 条 size 字节的消息，等待全部发出后返回统计
+// 入队在队列满时等待，测得的是发送任务按拥塞和确认事件限速后的实际速度
+static void handleTxBenchmark(uint16_t count, uint8_t size) {
+    MsgTxBenchmark response = {};
+    response.result = MSG_CMD_FAILURE;
+    size = constrain(size, 2, BluetoothManager::TX_SLOT_SIZE - 3);
+    uint8_t payload[BluetoothManager::TX_SLOT_SIZE];
+    for (uint8_t i = 2; i < size; i++) {
+        payload[i] = i;
+    }
+
+    BleTxStats before = bluetoothManager.getTxStats();
+    uint32_t startTime = millis();
+    for (uint16_t seq = 0; seq < count; seq++) {
+        payload[0] = seq >> 8;
+        payload[1] = seq & 0xFF;
+        if (!bluetoothManager.sendMessage(MSG_TX_BENCHMARK_DATA, payload, size)) {
+            break;
+        }
+        response.count++;
+    }
+    bool flushed = bluetoothManager.flushMessages(BluetoothManager::TX_SEND_WAIT_MS);
+    response.elapsedMs = millis() - startTime;
+    BleTxStats after = bluetoothManager.getTxStats();
+
+    response.result = flushed && response.count == count ? MSG_CMD_SUCCESS : MSG_CMD_FAILURE;
+    response.bytes = after.bytes - before.bytes;
+    response.queueFull = after.queueFull - before.queueFull;
+    response.congested = after.congested - before.congested;
+    response.confirmTimeouts = after.confirmTimeouts - before.confirmTimeouts;
+    if (response.elapsedMs > 0) {
+        response.messagesPerSec = (uint64_t)(after.sent - before.sent) * 1000 / response.elapsedMs;
+        response.bytesPerSec = (uint64_t)response.bytes * 1000 / response.elapsedMs;
+    }
+    LOGI("[Task] TX benchmark: %u messages, %u bytes in %u ms, %u msg/s, %u B/s, queue full %u, congested %u, confirm timeouts %u",
+         response.count, response.bytes, response.elapsedMs, response.messagesPerSec, response.bytesPerSec,
+         response.queueFull, response.congested, response.confirmTimeouts);
+    bluetoothManager.sendMessage(MSG_TX_BENCHMARK, (uint8_t*)&response, sizeof(response));
+}
+
 // 蓝牙消息处理任务（只启动一次）
 void bluetoothMessageQueueTask(void* pvParameters) {
     while (true) {
@@ -40,6 +283,9 @@ void bluetoothMessageQueueTask(void* pvParameters) {
 
 // 初始化队列和处理任务（需在setup或初始化流程中调用一次）
 void initBluetoothMessageQueue() {
+    if (transferMutex == NULL) {
+        transferMutex = xSemaphoreCreateMutex();
+    }
     if (!bluetoothMsgQueue) {
         bluetoothMsgQueue = xQueueCreate(BLUETOOTH_QUEUE_LENGTH, sizeof(TaskParameters*));
         if (bluetoothMsgQueue) {
@@ -61,86 +307,42 @@ void bluetoothMessageTask(TaskParameters* params) {
     try {
         switch (params->msgType) {
             case MSG_FINGERPRINT_SEARCH:{
-                Serial.println("[Task] Processing fingerprint search");
+                LOGI("[Task] Processing fingerprint search");
                 break;
             }
             case MSG_FINGERPRINT_REGISTER:{
-                Serial.println("[Task] Processing fingerprint registration");
+                LOGI("[Task] Processing fingerprint registration");
                 if (params->length < 1) {
-                    Serial.println("[Task] Invalid fingerprint registration data");
+                    LOGW("[Task] Invalid fingerprint registration data");
                     bluetoothManager.sendMessage(MSG_FINGERPRINT_REGISTER, &MSG_CMD_FAILURE, 1);
                     break;
                 }
-                // 开始注册指纹之前需要取消中断
-                detachInterrupt(digitalPinToInterrupt(PIN_FINGERPRINT_TOUCH));
-                // 重置取消标志
-                bCancelRegister = false;
-                int fingerprintId = params->data[0];
-                bool success = fingerprint.registerFingerprint(fingerprintId);
-                // 注册任务完成后恢复中断，确保无论如何都恢复中断
-                attachInterrupt(digitalPinToInterrupt(PIN_FINGERPRINT_TOUCH), handleTouchInterrupt, RISING);
-                
-                if (success) {
-                    // 注册成功，生成默认的名字
-                    String name_prefix = "指纹";
-                    configManager.setFingerprintName(fingerprintId, name_prefix + String(fingerprintId + 1));
-                    bluetoothManager.sendMessage(MSG_FINGERPRINT_REGISTER, &MSG_CMD_SUCCESS, 1);
-                } else {
+                // 注册由状态机异步完成，结果通过 MSG_FINGERPRINT_REGISTER 返回，不阻塞消息任务
+                if (!enrollManager.start(params->data[0])) {
                     bluetoothManager.sendMessage(MSG_FINGERPRINT_REGISTER, &MSG_CMD_FAILURE, 1);
                 }
                 break;
             }
-            case MSG_SET_FINGER_NAME: {
-                Serial.println("[Task] Processing set fingerprint name");
-                if (params->length < 2) {
-                    Serial.println("[Task] Invalid set fingerprint name data");
-                    bluetoothManager.sendMessage(MSG_SET_FINGER_NAME, &MSG_CMD_FAILURE, 1);
-                    break;
-                }
-                int id = params->data[0];
-                String name = String((char*)&params->data[1]);
-                Serial.print("[Task] Setting fingerprint name for ID ");
-                Serial.print(id);
-                Serial.print(": ");
-                Serial.println(name);
-                if (configManager.setFingerprintName(id, name)) {
-                    bluetoothManager.sendMessage(MSG_SET_FINGER_NAME, &MSG_CMD_SUCCESS, 1);
-                } else {
-                    bluetoothManager.sendMessage(MSG_SET_FINGER_NAME, &MSG_CMD_FAILURE, 1);
-                }
-                break;
-            }
-            case MSG_RENAME_FINGER_NAME: {
-                // data: [id(1B)] + newName(utf8, 最多32B)
-                if (params->length < 2) {
-                    bluetoothManager.sendMessage(MSG_RENAME_FINGER_NAME, &MSG_CMD_FAILURE, 1);
-                    break;
-                }
-                int id = params->data[0];
-                String newName = String((char*)&params->data[1]);
-                if (configManager.renameFingerprintName(id, newName)) {
-                    bluetoothManager.sendMessage(MSG_RENAME_FINGER_NAME, &MSG_CMD_SUCCESS, 1);
-                } else {
-                    bluetoothManager.sendMessage(MSG_RENAME_FINGER_NAME, &MSG_CMD_FAILURE, 1);
-                }
-                break;
-            }
             case MSG_FINGERPRINT_REGISTER_CANCEL:{
-                Serial.println("[Task] Processing fingerprint registration cancel");
-                bCancelRegister = true;
-                bluetoothManager.sendMessage(MSG_FINGERPRINT_REGISTER_CANCEL, &MSG_CMD_SUCCESS, 1);
+                LOGI("[Task] Processing fingerprint registration cancel");
+                bool cancelled = enrollManager.cancel();
+                bluetoothManager.sendMessage(MSG_FINGERPRINT_REGISTER_CANCEL, cancelled ? &MSG_CMD_SUCCESS : &MSG_CMD_FAILURE, 1);
                 break;
             }
             case MSG_FINGERPRINT_DELETE:{
-                Serial.println("[Task] Processing delete fingerprint request");
+                LOGI("[Task] Processing delete fingerprint request");
                 if (params->length < 2) {
-                    Serial.println("[Task] Invalid delete fingerprint data");
+                    LOGW("[Task] Invalid delete fingerprint data");
                     bluetoothManager.sendMessage(MSG_FINGERPRINT_DELETE, &MSG_CMD_FAILURE, 1);
                     break;
                 }
                 int removeId = params->data[0];
                 if (fingerprint.deleteFingerprint(removeId)) {
                     configManager.removeFingerprintName(removeId); // 同步删除名称
+                    uint16_t usageCounts[MAX_FINGERPRINT_NUM];
+                    if (fingerprint.takeUsageChanges(usageCounts)) {
+                        configManager.saveFingerprintUsage(usageCounts); // 同步清除匹配次数
+                    }
                     bluetoothManager.sendMessage(MSG_FINGERPRINT_DELETE, &MSG_CMD_SUCCESS, 1);
                 } else {
                     bluetoothManager.sendMessage(MSG_FINGERPRINT_DELETE, &MSG_CMD_FAILURE, 1);
@@ -148,28 +350,38 @@ void bluetoothMessageTask(TaskParameters* params) {
                 break;
             }
             case MSG_GET_INFO:{
-                Serial.print("订阅完成耗时：");
-                Serial.println(millis() - recordTime);
-                Serial.println("[Task] Processing get info request");
-                if(touchTriggered) {
+                LOGI("订阅完成耗时：%lu", millis() - recordTime);
+                LOGI("[Task] Processing get info request");
+                if(unlockManager.isUnlockInProgress()) {
                     xEventGroupSetBits(event_group, EVENT_BIT_BLE_NOTIFY);
                 }
-                MsgInfo info;
+                struct {
+                    MsgInfo info;
+                    MsgLinkInfo link;
+                } __attribute__((packed)) reply = {};
+                MsgInfo &info = reply.info;
                 info.sleepTime = configManager.getSleepTimeout();
                 strncpy(info.deviceId, versionInfo.deviceId.c_str(), sizeof(info.deviceId) - 1);
                 strncpy(info.buildDate, versionInfo.buildDate.c_str(), sizeof(info.buildDate) - 1);
                 strncpy(info.firmwareVer, versionInfo.firmwareVersion.c_str(), sizeof(info.firmwareVer) - 1);
+                // 附带协商的链路参数，电脑端按 maxPayload 确定每次写入的长度
+                reply.link.mtu = bluetoothManager.getMtu();
+                reply.link.maxPayload = bluetoothManager.maxPayload();
+                reply.link.txDataLength = bluetoothManager.getTxDataLength();
+                reply.link.rxDataLength = bluetoothManager.getRxDataLength();
+                reply.link.connInterval = bluetoothManager.getConnInterval();
+                reply.link.connLatency = bluetoothManager.getConnLatency();
           
-                Serial.println("[Task] MSG_GET_INFO return bluetoothMessage");
-                bluetoothManager.sendMessage(MSG_GET_INFO, (uint8_t*)&info, sizeof(info));
+                LOGI("[Task] MSG_GET_INFO return bluetoothMessage, MTU %u", reply.link.mtu);
+                bluetoothManager.sendMessage(MSG_GET_INFO, (uint8_t*)&reply, sizeof(reply));
                 break;
             }
             case MSG_GET_FINGER_NAMES:{
-                Serial.println("[Task] Processing get fingerprint names request");
+                LOGI("[Task] Processing get fingerprint names request");
                 uint8_t indexTable[32] = {0};
                 bool readIndexSuccess = fingerprint.readIndexTable(indexTable); // 读取索引表
                 if (!readIndexSuccess) {
-                    Serial.println("[Task] Failed to read fingerprint index table");
+                    LOGW("[Task] Failed to read fingerprint index table");
                     uint8_t errorMsg = 0xFF; // 用0xFF表示读取索引表失败
                     bluetoothManager.sendMessage(MSG_GET_FINGER_NAMES, &errorMsg, 1);
                     break;
@@ -178,13 +390,13 @@ void bluetoothMessageTask(TaskParameters* params) {
                 std::vector<FPData> names;
                 configManager.getAllFingerprintNames(names, indexTable);
                 
-                Serial.printf("[Task] Found %d fingerprint names\n", names.size());
+                LOGI("[Task] Found %d fingerprint names", names.size());
                 
                 if(names.size() == 0) {
-                    Serial.println("[Task] No fingerprint names found");
+                    LOGI("[Task] No fingerprint names found");
                     uint8_t buf[1] = {0}; // 返回一个字节表示没有指纹
                     if (!bluetoothManager.sendMessage(MSG_GET_FINGER_NAMES, buf, 1)) {
-                        Serial.println("[Task] Failed to send empty fingerprint names response");
+                        LOGW("[Task] Failed to send empty fingerprint names response");
                     }
                 } else {
                     uint8_t buf[1 + names.size() * sizeof(FPData)] = {0};
@@ -192,17 +404,17 @@ void bluetoothMessageTask(TaskParameters* params) {
                     for (size_t i = 0; i < names.size(); ++i) {
                         memcpy((void*)&buf[1 + i * sizeof(FPData)], &names[i], sizeof(FPData));
                     }
-                    Serial.println("[Task] MSG_GET_FINGER_NAMES return fingerprint names");
+                    LOGI("[Task] MSG_GET_FINGER_NAMES return fingerprint names");
                     if (!bluetoothManager.sendMessage(MSG_GET_FINGER_NAMES, buf, 1 + names.size() * sizeof(FPData))) {
-                        Serial.println("[Task] Failed to send fingerprint names response");
+                        LOGW("[Task] Failed to send fingerprint names response");
                     }
                 }
                 break;
             }
             case MSG_SET_SLEEPTIME:{
-                Serial.println("[Task] Processing set sleep time request");
+                LOGI("[Task] Processing set sleep time request");
                 if (params->length < sizeof(uint32_t)) {
-                    Serial.println("[Task] Invalid sleep time data");
+                    LOGW("[Task] Invalid sleep time data");
                     bluetoothManager.sendMessage(MSG_SET_SLEEPTIME, &MSG_CMD_FAILURE, 1);
                     break;
                 }
@@ -216,125 +428,267 @@ void bluetoothMessageTask(TaskParameters* params) {
                 }
                 break;
             }
+            case MSG_SET_MATCH_MODE:{
+                LOGI("[Task] Processing set match mode request");
+                if (params->length < 1 ||
+                    (params->data[0] != Fingerprint::MATCH_MODE_SEARCH && params->data[0] != Fingerprint::MATCH_MODE_AUTO_IDENTIFY)) {
+                    LOGW("[Task] Invalid match mode data");
+                    bluetoothManager.sendMessage(MSG_SET_MATCH_MODE, &MSG_CMD_FAILURE, 1);
+                    break;
+                }
+                fingerprint.setMatchMode(params->data[0]);
+                configManager.setMatchMode(params->data[0]);
+                configManager.save(); // 保存配置
+                bluetoothManager.sendMessage(MSG_SET_MATCH_MODE, &MSG_CMD_SUCCESS, 1);
+                break;
+            }
+            case MSG_SET_SENSOR_POWER:{
+                LOGI("[Task] Processing set sensor power policy request");
+                if (params->length < 1 ||
+                    (params->data[0] != Fingerprint::SENSOR_POWER_OFF && params->data[0] != Fingerprint::SENSOR_POWER_SLEEP)) {
+                    LOGW("[Task] Invalid sensor power policy data");
+                    bluetoothManager.sendMessage(MSG_SET_SENSOR_POWER, &MSG_CMD_FAILURE, 1);
+                    break;
+                }
+                configManager.setSensorPowerPolicy(params->data[0]);
+                configManager.save(); // 保存配置
+                bluetoothManager.sendMessage(MSG_SET_SENSOR_POWER, &MSG_CMD_SUCCESS, 1);
+                break;
+            }
+            case MSG_SET_REARM_INTERVAL:{
+                LOGI("[Task] Processing set re-arm interval request");
+                if (params->length < 2) {
+                    LOGW("[Task] Invalid re-arm interval data");
+                    bluetoothManager.sendMessage(MSG_SET_REARM_INTERVAL, &MSG_CMD_FAILURE, 1);
+                    break;
+                }
+                configManager.setRearmInterval((uint16_t)(params->data[0] << 8) | params->data[1]);
+                configManager.save(); // 保存配置
+                bluetoothManager.sendMessage(MSG_SET_REARM_INTERVAL, &MSG_CMD_SUCCESS, 1);
+                break;
+            }
+            case MSG_IMAGE_UPLOAD:{
+                LOGI("[Task] Processing image upload request");
+                handleImageUpload(params->length >= 1 ? params->data[0] : 0);
+                break;
+            }
+            case MSG_TX_BENCHMARK:{
+                LOGI("[Task] Processing TX benchmark request");
+                if (params->length < 3) {
+                    bluetoothManager.sendMessage(MSG_TX_BENCHMARK, &MSG_CMD_FAILURE, 1);
+                    break;
+                }
+                handleTxBenchmark((params->data[0] << 8) | params->data[1], params->data[2]);
+                break;
+            }
+            case MSG_TRACE_STATS:{
+                LOGI("[Task] Processing trace stats request");
+                bool reset = params->length >= 1 && (params->data[0] & TRACE_FLAG_RESET);
+                // 逐个复制直方图，不在 BLEQueueTask 栈上放整个数组
+                FingerprintTraceHistogram histogram;
+                int count = 0;
+                bool success = true;
+                while (success && fingerprint.trace().histogram(count, histogram)) {
+                    MsgTraceHistogram msg;
+                    msg.cmd = histogram.cmd;
+                    msg.count = histogram.count;
+                    msg.timeouts = histogram.timeouts;
+                    msg.errors = histogram.errors;
+                    msg.totalMs = histogram.totalMs;
+                    msg.maxMs = histogram.maxMs;
+                    memcpy(msg.buckets, histogram.buckets, sizeof(msg.buckets));
+                    success = bluetoothManager.sendMessage(MSG_TRACE_DATA, (uint8_t*)&msg, sizeof(msg));
+                    count++;
+                }
+                if (success && reset) {
+                    fingerprint.trace().reset();
+                }
+                uint8_t result[2] = {success ? MSG_CMD_SUCCESS : MSG_CMD_FAILURE, (uint8_t)count};
+                bluetoothManager.sendMessage(MSG_TRACE_STATS, result, 2);
+                break;
+            }
+            case MSG_TEMPLATE_EXPORT:{
+                LOGI("[Task] Processing template export request");
+                uint8_t indexTable[INDEX_TABLE_LENGTH] = {0};
+                if (!fingerprint.readIndexTable(indexTable)) {
+                    LOGW("[Task] Failed to read fingerprint index table");
+                    bluetoothManager.sendMessage(MSG_TEMPLATE_EXPORT, &MSG_CMD_FAILURE, 1);
+                    break;
+                }
+
+                // 每个模板边从模组接收边分块发送，不缓存整个模板
+                uint8_t chunk[2 + TEMPLATE_CHUNK_SIZE];
+                // 每块正好填满一条通知（减去消息头和分块头）
+                size_t chunkSize = min((size_t)TEMPLATE_CHUNK_SIZE, (size_t)bluetoothManager.maxPayload() - 5);
+                uint8_t exported = 0;
+                bool success = true;
+                for (int id = 0; id < MAX_FINGERPRINT_NUM && success; ++id) {
+                    if (!(indexTable[id / 8] & (1 << (id % 8)))) {
+                        continue;
+                    }
+                    sleepManager.resetActivity();
+                    size_t used = 0;
+                    bool first = true;
+                    chunk[0] = id;
+                    auto flush = [&](bool lastChunk) -> bool {
+                        chunk[1] = (first ? TEMPLATE_FLAG_FIRST : 0) | (lastChunk ? TEMPLATE_FLAG_LAST : 0);
+                        first = false;
+                        bool sent = bluetoothManager.sendMessage(MSG_TEMPLATE_DATA, chunk, 2 + used);
+                        used = 0;
+                        return sent;
+                    };
+                    success = fingerprint.uploadTemplate(id, [&](const uint8_t* data, uint16_t length, bool last) {
+                        while (length > 0) {
+                            size_t n = min((size_t)length, chunkSize - used);
+                            memcpy(&chunk[2 + used], data, n);
+                            used += n;
+                            data += n;
+                            length -= n;
+                            // 最后一块留到模板结束时带上结束标志发送
+                            if (used == chunkSize && !(last && length == 0) && !flush(false)) {
+                                return false;
+                            }
+                        }
+                        return last ? flush(true) : true;
+                    });
+                    if (success) {
+                        exported++;
+                    }
+                }
+                LOGI("[Task] Exported %d templates", exported);
+                uint8_t result[2] = {success ? MSG_CMD_SUCCESS : MSG_CMD_FAILURE, exported};
+                bluetoothManager.sendMessage(MSG_TEMPLATE_EXPORT, result, 2);
+                break;
+            }
+            case MSG_TEMPLATE_IMPORT:{
+                xSemaphoreTake(transferMutex, portMAX_DELAY);
+                handleTemplateImport(params->data, params->length, true);
+                xSemaphoreGive(transferMutex);
+                break;
+            }
             case MSG_REST_ALL:{
-                Serial.println("[Task] Processing reset all request");
+                LOGI("[Task] Processing reset all request");
                 // 恢复出厂设置
                 configManager.clear();
+                fingerprint.setMatchMode(configManager.getMatchMode());
                 fingerprint.clearAllLib();
                 bluetoothManager.sendMessage(MSG_REST_ALL, &MSG_CMD_SUCCESS, 1);
                 break;
             }
             case MSG_LOCKSCREEN_STATUS:{
-                Serial.println("[Task] Processing lock screen status request");
+                LOGI("[Task] Processing lock screen status request");
                 xEventGroupSetBits(event_group, EVENT_BIT_SCREENLOCK); // 设置屏幕锁定事件位
                 break;
             }
             case MSG_DEVICE_NOTIFY:{
-                Serial.println("[Task] Recived PC connected notify");
-                if(touchTriggered) {
-                    Serial.println("[FP] 通知订阅通道已连接");
+                LOGI("[Task] Recived PC connected notify");
+                if(unlockManager.isUnlockInProgress()) {
+                    LOGI("[FP] 通知订阅通道已连接");
                     xEventGroupSetBits(event_group, EVENT_BIT_BLE_NOTIFY); // 设置设备通知事件位
                 }
                 bluetoothManager.isConnectedNotify = true;
                 // 蓝牙连上了，恢复蓝色呼吸灯
-                fingerprint.setLEDCmd(Fingerprint::LED_CODE_BREATH,0x01,0x01,0x00,18);  // 蓝色呼吸灯
+                ledManager.requestLedEffect(Fingerprint::LED_CODE_BREATH,0x01,0x01,0x00,18);  // 蓝色呼吸灯
                 break;
             }
             case MSG_ENABLE_SLEEP:{
-                Serial.println("[Task] Processing enable sleep request");
+                LOGI("[Task] Processing enable sleep request");
                 if (params->length < 1) {
-                    Serial.println("[Task] Invalid enable sleep data");
+                    LOGW("[Task] Invalid enable sleep data");
                     break;
                 }
                 bool enable = params->data[0] != 0; // 0表示禁用休眠，非0表示启用
                 sleepManager.preventSleep(!enable);
                 if (enable) {
-                    Serial.println("[Task] Sleep mode enabled");
+                    LOGI("[Task] Sleep mode enabled");
                 } else {
-                    Serial.println("[Task] Sleep mode disabled");
+                    LOGI("[Task] Sleep mode disabled");
                 }
                 break;
             }
             case MSG_CHECK_SLEEP:{
-                Serial.println("[Task] Processing check sleep request");
+                LOGI("[Task] Processing check sleep request");
                 if (params->length < 1) {
-                    Serial.println("[Task] Invalid check sleep data");
+                    LOGW("[Task] Invalid check sleep data");
                     xEventGroupSetBits(event_group, EVENT_BIT_BLE_SLEEP_ENABLE);
                     break;
                 }
                 bool bEnableSleep = params->data[0] != 0; // 0表示禁用休眠，非0表示启用
                 if (bEnableSleep) {
-                    Serial.println("[Task] Alow enter sleep mode");
+                    LOGI("[Task] Alow enter sleep mode");
                 } else {
-                    Serial.println("[Task] Deny enter sleep mode, UI actived");
+                    LOGI("[Task] Deny enter sleep mode, UI actived");
                 }
                 xEventGroupSetBits(event_group, EVENT_BIT_BLE_SLEEP_ENABLE);
                 break;
             }
             case MSG_FIRMWARE_UPDATE_START:{
-                Serial.println("[Task] Processing firmware update >START<");
+                LOGI("[Task] Processing firmware update >START<");
                 if (params->length < 1) {
-                    Serial.println("[Task] Invalid firmware update data");
+                    LOGW("[Task] Invalid firmware update data");
                     bluetoothManager.sendMessage(MSG_FIRMWARE_UPDATE_START, &MSG_CMD_FAILURE, 1);
                     break;
                 }
                 // 固件更新开始，获取固件文件大小
                 uint32_t total_size;
                 memcpy(&total_size, params->data, sizeof(total_size));
-                if (bluetoothOTA.begin(total_size)) {
-                    Serial.println("[Task] Firmware update started");
+                xSemaphoreTake(transferMutex, portMAX_DELAY);
+                bool started = bluetoothOTA.begin(total_size);
+                if (started) {
+                    firmwareChunkFailed = false;
+                }
+                xSemaphoreGive(transferMutex);
+                if (started) {
+                    LOGI("[Task] Firmware update started");
                     bluetoothManager.sendMessage(MSG_FIRMWARE_UPDATE_START, &MSG_CMD_SUCCESS, 1);
                 } else {
-                    Serial.println("[Task] Firmware update failed");
+                    LOGW("[Task] Firmware update failed");
                     bluetoothManager.sendMessage(MSG_FIRMWARE_UPDATE_START, &MSG_CMD_FAILURE, 1);
                 }
                 break;
             }
             case MSG_FIRMWARE_UPDATE_CHUNK:{
-                Serial.println("[Task] Processing firmware update >CHUNK<");
-                if (params->length < 1) {
-                    Serial.println("[Task] Invalid firmware update data");
-                    bluetoothManager.sendMessage(MSG_FIRMWARE_UPDATE_CHUNK, &MSG_CMD_FAILURE, 1);
-                    break;
-                }
-                // 固件更新数据写入
-                if (!bluetoothOTA.receiveData(params->data, params->length)) {
-                    Serial.println("[Task] Failed to write firmware chunk data");
-                    bluetoothManager.sendMessage(MSG_FIRMWARE_UPDATE_CHUNK, &MSG_CMD_FAILURE, 1);
-                    break;
-                }else{
-                    Serial.println("[Task] Write firmware chunk success");
-                    bluetoothManager.sendMessage(MSG_FIRMWARE_UPDATE_CHUNK, &MSG_CMD_SUCCESS, 1);
-                }
+                xSemaphoreTake(transferMutex, portMAX_DELAY);
+                handleFirmwareChunk(params->data, params->length, true);
+                xSemaphoreGive(transferMutex);
                 break;
             }
             case MSG_FIRMWARE_UPDATE_END:{
-                Serial.println("[Task] Processing firmware update >END<");
+                LOGI("[Task] Processing firmware update >END<");
                 if (params->length < 1) {
-                    Serial.println("[Task] Invalid firmware update end data");
+                    LOGW("[Task] Invalid firmware update end data");
                     bluetoothManager.sendMessage(MSG_FIRMWARE_UPDATE_END, &MSG_CMD_FAILURE, 1);
                     break;
                 }
+                // 数据块可能还在批量通道中，先等待写完
+                if (!bluetoothManager.flushBulk(1000)) {
+                    LOGW("[Task] Bulk channel not drained before firmware update end");
+                }
                 // 固件更新结束，验证CRC32
                 String targetCRC32 = String((char*)params->data);
-                if (bluetoothOTA.finish(targetCRC32)) {
-                    Serial.println("[Task] Firmware update completed successfully");
+                xSemaphoreTake(transferMutex, portMAX_DELAY);
+                bool finished = bluetoothOTA.finish(targetCRC32);
+                xSemaphoreGive(transferMutex);
+                if (finished) {
+                    LOGI("[Task] Firmware update completed successfully");
                     bluetoothManager.sendMessage(MSG_FIRMWARE_UPDATE_END, &MSG_CMD_SUCCESS, 1);
-                    delay(1000);//等待蓝牙发送完毕后重启
+                    Log::flush();
+                    bluetoothManager.flushMessages(1000); // 等待蓝牙发送完毕后重启
+                    delay(100);
                     ESP.restart();
                 } else {
-                    Serial.println("[Task] Firmware update failed or CRC32 mismatch");
+                    LOGW("[Task] Firmware update failed or CRC32 mismatch");
                     bluetoothManager.sendMessage(MSG_FIRMWARE_UPDATE_END, &MSG_CMD_FAILURE, 1);
                 }
                 break;
             }
             default:{
-                Serial.printf("[Task] Unknown message type: %02X\n", params->msgType);
+                LOGW("[Task] Unknown message type: %02X", params->msgType);
                 break;
             }
         }
     } catch (...) {
-        Serial.println("[Task] Exception occurred while processing message");
+        LOGE("[Task] Exception occurred while processing message");
     }
     
     // 确保params始终被释放
@@ -345,32 +699,65 @@ void bluetoothMessageTask(TaskParameters* params) {
 void handleBluetoothMessage(uint8_t msgType, uint8_t* data, size_t length) {
     
     if (!bluetoothMsgQueue) {
-        Serial.println("[BLE] Queue not initialized!");
+        LOGE("[BLE] Queue not initialized!");
         return;
     }
     
     TaskParameters* params = new TaskParameters();
     if (params == nullptr) {
-        Serial.println("[BLE] Failed to allocate memory for TaskParameters");
+        LOGW("[BLE] Failed to allocate memory for TaskParameters");
         return;
     }
     
     params->msgType = msgType;
-    memcpy(params->data, data, min(length, (size_t)MAX_DATA_LENGTH));
+    params->data = params->inlineData;
+    if (length >= MAX_DATA_LENGTH) {
+        // 分片重组后的长消息，多分配一个字节保证以0结尾
+        params->data = new (std::nothrow) uint8_t[length + 1];
+        if (params->data == nullptr) {
+            LOGW("[BLE] Failed to allocate %u bytes for message 0x%02X", length, msgType);
+            params->data = params->inlineData;
+            delete params;
+            return;
+        }
+        params->data[length] = 0;
+    }
+    if (data != nullptr && length > 0) {
+        memcpy(params->data, data, length);
+    }
     params->length = length;
 
     //在这里单独判断取消类型的消息，不入队列了，因为之前队列中还等待取消在
     if(msgType == MSG_FINGERPRINT_REGISTER_CANCEL) {
-        Serial.println("[BLE] Processing fingerprint register cancel immediately");
+        LOGI("[BLE] Processing fingerprint register cancel immediately");
         bluetoothMessageTask(params);
         // 注意：bluetoothMessageTask会负责释放params
         return;
     }
 
     if (xQueueSend(bluetoothMsgQueue, &params, 0) != pdPASS) {
-        Serial.println("[BLE] Queue full, message dropped!");
+        LOGW("[BLE] Queue full, message dropped!");
         delete params;
     } else {
-        Serial.println("[BLE] Message enqueued");
+        LOGD("[BLE] Message enqueued");
     }
-}
\ No newline at end of file
+}
+
+// 批量数据通道的数据块（在批量任务中调用），只接受大块数据的传输消息
+void handleBulkMessage(uint8_t msgType, uint8_t* data, size_t length) {
+    switch (msgType) {
+        case MSG_FIRMWARE_UPDATE_CHUNK:
+            xSemaphoreTake(transferMutex, portMAX_DELAY);
+            handleFirmwareChunk(data, length, false);
+            xSemaphoreGive(transferMutex);
+            break;
+        case MSG_TEMPLATE_IMPORT:
+            xSemaphoreTake(transferMutex, portMAX_DELAY);
+            handleTemplateImport(data, length, false);
+            xSemaphoreGive(transferMutex);
+            break;
+        default:
+            LOGW("[Bulk] Unsupported message type: %02X", msgType);
+            break;
+    }
+}
@@ -7,12 +7,25 @@
 #define BLUETOOTH_HANDLE_H
 #include <Arduino.h>
 
-#define MAX_DATA_LENGTH 300  // 从电脑端最大接收数据长度
+#define MAX_DATA_LENGTH 300  // 直接存放在任务参数中的消息长度，更长的分片重组消息另外分配
+#define TEMPLATE_CHUNK_SIZE 240  // 模板传输每条消息的最大数据长度（MTU 251 减去ATT头、消息头和分块头），实际按协商的 MTU
+#define TEMPLATE_MAX_SIZE 4096   // 导入时缓存的单个模板最大长度
+#define IMAGE_CHUNK_SIZE 240     // 图像传输每条消息的最大数据长度，实际按协商的 MTU
+#define IMAGE_STREAM_BUFFER_SIZE 4096 // 串口接收和蓝牙发送之间的缓冲，加上串口接收缓冲可以吸收两端的速度差
+#define IMAGE_WAIT_MS 5000       // 诊断采图等待手指的最长时间
+#define IMAGE_STALL_MS 2000      // 缓冲区持续写满超过这个时间（蓝牙发送停止）则中止上传
 // 任务处理函数的参数结构
 struct TaskParameters {
     uint8_t msgType;
-    uint8_t data[MAX_DATA_LENGTH];
+    uint8_t* data;                        // 指向 inlineData，或者分配的长消息缓冲区
     size_t length;
+    uint8_t inlineData[MAX_DATA_LENGTH];  // 短消息不额外分配，并保证读取前几个字节总是安全的
+
+    ~TaskParameters() {
+        if (data != inlineData) {
+            delete[] data;
+        }
+    }
 };
 
 #ifdef __cplusplus
@@ -25,6 +38,8 @@ void bluetoothMessageQueueTask(void* pvParameters);
 
 void handleBluetoothMessage(uint8_t msgType, uint8_t* data, size_t length);
 
+void handleBulkMessage(uint8_t msgType, uint8_t* data, size_t length);
+
 void bluetoothMessageTask(TaskParameters* params);
 
 #ifdef __cplusplus
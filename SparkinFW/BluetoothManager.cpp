@@ -4,21 +4,40 @@
  * All rights reserved
  */
 #include "BluetoothManager.h"
+#include "LedManager.h"
 #include "Common.h"
 #include "ConfigManager.h"
 #include "BluetoothHandle.h"
 #include "Fingerprint.h"
 #include "SleepManager.h"
+#include "UnlockManager.h"
+#include "Log.h"
 #include <esp_gap_ble_api.h>
+#include <esp_gatts_api.h>
 extern ConfigManager configManager;
 extern Fingerprint fingerprint; // 引入指纹模块对象
+extern LedManager ledManager;
 extern SleepManager sleepManager;
+extern UnlockManager unlockManager;
+
+#define BLE_TX_TASK_STACK_SIZE 3072
+#define BLE_TX_TASK_PRIORITY 3
+#define BLE_BULK_TASK_STACK_SIZE 4096 // 回调中写入 flash 或下载模板
+#define BLE_BULK_TASK_PRIORITY 2
+
+// 发送事件位
+#define TX_BIT_CONFIRMED (1 << 0)   // 协议栈已接收上一条通知
+#define TX_BIT_UNCONGESTED (1 << 1) // 链路没有拥塞
+
+// 协议栈事件回调是静态函数，通过这个指针找到管理器
+static BluetoothManager *txOwner = nullptr;
 
 BluetoothManager::BluetoothManager()
 {
     pServer = nullptr;
     pService = nullptr;
     pCharacteristic = nullptr;
+    pBulkCharacteristic = nullptr;
     pBLE2902 = nullptr;
     pBleKeyboard = nullptr;
     
@@ -30,9 +49,39 @@ BluetoothManager::BluetoothManager()
     isConnectedNotify = false;
     _autoAdvertisingEnabled = true; // 默认为true
     
-    sendMutex = xSemaphoreCreateMutex();
+    txFreeQueue = NULL;
+    txReadyQueue = NULL;
+    txEvents = NULL;
+    txFragmentMutex = NULL;
+    txFragmentSeq = 0;
+    txStats = {};
+    rxLength = 0;
+    rxNextSeq = 0;
+    rxActive = false;
+    bulkFreeQueue = NULL;
+    bulkReadyQueue = NULL;
+    bulkCallback = nullptr;
+    bulkOverruns = 0;
+    connMtu = DEFAULT_MTU;
+    txDataLength = DEFAULT_DATA_LENGTH;
+    rxDataLength = DEFAULT_DATA_LENGTH;
+    connInterval = 0;
+    connLatency = 0;
+    memset(connAddress, 0, sizeof(connAddress));
+    connFastUntil = 0;
+    connUpdateRejected = false;
+    connGranted = CONN_PROFILE_NONE;
+    connPending = false;
+    connRequested = CONN_PROFILE_NONE;
+    connLastRequest = 0;
+    bondedPeerCount = 0;
+    bondedDeviceCount = 0;
+    directedAdvPending = true;
+    advertisingDirected = false;
+    directedAdvStart = 0;
     stateMutex = xSemaphoreCreateMutex(); // 初始化状态互斥锁
     _unpairRequest = false; // 初始化取消配对请求标志
+    bondCacheStale = false;
 }
 
 void BluetoothManager::begin(const char *deviceName, BleKeyboard *bleKeyboard)
@@ -47,6 +96,9 @@ void BluetoothManager::begin(const char *deviceName, BleKeyboard *bleKeyboard)
     BLEDevice::init(deviceName);
     // 设置本地MTU
     BLEDevice::setMTU(251);
+    // 接收通知的确认和拥塞事件用于发送限速，MTU 和链路层包长用于确定分块大小
+    BLEDevice::setCustomGattsHandler(gattsEventHandler);
+    BLEDevice::setCustomGapHandler(gapEventHandler);
 
     // 设置安全参数 - 使用BLE绑定机制
     BLESecurity *pSecurity = new BLESecurity();
@@ -58,9 +110,9 @@ void BluetoothManager::begin(const char *deviceName, BleKeyboard *bleKeyboard)
     // 启用 RPA
     //esp_ble_gap_config_local_privacy(true);
 
-    // 打印当前已绑定设备数量
-    int bondedCount = esp_ble_get_bond_device_num();
-    Serial.printf("当前已绑定设备数量: %d\n", bondedCount);
+    // 读取绑定列表到缓存，打印当前已绑定设备数量
+    refreshBondCache();
+    Serial.printf("当前已绑定设备数量: %d\n", getBondedDeviceCount());
 
     // 创建BLE服务器
     pServer = BLEDevice::createServer();
@@ -82,12 +134,22 @@ void BluetoothManager::begin(const char *deviceName, BleKeyboard *bleKeyboard)
     pCharacteristic->addDescriptor(pBLE2902);
     pCharacteristic->setCallbacks(this);
 
+    // 批量数据特征只需要无响应写入
+    pBulkCharacteristic = pService->createCharacteristic(
+        BULK_CHARACTERISTIC_UUID,
+        BLECharacteristic::PROPERTY_WRITE_NR);
+    pBulkCharacteristic->setCallbacks(this);
+
     // 初始化HID服务
     pBleKeyboard->begin(pServer);
 
     // 启动服务
     pService->start();
 
+    // 初始化发送队列和批量数据通道
+    initTxQueue();
+    initBulkChannel();
+
     // 初始化蓝牙消息处理队列
     initBluetoothMessageQueue();
    
@@ -116,14 +178,19 @@ void BluetoothManager::startAdvertising(bool bFastMode)
         configManager.generateNewBLEAddress();
         configManager.getBLEAddress(dummy_addr);
     }
-    Serial.print("BLE地址: ");
-    for (int i = 0; i < 6; i++) {
-        Serial.printf("%02X", dummy_addr[i]);
-        if (i < 5) Serial.print(":");
-    }
-    Serial.println();
+    LOGI("BLE地址: %02X:%02X:%02X:%02X:%02X:%02X", dummy_addr[0], dummy_addr[1], dummy_addr[2],
+         dummy_addr[3], dummy_addr[4], dummy_addr[5]);
     pAdvertising->setDeviceAddress(dummy_addr, BLE_ADDR_TYPE_RANDOM);
 
+    // 有绑定的电脑时先定向广播一次，电脑正在扫描时可以立即连上；超时后在 loop() 中改为普通广播
+    BondedPeer peer;
+    if (bFastMode && directedAdvPending && getBondedPeer(peer)) {
+        directedAdvPending = false;
+        if (startDirectedAdvertising(peer)) {
+            return;
+        }
+    }
+
     // 添加HID服务UUID和自定义服务UUID
     pAdvertising->addServiceUUID(SERVICE_UUID);
     pAdvertising->addServiceUUID(pBleKeyboard->getUUID());
@@ -156,19 +223,19 @@ void BluetoothManager::startAdvertising(bool bFastMode)
     BLEDevice::startAdvertising();
 
     isAdvertising = true;
-    Serial.println("BLE设备已开始广播，等待客户端连接...");
+    LOGI("BLE设备已开始广播，等待客户端连接...");
 
     // 检查是否处于配对模式（无绑定设备=配对模式）
-    int bondedCount = esp_ble_get_bond_device_num();
+    int bondedCount = getBondedDeviceCount();
     if (bondedCount == 0)
     {
-        Serial.println("配对模式：无绑定设备，允许新设备配对");
+        LOGI("配对模式：无绑定设备，允许新设备配对");
         // 设置LED灯为白色灯闪烁
-        fingerprint.setLEDCmd(Fingerprint::LED_CODE_BLINK,0x07,(uint8_t)( (5 << 4) | 5 ), 0x00, 8);
+        ledManager.requestLedEffect(Fingerprint::LED_CODE_BLINK,0x07,(uint8_t)( (5 << 4) | 5 ), 0x00, 8);
     }
     else
     {
-        Serial.printf("已有 %d 个绑定设备，只允许已绑定设备重连\n", bondedCount);
+        LOGI("已有 %d 个绑定设备，只允许已绑定设备重连", bondedCount);
     }
 }
 
@@ -177,7 +244,83 @@ void BluetoothManager::stopAdvertising()
 {
     BLEDevice::stopAdvertising();
     isAdvertising = false;
-    Serial.println("BLE设备已停止广播");
+    advertisingDirected = false;
+    LOGI("BLE设备已停止广播");
+}
+
+// 高占空比定向广播：不带广播数据，只有指定的电脑可以连接
+bool BluetoothManager::startDirectedAdvertising(const BondedPeer &peer)
+{
+    esp_ble_adv_params_t params = {};
+    params.adv_int_min = 0x20; // 高占空比定向广播不使用广播间隔
+    params.adv_int_max = 0x20;
+    params.adv_type = ADV_TYPE_DIRECT_IND_HIGH;
+    params.own_addr_type = BLE_ADDR_TYPE_RANDOM; // 地址已由 setDeviceAddress 设置
+    memcpy(params.peer_addr, peer.address, sizeof(esp_bd_addr_t));
+    params.peer_addr_type = peer.addressType;
+    params.channel_map = ADV_CHNL_ALL;
+    params.adv_filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY;
+    esp_err_t err = esp_ble_gap_start_advertising(&params);
+    if (err != ESP_OK) {
+        LOGW("[BLE] Directed advertising failed: %d", err);
+        return false;
+    }
+
+    recordTime = millis();
+    directedAdvStart = millis();
+    advertisingDirected = true;
+    isAdvertising = true;
+    LOGI("[BLE] Directed advertising to %02x:%02x:%02x:%02x:%02x:%02x", peer.address[0], peer.address[1],
+         peer.address[2], peer.address[3], peer.address[4], peer.address[5]);
+    return true;
+}
+
+// 从协议栈读取绑定列表，在启动时和绑定变化后的主循环中调用，不在协议栈的回调中调用
+void BluetoothManager::refreshBondCache()
+{
+    int count = esp_ble_get_bond_device_num();
+    BondedPeer peers[MAX_CACHED_PEERS];
+    int cached = 0;
+    if (count > 0) {
+        esp_ble_bond_dev_t *list = (esp_ble_bond_dev_t *)malloc(sizeof(esp_ble_bond_dev_t) * count);
+        if (list != nullptr) {
+            esp_ble_get_bond_device_list(&count, list);
+            for (int i = 0; i < count && cached < MAX_CACHED_PEERS; i++) {
+                // 电脑分发了身份地址时使用身份地址，否则是配对时的地址
+                if (list[i].bond_key.key_mask & ESP_LE_KEY_PID) {
+                    memcpy(peers[cached].address, list[i].bond_key.pid_key.static_addr, sizeof(esp_bd_addr_t));
+                    peers[cached].addressType = list[i].bond_key.pid_key.addr_type;
+                } else {
+                    memcpy(peers[cached].address, list[i].bd_addr, sizeof(esp_bd_addr_t));
+                    peers[cached].addressType = BLE_ADDR_TYPE_PUBLIC;
+                }
+                cached++;
+            }
+            free(list);
+        }
+    }
+
+    if (stateMutex && xSemaphoreTake(stateMutex, portMAX_DELAY) == pdTRUE) {
+        memcpy(bondedPeers, peers, sizeof(BondedPeer) * cached);
+        bondedPeerCount = cached;
+        bondedDeviceCount = count;
+        xSemaphoreGive(stateMutex);
+    }
+    LOGI("[BLE] Bond cache refreshed, %d bonded devices", count);
+}
+
+// 一对一绑定，取第一个绑定设备
+bool BluetoothManager::getBondedPeer(BondedPeer &peer)
+{
+    bool found = false;
+    if (stateMutex && xSemaphoreTake(stateMutex, portMAX_DELAY) == pdTRUE) {
+        if (bondedPeerCount > 0) {
+            peer = bondedPeers[0];
+            found = true;
+        }
+        xSemaphoreGive(stateMutex);
+    }
+    return found;
 }
 
 void BluetoothManager::setMessageCallback(MessageCallback callback)
@@ -185,53 +328,467 @@ void BluetoothManager::setMessageCallback(MessageCallback callback)
     messageCallback = callback;
 }
 
-bool BluetoothManager::sendMessage(const uint8_t msgType, const uint8_t *data, size_t length)
+void BluetoothManager::initTxQueue()
+{
+    if (txFreeQueue != NULL) {
+        return;
+    }
+    txOwner = this;
+    txFreeQueue = xQueueCreate(TX_SLOT_COUNT, sizeof(uint8_t));
+    txReadyQueue = xQueueCreate(TX_SLOT_COUNT, sizeof(uint8_t));
+    txEvents = xEventGroupCreate();
+    txFragmentMutex = xSemaphoreCreateMutex();
+    if (txFreeQueue == NULL || txReadyQueue == NULL || txEvents == NULL || txFragmentMutex == NULL) {
+        LOGE("[BLE TX] Failed to create send queue");
+        return;
+    }
+    for (uint8_t i = 0; i < TX_SLOT_COUNT; i++) {
+        xQueueSend(txFreeQueue, &i, 0);
+    }
+    xEventGroupSetBits(txEvents, TX_BIT_UNCONGESTED);
+    xTaskCreate(txTask, "BLETxTask", BLE_TX_TASK_STACK_SIZE, this, BLE_TX_TASK_PRIORITY, NULL);
+}
+
+BleSendStatus BluetoothManager::enqueueMessage(const uint8_t msgType, const uint8_t *data, size_t length, uint32_t waitMs)
 {
-    if (!deviceConnected || pCharacteristic == nullptr)
+    if (!deviceConnected || pCharacteristic == nullptr || txFreeQueue == NULL)
     {
-        return false;
+        return BLE_SEND_NOT_CONNECTED;
+    }
+    if (length + 3 > maxPayload())
+    {
+        return enqueueFragments(msgType, data, length, waitMs);
     }
 
-    if (xSemaphoreTake(sendMutex, portMAX_DELAY) == pdTRUE) {
-        // 创建消息缓冲区：消息类型(1字节) + 数据长度(1字节) + 数据
-        uint8_t *buffer = new uint8_t[length + 3];
-        if (buffer == nullptr)
+    uint8_t index;
+    if (!takeTxSlot(index, waitMs))
+    {
+        return BLE_SEND_QUEUE_FULL;
+    }
+
+    // 消息格式：消息类型(1字节) + 数据长度(2字节) + 数据
+    TxSlot &slot = txSlots[index];
+    slot.data[0] = msgType;
+    slot.data[1] = (length >> 8) & 0xFF;
+    slot.data[2] = length & 0xFF;
+    if (data != nullptr && length > 0)
+    {
+        memcpy(slot.data + 3, data, length);
+    }
+    slot.length = length + 3;
+    xQueueSend(txReadyQueue, &index, 0); // 槽位总数等于队列长度，不会失败
+    requestFastConnection();
+    return BLE_SEND_OK;
+}
+
+bool BluetoothManager::takeTxSlot(uint8_t &index, uint32_t waitMs)
+{
+    if (xQueueReceive(txFreeQueue, &index, 0) == pdPASS)
+    {
+        return true;
+    }
+    txStats.queueFull++;
+    return waitMs > 0 && xQueueReceive(txFreeQueue, &index, pdMS_TO_TICKS(waitMs)) == pdPASS;
+}
+
+// 把 [类型, 长度高, 长度低, data] 按当前 MTU 切分，每段作为一条 MSG_FRAGMENT 入队
+BleSendStatus BluetoothManager::enqueueFragments(const uint8_t msgType, const uint8_t *data, size_t length, uint32_t waitMs)
+{
+    if (length > MAX_MESSAGE_SIZE)
+    {
+        LOGW("[BLE TX] Message 0x%02X too large: %u bytes", msgType, length);
+        return BLE_SEND_TOO_LARGE;
+    }
+    const uint8_t header[3] = {msgType, (uint8_t)((length >> 8) & 0xFF), (uint8_t)(length & 0xFF)};
+    size_t total = length + 3;
+    size_t fragmentSize = maxPayload() - 5; // 减去消息头和分片头
+    size_t count = (total + fragmentSize - 1) / fragmentSize;
+
+    if (xSemaphoreTake(txFragmentMutex, waitMs > 0 ? pdMS_TO_TICKS(waitMs) : 0) != pdTRUE)
+    {
+        return BLE_SEND_QUEUE_FULL;
+    }
+    if (waitMs == 0 && uxQueueMessagesWaiting(txFreeQueue) < count)
+    {
+        txStats.queueFull++;
+        xSemaphoreGive(txFragmentMutex);
+        return BLE_SEND_QUEUE_FULL;
+    }
+
+    BleSendStatus status = BLE_SEND_OK;
+    size_t offset = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        uint8_t index;
+        if (!takeTxSlot(index, waitMs))
         {
-            Serial.println("内存分配失败");
-            xSemaphoreGive(sendMutex);
+            // 已经入队的分片没有最后一片，接收端在下一个第一片时丢弃
+            LOGW("[BLE TX] Message 0x%02X aborted after %u of %u fragments", msgType, i, count);
+            status = BLE_SEND_QUEUE_FULL;
+            break;
+        }
+        size_t chunk = min(fragmentSize, total - offset);
+        TxSlot &slot = txSlots[index];
+        slot.data[0] = MSG_FRAGMENT;
+        slot.data[1] = ((chunk + 2) >> 8) & 0xFF;
+        slot.data[2] = (chunk + 2) & 0xFF;
+        slot.data[3] = (i == 0 ? FRAGMENT_FLAG_FIRST : 0) | (i == count - 1 ? FRAGMENT_FLAG_LAST : 0);
+        slot.data[4] = txFragmentSeq++;
+        // 原消息的头3个字节不在 data 中，分段复制
+        for (size_t n = 0; n < chunk; n++, offset++)
+        {
+            slot.data[5 + n] = offset < 3 ? header[offset] : data[offset - 3];
+        }
+        slot.length = chunk + 5;
+        xQueueSend(txReadyQueue, &index, 0);
+    }
+    xSemaphoreGive(txFragmentMutex);
+    requestFastConnection();
+    return status;
+}
+
+bool BluetoothManager::sendMessage(const uint8_t msgType, const uint8_t *data, size_t length)
+{
+    return enqueueMessage(msgType, data, length, TX_SEND_WAIT_MS) == BLE_SEND_OK;
+}
+
+bool BluetoothManager::flushMessages(uint32_t timeoutMs)
+{
+    if (txFreeQueue == NULL) {
+        return true;
+    }
+    // 发送任务发出一条后才归还槽位，全部槽位空闲即发送完毕
+    uint32_t start = millis();
+    while (uxQueueMessagesWaiting(txFreeQueue) < TX_SLOT_COUNT) {
+        if (millis() - start >= timeoutMs) {
             return false;
         }
+        delay(5);
+    }
+    return true;
+}
 
-        buffer[0] = msgType;
-        // 用2字节存储长度，兼容更大数据包
-        buffer[1] = (length >> 8) & 0xFF;
-        buffer[2] = length & 0xFF;
+void BluetoothManager::setBulkCallback(MessageCallback callback)
+{
+    bulkCallback = callback;
+}
 
-        if (data != nullptr && length > 0)
-        {
-            memcpy(buffer + 3, data, length);
+void BluetoothManager::initBulkChannel()
+{
+    if (bulkFreeQueue != NULL) {
+        return;
+    }
+    bulkFreeQueue = xQueueCreate(BULK_SLOT_COUNT, sizeof(uint8_t));
+    bulkReadyQueue = xQueueCreate(BULK_SLOT_COUNT + 1, sizeof(uint8_t)); // 多一个位置放打开通道的标记
+    if (bulkFreeQueue == NULL || bulkReadyQueue == NULL) {
+        LOGE("[BLE Bulk] Failed to create bulk queue");
+        return;
+    }
+    for (uint8_t i = 0; i < BULK_SLOT_COUNT; i++) {
+        xQueueSend(bulkFreeQueue, &i, 0);
+    }
+    xTaskCreate(bulkTask, "BLEBulkTask", BLE_BULK_TASK_STACK_SIZE, this, BLE_BULK_TASK_PRIORITY, NULL);
+}
+
+// 在协议栈的写入回调中调用，不等待：电脑按额度写入时总有空闲槽位
+// 电脑每次写入都用掉一个额度，无效的写入（空或超长）也占一个槽位、以空数据块排队，
+// 由批量任务跳过并和其他数据块一样归还额度
+void BluetoothManager::receiveBulk(const uint8_t *data, size_t length)
+{
+    if (bulkFreeQueue == NULL) {
+        return;
+    }
+    uint8_t index;
+    if (xQueueReceive(bulkFreeQueue, &index, 0) != pdPASS) {
+        bulkOverruns++;
+        LOGW("[BLE Bulk] Write without credit dropped, %u total", bulkOverruns);
+        return;
+    }
+    BulkSlot &slot = bulkSlots[index];
+    if (length == 0 || length > BULK_SLOT_SIZE) {
+        LOGW("[BLE Bulk] Invalid write dropped, %u bytes", length);
+        slot.length = 0;
+    } else {
+        memcpy(slot.data, data, length);
+        slot.length = length;
+    }
+    xQueueSend(bulkReadyQueue, &index, 0);
+}
+
+// 按顺序处理数据块并归还额度；打开通道的标记排在之前收到的数据块后面，
+// 处理到它时空闲槽位数就是电脑可以立即使用的额度，之后归还的额度都是新的
+void BluetoothManager::bulkTask(void *param)
+{
+    BluetoothManager *manager = (BluetoothManager *)param;
+    uint8_t returned = 0;
+    while (true) {
+        uint8_t index;
+        if (xQueueReceive(manager->bulkReadyQueue, &index, portMAX_DELAY) != pdPASS) {
+            continue;
+        }
+        if (index == BULK_OPEN_MARKER) {
+            returned = 0;
+            uint8_t reply[2] = {MSG_CMD_SUCCESS, (uint8_t)uxQueueMessagesWaiting(manager->bulkFreeQueue)};
+            LOGI("[BLE Bulk] Channel opened, %u credits", reply[1]);
+            manager->sendMessage(MSG_BULK_OPEN, reply, sizeof(reply));
+            continue;
         }
 
-        // 发送数据
-        pCharacteristic->setValue(buffer, length + 3);
-        pCharacteristic->notify();
+        BulkSlot &slot = manager->bulkSlots[index];
+        if (slot.length > 0 && manager->bulkCallback != nullptr) {
+            manager->bulkCallback(slot.data[0], slot.length > 1 ? slot.data + 1 : nullptr, slot.length - 1);
+        }
+        xQueueSend(manager->bulkFreeQueue, &index, 0);
+        returned++;
 
-        delete[] buffer;
-        delay(50);
-        xSemaphoreGive(sendMutex);
+        // 没有发出去（未连接或发送队列满）的额度留到下一次一起归还
+        if (returned >= BULK_CREDIT_BATCH || uxQueueMessagesWaiting(manager->bulkReadyQueue) == 0) {
+            if (manager->sendMessage(MSG_BULK_CREDIT, &returned, 1)) {
+                returned = 0;
+            }
+        }
+    }
+}
+
+bool BluetoothManager::flushBulk(uint32_t timeoutMs)
+{
+    if (bulkFreeQueue == NULL) {
         return true;
     }
-    return false;
+    // 批量任务处理完一块才归还槽位，全部槽位空闲即处理完毕
+    uint32_t start = millis();
+    while (uxQueueMessagesWaiting(bulkFreeQueue) < BULK_SLOT_COUNT) {
+        if (millis() - start >= timeoutMs) {
+            return false;
+        }
+        delay(5);
+    }
+    return true;
+}
+
+BleTxStats BluetoothManager::getTxStats()
+{
+    return txStats;
+}
+
+// 发出一条通知：先等待拥塞解除，再等待协议栈确认接收（ESP_GATTS_CONF_EVT），
+// 发送速度由链路实际情况决定，不再每条固定等待
+bool BluetoothManager::sendNotification(const TxSlot &slot)
+{
+    EventBits_t bits = xEventGroupWaitBits(txEvents, TX_BIT_UNCONGESTED, pdFALSE, pdTRUE, pdMS_TO_TICKS(TX_CONGEST_TIMEOUT_MS));
+    if (!(bits & TX_BIT_UNCONGESTED)) {
+        LOGW("[BLE TX] Link still congested, sending anyway");
+    }
+    if (!deviceConnected || pServer == nullptr || pCharacteristic == nullptr ||
+        pBLE2902 == nullptr || !pBLE2902->getNotifications()) {
+        return false;
+    }
+
+    // 直接从槽位发出，不经过特征值缓冲（setValue 每次都会重新分配）
+    xEventGroupClearBits(txEvents, TX_BIT_CONFIRMED);
+    esp_err_t err = esp_ble_gatts_send_indicate(pServer->getGattsIf(), pServer->getConnId(), pCharacteristic->getHandle(),
+                                                slot.length, (uint8_t *)slot.data, false);
+    if (err != ESP_OK) {
+        LOGW("[BLE TX] Notify failed: %d", err);
+        return false;
+    }
+    bits = xEventGroupWaitBits(txEvents, TX_BIT_CONFIRMED, pdTRUE, pdTRUE, pdMS_TO_TICKS(TX_CONFIRM_TIMEOUT_MS));
+    if (!(bits & TX_BIT_CONFIRMED)) {
+        txStats.confirmTimeouts++;
+    }
+    txStats.sent++;
+    txStats.bytes += slot.length;
+    return true;
+}
+
+void BluetoothManager::txTask(void *param)
+{
+    BluetoothManager *manager = (BluetoothManager *)param;
+    while (true) {
+        uint8_t index;
+        if (xQueueReceive(manager->txReadyQueue, &index, portMAX_DELAY) != pdPASS) {
+            continue;
+        }
+        if (!manager->sendNotification(manager->txSlots[index])) {
+            manager->txStats.dropped++;
+        }
+        xQueueSend(manager->txFreeQueue, &index, 0);
+    }
+}
+
+// 在蓝牙协议栈任务中调用，只设置事件位
+void BluetoothManager::gattsEventHandler(esp_gatts_cb_event_t event, esp_gatt_if_t gattsIf, esp_ble_gatts_cb_param_t *param)
+{
+    BluetoothManager *manager = txOwner;
+    if (manager == nullptr || manager->txEvents == NULL) {
+        return;
+    }
+    switch (event) {
+        case ESP_GATTS_CONF_EVT:
+            // 只处理本特征的通知，键盘的通知也会产生这个事件
+            if (manager->pCharacteristic == nullptr || param->conf.handle != manager->pCharacteristic->getHandle()) {
+                break;
+            }
+            // 状态为 ESP_GATT_CONGESTED 时通知也已经进入协议栈队列，拥塞由 ESP_GATTS_CONGEST_EVT 单独通知
+            xEventGroupSetBits(manager->txEvents, TX_BIT_CONFIRMED);
+            break;
+        case ESP_GATTS_CONGEST_EVT:
+            if (param->congest.congested) {
+                manager->txStats.congested++;
+                xEventGroupClearBits(manager->txEvents, TX_BIT_UNCONGESTED);
+            } else {
+                xEventGroupSetBits(manager->txEvents, TX_BIT_UNCONGESTED);
+            }
+            break;
+        case ESP_GATTS_CONNECT_EVT:
+            manager->connMtu = DEFAULT_MTU;
+            manager->txDataLength = DEFAULT_DATA_LENGTH;
+            manager->rxDataLength = DEFAULT_DATA_LENGTH;
+            manager->connInterval = param->connect.conn_params.interval;
+            manager->connLatency = param->connect.conn_params.latency;
+            memcpy(manager->connAddress, param->connect.remote_bda, sizeof(esp_bd_addr_t));
+            manager->connGranted = profileOf(param->connect.conn_params.interval);
+            manager->connPending = false;
+            manager->connRequested = CONN_PROFILE_NONE;
+            manager->connUpdateRejected = false;
+            manager->requestFastConnection(CONN_CONNECT_HOLD_MS);
+            // 请求最大链路层包长，一个 MTU 的数据在一个链路层包中发出
+            esp_ble_gap_set_pkt_data_len(param->connect.remote_bda, MAX_DATA_LENGTH_REQUEST);
+            break;
+        case ESP_GATTS_MTU_EVT:
+            manager->connMtu = param->mtu.mtu;
+            LOGI("[BLE] MTU negotiated: %u, max payload %u", param->mtu.mtu, manager->maxPayload());
+            break;
+        case ESP_GATTS_DISCONNECT_EVT:
+            manager->connMtu = DEFAULT_MTU;
+            // 断开后不会再有确认事件，放行等待中的发送任务
+            xEventGroupSetBits(manager->txEvents, TX_BIT_CONFIRMED | TX_BIT_UNCONGESTED);
+            break;
+        default:
+            break;
+    }
+}
+
+// 在蓝牙协议栈任务中调用
+void BluetoothManager::gapEventHandler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
+{
+    BluetoothManager *manager = txOwner;
+    if (manager == nullptr) {
+        return;
+    }
+    switch (event) {
+        case ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT:
+            if (param->pkt_data_length_cmpl.status == ESP_BT_STATUS_SUCCESS) {
+                manager->txDataLength = param->pkt_data_length_cmpl.params.tx_len;
+                manager->rxDataLength = param->pkt_data_length_cmpl.params.rx_len;
+            }
+            LOGI("[BLE] Data length: status %d, tx %u, rx %u", param->pkt_data_length_cmpl.status,
+                 param->pkt_data_length_cmpl.params.tx_len, param->pkt_data_length_cmpl.params.rx_len);
+            break;
+        case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT:
+            // 以电脑实际接受的间隔为准；被拒绝或者给的参数与请求不符时，按重试间隔再次请求
+            if (param->update_conn_params.status == ESP_BT_STATUS_SUCCESS) {
+                manager->connInterval = param->update_conn_params.conn_int;
+                manager->connLatency = param->update_conn_params.latency;
+                manager->connGranted = profileOf(param->update_conn_params.conn_int);
+                manager->connUpdateRejected = manager->connGranted != manager->connRequested;
+            } else {
+                manager->connUpdateRejected = true;
+            }
+            manager->connPending = false;
+            LOGI("[BLE] Connection params: status %d, interval %u x1.25ms, latency %u, timeout %u x10ms",
+                 param->update_conn_params.status, param->update_conn_params.conn_int,
+                 param->update_conn_params.latency, param->update_conn_params.timeout);
+            break;
+        case ESP_GAP_BLE_AUTH_CMPL_EVT:
+            // 配对成功时绑定列表可能变化，重连时的加密完成也会触发，只多读一次列表
+            if (param->ble_security.auth_cmpl.success) {
+                manager->bondCacheStale = true;
+            }
+            break;
+        case ESP_GAP_BLE_REMOVE_BOND_DEV_COMPLETE_EVT:
+        case ESP_GAP_BLE_CLEAR_BOND_DEV_COMPLETE_EVT:
+            manager->bondCacheStale = true;
+            break;
+        default:
+            break;
+    }
+}
+
+void BluetoothManager::requestFastConnection(uint32_t holdMs)
+{
+    uint32_t until = millis() + holdMs;
+    if ((int32_t)(until - connFastUntil) > 0) {
+        connFastUntil = until;
+    }
+}
+
+// 连接间隔属于哪一组参数，都不属于时返回 NONE
+BluetoothManager::ConnProfile BluetoothManager::profileOf(uint16_t interval)
+{
+    if (interval >= CONN_FAST_MIN_INTERVAL && interval <= CONN_FAST_MAX_INTERVAL) {
+        return CONN_PROFILE_FAST;
+    }
+    if (interval >= CONN_IDLE_MIN_INTERVAL && interval <= CONN_IDLE_MAX_INTERVAL) {
+        return CONN_PROFILE_IDLE;
+    }
+    return CONN_PROFILE_NONE;
+}
+
+// 按最近的收发情况选择连接参数：有消息往来时立即切到快速参数，空闲超过保持时间后再切回，
+// 保持时间本身就是切换的滞后；两次请求之间至少间隔 CONN_UPDATE_MIN_GAP_MS，被拒绝后等待更久
+// 与链路实际使用的参数（而不是上一次请求的参数）比较，被拒绝的请求在重试间隔后会再次发出
+void BluetoothManager::updateConnectionParams()
+{
+    if (!deviceConnected) {
+        return;
+    }
+    uint32_t now = millis();
+    ConnProfile desired = (int32_t)(connFastUntil - now) > 0 ? CONN_PROFILE_FAST : CONN_PROFILE_IDLE;
+    if (desired == connGranted) {
+        return;
+    }
+    // 等待上一次请求的结果，迟迟没有结果时按被拒绝处理
+    uint32_t gap = connPending || connUpdateRejected ? CONN_UPDATE_RETRY_MS : CONN_UPDATE_MIN_GAP_MS;
+    if (connRequested != CONN_PROFILE_NONE && now - connLastRequest < gap) {
+        return;
+    }
+
+    esp_ble_conn_update_params_t params = {};
+    memcpy(params.bda, connAddress, sizeof(esp_bd_addr_t));
+    if (desired == CONN_PROFILE_FAST) {
+        params.min_int = CONN_FAST_MIN_INTERVAL;
+        params.max_int = CONN_FAST_MAX_INTERVAL;
+        params.latency = CONN_FAST_LATENCY;
+        params.timeout = CONN_FAST_TIMEOUT;
+    } else {
+        params.min_int = CONN_IDLE_MIN_INTERVAL;
+        params.max_int = CONN_IDLE_MAX_INTERVAL;
+        params.latency = CONN_IDLE_LATENCY;
+        params.timeout = CONN_IDLE_TIMEOUT;
+    }
+    connRequested = desired;
+    connLastRequest = now;
+    esp_err_t err = esp_ble_gap_update_conn_params(&params);
+    connPending = err == ESP_OK;
+    connUpdateRejected = err != ESP_OK;
+    LOGD("[BLE] Requesting %s connection params: %d", desired == CONN_PROFILE_FAST ? "fast" : "idle", err);
 }
 
 void BluetoothManager::loop()
 {
     // 检查是否有取消配对的请求
     if (_unpairRequest) {
-        Serial.println("[BluetoothManager] 检测到取消配对请求，开始执行...");
+        LOGI("[BluetoothManager] 检测到取消配对请求，开始执行...");
         _unpairRequest = false;
         unpairDevice();
-        Serial.println("[BluetoothManager] 取消配对操作已完成");
+        LOGI("[BluetoothManager] 取消配对操作已完成");
+    }
+
+    // 绑定列表在协议栈任务中变化，读取列表需要分配内存，放到主循环中
+    if (bondCacheStale) {
+        bondCacheStale = false;
+        refreshBondCache();
     }
 
     // 如果禁用了自动广播，直接返回
@@ -240,6 +797,14 @@ void BluetoothManager::loop()
         return;
     }
 
+    updateConnectionParams();
+
+    // 定向广播超时没有连上（电脑没有在扫描，或者用可解析地址发起连接），停止后改为普通广播
+    if (advertisingDirected && !deviceConnected && millis() - directedAdvStart >= DIRECTED_ADV_TIMEOUT_MS) {
+        LOGI("[BLE] Directed advertising timed out, falling back to undirected");
+        stopAdvertising();
+    }
+
     if(!deviceConnected && !isAdvertising)
     {
         // 如果设备未连接且未在广播中，需要进行广播让设备发现
@@ -251,29 +816,27 @@ void BluetoothManager::loop()
 }
 
 void BluetoothManager::requestUnpairDevice() {
-    Serial.println("[BluetoothManager] 收到取消配对请求，将在主循环中执行");
+    LOGI("[BluetoothManager] 收到取消配对请求，将在主循环中执行");
     _unpairRequest = true;
 }
 
 void BluetoothManager::enableAutoAdvertising(bool enable) {
     _autoAdvertisingEnabled = enable;
-    Serial.printf("自动广播已%s\n", enable ? "启用" : "禁用");
+    LOGI("自动广播已%s", enable ? "启用" : "禁用");
 }
 
 // 修改带参数的onConnect方法实现
 void BluetoothManager::onConnect(BLEServer *pServer, esp_ble_gatts_cb_param_t *param)
 {
-    Serial.print("设备连接耗时：");
-    Serial.println(millis() - recordTime);
+    LOGI("设备连接耗时：%lu", millis() - recordTime);
 
-    // 从param参数中获取客户端地址（仅用于日志显示）
-    BLEAddress clientAddress(param->connect.remote_bda);
-    Serial.print("[onConnect]客户端地址: ");
-    Serial.println(clientAddress.toString().c_str());
+    // 客户端地址仅用于日志显示
+    const uint8_t *bda = param->connect.remote_bda;
+    LOGI("[onConnect]客户端地址: %02x:%02x:%02x:%02x:%02x:%02x", bda[0], bda[1], bda[2], bda[3], bda[4], bda[5]);
 
     // 获取已绑定设备数量
-    int bondedDevNum = esp_ble_get_bond_device_num();
-    Serial.printf("[onConnect]当前已绑定设备数: %d\n", bondedDevNum);
+    int bondedDevNum = getBondedDeviceCount();
+    LOGI("[onConnect]当前已绑定设备数: %d", bondedDevNum);
 
     // 重要：一对一绑定模式
     // 如果已有绑定设备，且是新设备尝试连接，则拒绝
@@ -281,14 +844,14 @@ void BluetoothManager::onConnect(BLEServer *pServer, esp_ble_gatts_cb_param_t *p
         // 已有绑定设备，只允许已绑定设备重连
         // ESP32底层会通过LTK自动校验，如果校验失败会自动断开
         // 这里不需要手动比对地址，ESP32会处理IRK解析
-        Serial.println("[onConnect]已有绑定设备，等待ESP32底层LTK校验...");
+        LOGI("[onConnect]已有绑定设备，等待ESP32底层LTK校验...");
         
         // 注意：在RPA场景下，这里看到的地址可能是随机地址
         // 真正的认证由ESP32底层完成，如果LTK校验失败会自动断开
         // 我们不需要也不应该手动比对地址
     } else {
         // 无绑定设备，处于配对模式，允许新设备配对
-        Serial.println("[onConnect]配对模式：允许新设备配对");
+        LOGI("[onConnect]配对模式：允许新设备配对");
     }
 
     // 允许连接，设置连接状态
@@ -298,7 +861,7 @@ void BluetoothManager::onConnect(BLEServer *pServer, esp_ble_gatts_cb_param_t *p
         xSemaphoreGive(stateMutex);
     }
     
-    Serial.println("[onConnect]客户端已连接，等待加密认证完成");
+    LOGI("[onConnect]客户端已连接，等待加密认证完成");
 
     // 通知BleKeyboard连接状态变化
     notifyKeyboardConnected();
@@ -318,10 +881,11 @@ void BluetoothManager::onConnect(BLEServer *pServer, esp_ble_gatts_cb_param_t *p
         if (isAdvertising)
         {
             // 设置灯为正常
-            fingerprint.setLEDCmd(Fingerprint::LED_CODE_BREATH,0x01,0x01,0x00);
+            ledManager.requestLedEffect(Fingerprint::LED_CODE_BREATH,0x01,0x01,0x00);
             // 系统默认会停止不需要手动停止，只需要设置标记
             isAdvertising = false;
-            if(touchTriggered)
+            advertisingDirected = false;
+            if(unlockManager.isUnlockInProgress())
             {
                 xEventGroupSetBits(event_group, EVENT_BIT_BLE_CONNECTED);
             }
@@ -341,7 +905,9 @@ void BluetoothManager::onDisconnect(BLEServer *pServer)
         xSemaphoreGive(stateMutex);
     }
 
-    Serial.println("[onDisconnect]客户端已断开连接");
+    LOGI("[onDisconnect]客户端已断开连接");
+    rxActive = false; // 丢弃未完成的分片消息
+    directedAdvPending = true; // 重新广播时先尝试定向广播
 
     // 先清除客户端地址，防止后续访问野指针
     if (stateMutex && xSemaphoreTake(stateMutex, portMAX_DELAY) == pdTRUE) {
@@ -393,6 +959,14 @@ void BluetoothManager::onWrite(BLECharacteristic *pCharacteristic)
     }
 
     String value = pCharacteristic->getValue();
+    requestFastConnection();
+
+    // 批量数据不经过消息队列，不会阻塞控制消息
+    if (pCharacteristic == pBulkCharacteristic)
+    {
+        receiveBulk((const uint8_t *)value.c_str(), value.length());
+        return;
+    }
 
     if (value.length() > 0 && messageCallback != nullptr)
     {
@@ -406,34 +980,98 @@ void BluetoothManager::onWrite(BLECharacteristic *pCharacteristic)
             length = value.length() - 1;
         }
 
+        // 打开批量通道由批量任务应答，保证应答中的额度不包含还没处理的数据块
+        if (msgType == MSG_BULK_OPEN)
+        {
+            uint8_t marker = BULK_OPEN_MARKER;
+            if (bulkReadyQueue == NULL || xQueueSend(bulkReadyQueue, &marker, 0) != pdPASS)
+            {
+                LOGW("[BLE Bulk] Open request dropped");
+            }
+            return;
+        }
+
+        // 分片在这里重组，完整后再交给回调
+        if (msgType == MSG_FRAGMENT)
+        {
+            receiveFragment(data, length);
+            return;
+        }
+
         // 调用回调函数处理其他消息
         messageCallback(msgType, data, length);
     }
 }
 
+void BluetoothManager::receiveFragment(const uint8_t *data, size_t length)
+{
+    if (length < 2)
+    {
+        return;
+    }
+    uint8_t flags = data[0];
+    uint8_t seq = data[1];
+    data += 2;
+    length -= 2;
+
+    if (flags & FRAGMENT_FLAG_FIRST)
+    {
+        if (rxActive)
+        {
+            LOGW("[BLE RX] Incomplete message dropped, %u bytes", rxLength);
+        }
+        rxActive = true;
+        rxLength = 0;
+    }
+    else if (!rxActive || seq != rxNextSeq)
+    {
+        LOGW("[BLE RX] Fragment %u out of sequence, expected %u", seq, rxNextSeq);
+        rxActive = false;
+        return;
+    }
+    if (rxLength + length > sizeof(rxBuffer))
+    {
+        LOGW("[BLE RX] Message too large, dropped");
+        rxActive = false;
+        return;
+    }
+    memcpy(rxBuffer + rxLength, data, length);
+    rxLength += length;
+    rxNextSeq = seq + 1;
+
+    if ((flags & FRAGMENT_FLAG_LAST) && rxLength > 0)
+    {
+        rxActive = false;
+        LOGD("[BLE RX] Reassembled message 0x%02X, %u bytes", rxBuffer[0], rxLength - 1);
+        messageCallback(rxBuffer[0], rxLength > 1 ? rxBuffer + 1 : nullptr, rxLength - 1);
+    }
+}
+
 bool BluetoothManager::connectToPairedDevice()
 {
     // BLE外设模式不需要主动连接，等待中心设备（电脑）连接即可
     // 只需要检查是否有已绑定的设备
-    int bondedDevNum = esp_ble_get_bond_device_num();
+    int bondedDevNum = getBondedDeviceCount();
     
     if (bondedDevNum > 0) {
-        Serial.printf("检测到 %d 个已绑定设备，等待其连接\n", bondedDevNum);
+        LOGI("检测到 %d 个已绑定设备，等待其连接", bondedDevNum);
         
-        // 打印已绑定设备列表
-        esp_ble_bond_dev_t *bond_dev_list = (esp_ble_bond_dev_t *)malloc(sizeof(esp_ble_bond_dev_t) * bondedDevNum);
-        if (bond_dev_list != nullptr) {
-            esp_ble_get_bond_device_list(&bondedDevNum, bond_dev_list);
-            for (int i = 0; i < bondedDevNum; i++) {
-                BLEAddress bondedAddr(bond_dev_list[i].bd_addr);
-                Serial.printf("已绑定设备 %d: %s\n", i, bondedAddr.toString().c_str());
-            }
-            free(bond_dev_list);
+        // 打印缓存的已绑定设备地址
+        BondedPeer peers[MAX_CACHED_PEERS];
+        int count = 0;
+        if (stateMutex && xSemaphoreTake(stateMutex, portMAX_DELAY) == pdTRUE) {
+            count = bondedPeerCount;
+            memcpy(peers, bondedPeers, sizeof(BondedPeer) * count);
+            xSemaphoreGive(stateMutex);
+        }
+        for (int i = 0; i < count; i++) {
+            LOGI("已绑定设备 %d: %02x:%02x:%02x:%02x:%02x:%02x", i, peers[i].address[0], peers[i].address[1],
+                 peers[i].address[2], peers[i].address[3], peers[i].address[4], peers[i].address[5]);
         }
         return true;
     }
     
-    Serial.println("没有已绑定的设备");
+    LOGI("没有已绑定的设备");
     return false;
 }
 
@@ -441,6 +1079,12 @@ void BluetoothManager::clearPairedDevices()
 {
     // 清除保存的配对信息（包括BLE底层绑定）
     configManager.clearPairedDevices();
+    // 删除绑定是异步的，先清空缓存，避免删除完成之前按旧的绑定定向广播；删除完成的事件会再刷新
+    if (stateMutex && xSemaphoreTake(stateMutex, portMAX_DELAY) == pdTRUE) {
+        bondedPeerCount = 0;
+        bondedDeviceCount = 0;
+        xSemaphoreGive(stateMutex);
+    }
     Serial.println("已清除所有配对设备信息");
 }
 
@@ -498,6 +1142,7 @@ void BluetoothManager::disconnectCurrentDevice()
     if (deviceConnected && pServer != nullptr && pClientAddress != nullptr)
     {
         Serial.println("主动断开当前蓝牙连接");
+        flushMessages(500); // 先发出队列中的消息
         pServer->disconnect(0); // 0为默认conn_id，实际可遍历连接id
 
         // std::map<uint16_t, conn_status_t> devices = pServer->getPeerDevices(true);
@@ -532,6 +1177,7 @@ void BluetoothManager::reinitBLE(const char* devName)
     Serial.println("[reinitBLE]重新初始化BLE");
     BLEDevice::init(devName);
     BLEDevice::setMTU(251);
+    refreshBondCache();
     
     // 强制清理之前的pServer指针（如果还有残留），防止内存泄漏
     if (pServer != nullptr) {
@@ -570,6 +1216,11 @@ void BluetoothManager::reinitBLE(const char* devName)
     pBLE2902 = new BLE2902();
     pCharacteristic->addDescriptor(pBLE2902);
     pCharacteristic->setCallbacks(this);
+
+    pBulkCharacteristic = pService->createCharacteristic(
+        BULK_CHARACTERISTIC_UUID,
+        BLECharacteristic::PROPERTY_WRITE_NR);
+    pBulkCharacteristic->setCallbacks(this);
     
     // 6. 重新初始化HID服务
     Serial.println("[reinitBLE]重启HID...");
@@ -613,12 +1264,12 @@ void BluetoothManager::unpairDevice()
     //reinitBLE(deviceName.c_str());
     
     // 4. 清除后，自动进入配对模式（因为bondedCount=0）
-    int bondedNum = esp_ble_get_bond_device_num();
+    int bondedNum = getBondedDeviceCount();
     Serial.printf("配对已清除，当前绑定设备数: %d\n", bondedNum);
     Serial.println("已进入配对模式，可接受新设备配对");
     
     // 5. 设置LED为白色闪烁（配对模式指示）
-    fingerprint.setLEDCmd(Fingerprint::LED_CODE_BLINK,0x07,(uint8_t)( (5 << 4) | 5 ), 0x00, 8);
+    ledManager.requestLedEffect(Fingerprint::LED_CODE_BLINK,0x07,(uint8_t)( (5 << 4) | 5 ), 0x00, 8);
     
     // 恢复自动广播（一定要在 startAdvertising 之前恢复，或者确保 startAdvertising 能工作）
     enableAutoAdvertising(true);
@@ -645,5 +1296,5 @@ void BluetoothManager::setBatteryLevel(uint8_t level) {
     if (pBleKeyboard != nullptr) {
         pBleKeyboard->setBatteryLevel(level);
     }
-    Serial.printf("设置电池电量: %d%%\n", level);
+    LOGI("设置电池电量: %d%%", level);
 }
\ No newline at end of file
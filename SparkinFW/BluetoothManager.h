@@ -20,6 +20,8 @@
 // 定义服务和特征的UUID
 #define SERVICE_UUID        "4fafc201-1fb5-459e-8fcc-c5c9c331914b"
 #define CHARACTERISTIC_UUID "beb5483e-36e1-4688-b7f5-ea07361b26a8"
+// 批量数据特征：只接受无响应写入，用于固件升级和模板导入的数据块，控制消息仍走上面的特征
+#define BULK_CHARACTERISTIC_UUID "beb5483f-36e1-4688-b7f5-ea07361b26a8"
 
 // 定义消息类型
 static const uint8_t MSG_FINGERPRINT_SEARCH = 0x01;  // 指纹识别成功
@@ -40,9 +42,40 @@ static const uint8_t MSG_FIRMWARE_UPDATE_START = 0x24; //开始固件升级
 static const uint8_t MSG_FIRMWARE_UPDATE_CHUNK = 0x25; //传输固件块
 static const uint8_t MSG_FIRMWARE_UPDATE_END = 0x26; ///固件升级结束
 static const uint8_t MSG_CHECK_SLEEP = 0x27; // 检查可否现在进行休眠，返回UI界面是否打开的状态
+static const uint8_t MSG_SET_MATCH_MODE = 0x28; // 设置指纹比对方式（0分步搜索，1自动验证）
+static const uint8_t MSG_TEMPLATE_EXPORT = 0x29; // 导出全部指纹模板，结束时返回结果和模板数量
+static const uint8_t MSG_TEMPLATE_DATA = 0x2A;   // 导出的模板数据块 [id, flags, data]
+static const uint8_t MSG_TEMPLATE_IMPORT = 0x2B; // 导入模板数据块 [id, flags, data]，每块返回结果
+static const uint8_t MSG_SET_SENSOR_POWER = 0x2C; // 设置休眠时指纹模组供电策略（0断电，1模组休眠）
+static const uint8_t MSG_TRACE_STATS = 0x2D; // 读取模组指令耗时统计 [flags]，结束时返回结果和指令数量
+static const uint8_t MSG_TRACE_DATA = 0x2E;  // 单个指令的耗时统计 MsgTraceHistogram
+static const uint8_t MSG_SET_REARM_INTERVAL = 0x2F; // 设置比对结束后重新接受触摸的最小间隔 [ms高, ms低]
+static const uint8_t MSG_IMAGE_UPLOAD = 0x30; // 诊断：采图并上传原始图像 [flags]，结束时返回 MsgImageResult
+static const uint8_t MSG_IMAGE_DATA = 0x31;   // 原始图像数据块 [序号, data]
+static const uint8_t MSG_TX_BENCHMARK = 0x32; // 通知发送吞吐量测试 [数量高, 数量低, 长度]，结束时返回 MsgTxBenchmark
+static const uint8_t MSG_TX_BENCHMARK_DATA = 0x33; // 吞吐量测试数据 [序号高, 序号低, 填充]
+static const uint8_t MSG_BULK_OPEN = 0x34;   // 打开批量数据通道，返回 [结果, 初始额度]
+static const uint8_t MSG_BULK_CREDIT = 0x35; // 批量数据通道归还的额度 [额度]
+
+// 耗时统计请求标志
+static const uint8_t TRACE_FLAG_RESET = 0x01; // 读取后清除统计
+
+// 图像上传标志
+static const uint8_t IMAGE_FLAG_RLE = 0x01; // 图像数据按 PackBits 压缩
+
+// 模板数据块标志
+static const uint8_t TEMPLATE_FLAG_FIRST = 0x01; // 模板的第一块
+static const uint8_t TEMPLATE_FLAG_LAST = 0x02;  // 模板的最后一块
 
 static const uint8_t MSG_REST_ALL = 0x99; // 恢复出厂设置
 
+// 超过一条通知或一次写入长度的消息拆成分片传输，两个方向格式相同：
+// 分片消息的数据为 [flags, 序号, 原消息的一段]，原消息按原有格式（发往电脑为 [类型, 长度高, 长度低, data]，
+// 来自电脑为 [类型, data]）依次切分，序号每个分片加1，接收端按序号检查丢片
+static const uint8_t MSG_FRAGMENT = 0xF0;
+static const uint8_t FRAGMENT_FLAG_FIRST = 0x01; // 消息的第一个分片
+static const uint8_t FRAGMENT_FLAG_LAST = 0x02;  // 消息的最后一个分片
+
 // 定义消息值
 static const uint8_t MSG_CMD_SUCCESS = 0xA1;  // 成功
 static const uint8_t MSG_CMD_FAILURE = 0xA0; // 失败
@@ -62,6 +95,63 @@ typedef struct {
   char firmwareVer[10];
 } MsgInfo;
 
+// 跟在 MsgInfo 之后返回，旧版本电脑端忽略多出的部分
+typedef struct {
+  uint16_t mtu;          // 协商的ATT MTU
+  uint16_t maxPayload;   // 一条通知或一次写入的最大长度（MTU 减去ATT头）
+  uint16_t txDataLength; // 链路层每包发送字节数（LE Data Length）
+  uint16_t rxDataLength; // 链路层每包接收字节数
+  uint16_t connInterval; // 当前连接间隔（1.25ms）
+  uint16_t connLatency;  // 当前从机延迟（可跳过的连接事件数）
+} MsgLinkInfo;
+
+typedef struct {
+  uint8_t result;       // 1：成功，保持与只有一个字节的旧消息兼容
+  uint16_t templateId;  // 匹配的模板ID
+  uint16_t score;       // 匹配得分
+  uint8_t attempts;     // 采图次数
+  uint8_t matchMode;    // 比对方式
+  uint16_t captureMs;   // 采图耗时
+  uint16_t extractMs;   // 生成特征耗时
+  uint16_t searchMs;    // 搜索耗时
+  uint16_t totalMs;     // 比对总耗时
+} MsgMatchResult;
+
+typedef struct {
+  uint8_t cmd;          // 模组指令码
+  uint32_t count;       // 指令次数
+  uint32_t timeouts;    // 没有应答的次数
+  uint32_t errors;      // 确认码不为0的次数
+  uint32_t totalMs;     // 累计耗时
+  uint32_t maxMs;       // 最大耗时
+  uint16_t buckets[12]; // 按毫秒对数分桶：<1 <2 <4 ... <1024 >=1024
+} MsgTraceHistogram;
+
+typedef struct {
+  uint8_t result;       // MSG_CMD_SUCCESS / MSG_CMD_FAILURE
+  uint8_t flags;        // 数据块的格式（IMAGE_FLAG_RLE）
+  uint8_t captureCode;  // 采图确认码
+  uint8_t featureCode;  // 生成特征确认码，反映图像质量
+  uint32_t imageBytes;  // 原始图像长度
+  uint32_t sentBytes;   // 数据块中的数据总长度（压缩后）
+  uint16_t chunks;      // 数据块数量
+  uint16_t captureMs;   // 等待手指并采图的耗时
+  uint16_t uploadMs;    // 模组上传图像的耗时
+  uint16_t totalMs;     // 从收到请求到最后一块发出的耗时
+} MsgImageResult;
+
+typedef struct {
+  uint8_t result;        // MSG_CMD_SUCCESS / MSG_CMD_FAILURE
+  uint16_t count;        // 成功入队的消息数量
+  uint32_t bytes;        // 发出的总字节数（含消息头）
+  uint32_t elapsedMs;    // 从第一条入队到全部发出的耗时
+  uint32_t messagesPerSec;
+  uint32_t bytesPerSec;
+  uint32_t queueFull;    // 入队时发送队列已满的次数
+  uint32_t congested;    // 协议栈拥塞次数
+  uint32_t confirmTimeouts; // 等待协议栈确认超时的次数
+} MsgTxBenchmark;
+
 typedef struct 
 {
   uint8_t index;
@@ -73,11 +163,30 @@ typedef struct
 // 回调函数类型定义
 typedef void (*MessageCallback)(uint8_t msgType, uint8_t* data, size_t length);
 
+// 消息入队结果
+enum BleSendStatus {
+    BLE_SEND_OK = 0,
+    BLE_SEND_NOT_CONNECTED, // 未连接或发送任务未启动
+    BLE_SEND_QUEUE_FULL,    // 等待时间内没有空闲槽位
+    BLE_SEND_TOO_LARGE,     // 消息超过一条通知的长度
+};
+
+// 发送统计（累计值）
+struct BleTxStats {
+    uint32_t sent;            // 交给协议栈的通知数量
+    uint32_t bytes;           // 交给协议栈的总字节数
+    uint32_t queueFull;       // 入队时没有空闲槽位的次数
+    uint32_t congested;       // 协议栈报告拥塞的次数
+    uint32_t confirmTimeouts; // 等待协议栈确认超时的次数
+    uint32_t dropped;         // 断开或未订阅时丢弃的消息数量
+};
+
 class BluetoothManager : public BLEServerCallbacks, public BLECharacteristicCallbacks {
 private:
     BLEServer* pServer;
     BLEService* pService;
     BLECharacteristic* pCharacteristic;
+    BLECharacteristic* pBulkCharacteristic; // 批量数据特征
     BLE2902* pBLE2902;
     BleKeyboard* pBleKeyboard;  // 添加BleKeyboard指针
     
@@ -88,9 +197,123 @@ private:
     bool autoReconnect;       // 是否自动重连
     bool isAdvertising;       // 是否正在广播
     String deviceName;        // 保存设备名称，用于重新初始化
-    // 在BluetoothManager.h中修改onConnect方法声明
-    SemaphoreHandle_t sendMutex;
     SemaphoreHandle_t stateMutex; // 添加状态互斥锁
+
+public:
+    static const uint8_t TX_SLOT_COUNT = 8;            // 发送槽位数量
+    static const size_t TX_SLOT_SIZE = 248;            // 单个槽位长度（MTU 251 减去ATT头），含3字节消息头
+    static const uint32_t TX_SEND_WAIT_MS = 2000;      // sendMessage 等待空闲槽位的最长时间
+    static const uint32_t TX_CONFIRM_TIMEOUT_MS = 100; // 等待协议栈接收一条通知的最长时间
+    static const uint32_t TX_CONGEST_TIMEOUT_MS = 2000; // 等待拥塞解除的最长时间
+    static const size_t MAX_MESSAGE_SIZE = 2048;       // 分片传输的单条消息最大数据长度（两个方向）
+    static const uint16_t DEFAULT_MTU = 23;            // 协商之前的ATT MTU
+    static const uint16_t DEFAULT_DATA_LENGTH = 27;    // 协商之前的链路层每包字节数
+    static const uint16_t MAX_DATA_LENGTH_REQUEST = 251; // 连接后请求的链路层每包字节数
+
+    // 连接参数：传输期间使用短间隔、零延迟，空闲时使用长间隔并允许跳过连接事件以降低功耗
+    static const uint16_t CONN_FAST_MIN_INTERVAL = 6;   // 7.5ms（单位1.25ms）
+    static const uint16_t CONN_FAST_MAX_INTERVAL = 12;  // 15ms
+    static const uint16_t CONN_FAST_LATENCY = 0;
+    static const uint16_t CONN_FAST_TIMEOUT = 400;      // 4s（单位10ms）
+    static const uint16_t CONN_IDLE_MIN_INTERVAL = 48;  // 60ms
+    static const uint16_t CONN_IDLE_MAX_INTERVAL = 80;  // 100ms
+    static const uint16_t CONN_IDLE_LATENCY = 4;        // 空闲时最长500ms响应一次
+    static const uint16_t CONN_IDLE_TIMEOUT = 600;      // 6s，需大于 (1+延迟)*最大间隔*2
+    static const uint32_t CONN_BURST_HOLD_MS = 3000;    // 每次收发消息后保持快速参数的时间
+    static const uint32_t CONN_CONNECT_HOLD_MS = 5000;  // 连接后（服务发现、订阅、解锁握手）保持快速参数的时间
+    static const uint32_t CONN_UPDATE_MIN_GAP_MS = 1000; // 两次参数更新请求的最小间隔
+    static const uint32_t CONN_UPDATE_RETRY_MS = 10000;  // 电脑拒绝更新后再次请求的间隔
+
+    // 批量数据通道：电脑每次无响应写入消耗一个额度，设备处理完数据块后归还额度
+    static const uint8_t BULK_SLOT_COUNT = 8;          // 接收槽位数量，即额度窗口
+    static const size_t BULK_SLOT_SIZE = TX_SLOT_SIZE; // 一次写入的最大长度（含1字节消息类型）
+    static const uint8_t BULK_CREDIT_BATCH = 4;        // 攒够这么多额度再归还，队列处理空时立即归还
+
+    static const uint8_t MAX_CACHED_PEERS = 4;            // 缓存的绑定设备地址数量（一对一绑定，通常只有一个）
+    static const uint32_t DIRECTED_ADV_TIMEOUT_MS = 1300; // 高占空比定向广播最长1.28s，之后改为普通广播
+
+private:
+    // 发送槽位：预先分配，空闲槽位和待发槽位的下标分别在两个队列中流转，发送时不分配内存
+    struct TxSlot {
+        uint16_t length;
+        uint8_t data[TX_SLOT_SIZE];
+    };
+    TxSlot txSlots[TX_SLOT_COUNT];
+    QueueHandle_t txFreeQueue;
+    QueueHandle_t txReadyQueue;
+    EventGroupHandle_t txEvents;
+    SemaphoreHandle_t txFragmentMutex; // 保证一条消息的分片连续入队
+    uint8_t txFragmentSeq;
+    BleTxStats txStats;
+
+    // 接收分片重组，只在协议栈的写入回调中访问
+    uint8_t rxBuffer[1 + MAX_MESSAGE_SIZE];
+    size_t rxLength;
+    uint8_t rxNextSeq;
+    bool rxActive;
+
+    // 批量数据接收槽位，流转方式与发送槽位相同；写入回调只复制数据，由批量任务按顺序处理
+    struct BulkSlot {
+        uint16_t length;
+        uint8_t data[BULK_SLOT_SIZE];
+    };
+    static const uint8_t BULK_OPEN_MARKER = 0xFF; // 放入待处理队列，表示电脑请求打开通道
+    BulkSlot bulkSlots[BULK_SLOT_COUNT];
+    QueueHandle_t bulkFreeQueue;
+    QueueHandle_t bulkReadyQueue;
+    MessageCallback bulkCallback;
+    uint32_t bulkOverruns; // 电脑超出额度写入、被丢弃的数据块数量
+
+    // 当前连接协商的参数，在协议栈事件中更新
+    volatile uint16_t connMtu;
+    volatile uint16_t txDataLength;
+    volatile uint16_t rxDataLength;
+    volatile uint16_t connInterval;
+    volatile uint16_t connLatency;
+
+    // 连接参数管理，只在 loop() 中请求更新
+    enum ConnProfile {
+        CONN_PROFILE_NONE = 0, // 连接建立时电脑选择的参数
+        CONN_PROFILE_FAST,
+        CONN_PROFILE_IDLE,
+    };
+    esp_bd_addr_t connAddress;
+    volatile uint32_t connFastUntil;   // 在这个时间之前使用快速参数
+    volatile bool connUpdateRejected;  // 电脑拒绝了上一次更新，或者给的参数与请求不符
+    volatile ConnProfile connGranted;  // 链路实际使用的参数，按电脑接受的连接间隔判断
+    volatile bool connPending;         // 更新请求已发出，还没有收到结果
+    ConnProfile connRequested;         // 最近一次请求的参数，NONE 表示本次连接还没有请求过
+    uint32_t connLastRequest;
+    void updateConnectionParams();
+    static ConnProfile profileOf(uint16_t interval);
+
+    // 绑定设备缓存：启动时读取，绑定变化的事件中刷新，查询时不再访问协议栈的绑定存储
+    struct BondedPeer {
+        esp_bd_addr_t address;           // 电脑分发了身份地址时为身份地址
+        esp_ble_addr_type_t addressType;
+    };
+    BondedPeer bondedPeers[MAX_CACHED_PEERS];
+    int bondedPeerCount;                 // 缓存的地址数量
+    volatile int bondedDeviceCount;      // 绑定设备总数
+    bool directedAdvPending;             // 启动或断开后先尝试一次定向广播
+    bool advertisingDirected;            // 当前是定向广播
+    uint32_t directedAdvStart;
+    volatile bool bondCacheStale;        // 绑定变化的事件中置位，在主循环中刷新缓存
+    void refreshBondCache();
+    bool getBondedPeer(BondedPeer &peer);
+    bool startDirectedAdvertising(const BondedPeer &peer);
+
+    void initTxQueue();
+    bool takeTxSlot(uint8_t &index, uint32_t waitMs);
+    BleSendStatus enqueueFragments(const uint8_t msgType, const uint8_t* data, size_t length, uint32_t waitMs);
+    void receiveFragment(const uint8_t* data, size_t length);
+    void initBulkChannel();
+    void receiveBulk(const uint8_t* data, size_t length);
+    static void bulkTask(void *param);
+    bool sendNotification(const TxSlot &slot);
+    static void txTask(void *param);
+    static void gattsEventHandler(esp_gatts_cb_event_t event, esp_gatt_if_t gattsIf, esp_ble_gatts_cb_param_t *param);
+    static void gapEventHandler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
     
 private:
     // BLEServerCallbacks接口实现
@@ -113,9 +336,39 @@ public:
     
     // 设置消息回调函数
     void setMessageCallback(MessageCallback callback);
+    // 设置批量数据通道的回调函数，在批量任务中按到达顺序调用，数据只在回调期间有效
+    void setBulkCallback(MessageCallback callback);
     
-    // 发送消息
+    // 消息放入发送队列后立即返回，由发送任务按协议栈的拥塞和确认事件依次发出
+    // waitMs 为没有空闲槽位时的最长等待时间，默认不等待；超过一条通知的消息自动分片，
+    // 不等待时需要全部分片都有空闲槽位
+    BleSendStatus enqueueMessage(const uint8_t msgType, const uint8_t* data = nullptr, size_t length = 0, uint32_t waitMs = 0);
+
+    // 发送消息：队列满时最多等待 TX_SEND_WAIT_MS，批量发送时按发送速度自然限速
     bool sendMessage(const uint8_t msgType, const uint8_t* data = nullptr, size_t length = 0);
+
+    // 等待队列中的消息全部交给协议栈（重启、断开之前调用）
+    bool flushMessages(uint32_t timeoutMs);
+
+    // 等待批量通道中已收到的数据块全部处理完（处理通道之外的结束命令之前调用）
+    bool flushBulk(uint32_t timeoutMs);
+
+    // 发送统计
+    BleTxStats getTxStats();
+
+    // 当前连接协商的ATT MTU
+    uint16_t getMtu() { return connMtu; }
+    // 一条通知的最大长度，消息（含3字节消息头）超过这个长度时分片发送；批量数据按这个长度分块
+    uint16_t maxPayload() { return min((size_t)(connMtu - 3), TX_SLOT_SIZE); }
+    // 链路层每包字节数
+    uint16_t getTxDataLength() { return txDataLength; }
+    uint16_t getRxDataLength() { return rxDataLength; }
+    // 当前连接间隔（1.25ms）和从机延迟
+    uint16_t getConnInterval() { return connInterval; }
+    uint16_t getConnLatency() { return connLatency; }
+
+    // 在接下来 holdMs 内使用快速连接参数；收发消息时自动调用，没有消息往来的长操作（如注册）需要定期调用
+    void requestFastConnection(uint32_t holdMs = CONN_BURST_HOLD_MS);
     
     // 处理蓝牙事件，需要在loop中调用
     void loop();
@@ -146,14 +399,14 @@ public:
     // 清除已保存的配对信息
     void clearPairedDevices();
     
-    // 获取已绑定设备数量
+    // 获取已绑定设备数量（读取缓存）
     int getBondedDeviceCount() {
-        return esp_ble_get_bond_device_num();
+        return bondedDeviceCount;
     }
     
     // 检查是否处于配对模式（动态判断：无绑定设备=配对模式）
     bool isPairingMode() {
-        return (esp_ble_get_bond_device_num() == 0);
+        return bondedDeviceCount == 0;
     }
     
     // 开始广播
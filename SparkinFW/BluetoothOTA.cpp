@@ -5,6 +5,7 @@
  */
 #include "BluetoothOTA.h"
 #include <rom/crc.h>
+#include "Log.h"
 
 BluetoothOTA::BluetoothOTA() {
     update_partition = nullptr;
@@ -82,23 +83,23 @@ bool BluetoothOTA::receiveData(const uint8_t *data, size_t length)
 {
     if (!update_handle)
     {
-        Serial.println("ERROR: OTA not started");
+        LOGE("ERROR: OTA not started");
         return false;
     }
     if (!decompress_buffer)
     {
-        Serial.println("ERROR: Decompress buffer invalid");
+        LOGE("ERROR: Decompress buffer invalid");
         return false;
     }
     if (!data || length == 0)
     {
-        Serial.println("ERROR: Invalid data (null or 0 length)");
+        LOGE("ERROR: Invalid data (null or 0 length)");
         return false;
     }
 
     /* 1. 统计进度 */
     bytes_received += length;
-    Serial.println("Received data chunk, size: " + String(length) + ", total received: " + String(bytes_received) + "/" + String(bytes_total));
+    LOGD("Received data chunk, size: %u, total received: %u/%u", length, bytes_received, bytes_total);
 
     // 判断是否最后一块，设置flag
     uint32_t flags = 0;
@@ -123,7 +124,7 @@ bool BluetoothOTA::receiveData(const uint8_t *data, size_t length)
             memmove(decompress_buffer, decompress_buffer_pos - TINFL_LZ_DICT_SIZE, TINFL_LZ_DICT_SIZE);
             decompress_buffer_pos = decompress_buffer + TINFL_LZ_DICT_SIZE; // 更新写指针位置
             out_size = DECOMPRESS_EXTRA_SIZE;
-            Serial.printf("Free space insufficient %d. Moved 32K bytes\n", decompress_free_space);
+            LOGD("Free space insufficient %d. Moved 32K bytes", decompress_free_space);
         }
 
         size_t in_consumed = length - in_pos;
@@ -141,7 +142,7 @@ bool BluetoothOTA::receiveData(const uint8_t *data, size_t length)
         //              status, in_consumed, out_size);
         if (status < TINFL_STATUS_DONE)
         {
-            Serial.printf("Decompress failed with status: %d\n", status);
+            LOGE("Decompress failed with status: %d", status);
             return false;
         }
 
@@ -176,7 +177,7 @@ bool BluetoothOTA::receiveData(const uint8_t *data, size_t length)
             esp_err_t err = esp_ota_write(update_handle, decompress_buffer_pos, out_size);
             if (err != ESP_OK)
             {
-                Serial.printf("OTA write failed: %s\n", esp_err_to_name(err));
+                LOGE("OTA write failed: %s", esp_err_to_name(err));
                 return false;
             }
         }
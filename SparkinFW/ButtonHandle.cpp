@@ -4,6 +4,7 @@
  * All rights reserved
  */
 #include "ButtonHandle.h"
+#include "LedManager.h"
 #include "ConfigManager.h"
 #include "BluetoothManager.h"
 #include "Fingerprint.h"
@@ -14,6 +15,7 @@
 extern BluetoothManager bluetoothManager;
 extern ConfigManager configManager;
 extern Fingerprint fingerprint;
+extern LedManager ledManager;
 extern SleepManager sleepManager;
 ButtonTimer buttonTimer;
 
@@ -122,7 +124,7 @@ void ButtonHandler::buttonTask(void *pvParameters)
             configManager.clear();
             bluetoothManager.unpairDevice();
             fingerprint.clearAllLib();
-            fingerprint.setLEDCmd(Fingerprint::LED_CODE_OFF,0,0,0x00);  // 关闭灯
+            ledManager.requestLedEffect(Fingerprint::LED_CODE_OFF,0,0,0x00);  // 关闭灯
             Serial.println("[ButtonHandler] 已恢复出厂设置，设备可被发现");
         }
         else if (notifyValue & BUTTON_RELEASE_10S)
@@ -5,12 +5,33 @@
  */
 #include "Common.h"
 
- // 中断标志变量
-volatile bool touchTriggered = false;
+// 触摸事件队列，长度1，未处理的触摸只保留最新一次
+QueueHandle_t touch_queue = NULL;
 
-// 触摸传感器中断处理函数
+// 触摸传感器中断处理函数，直接唤醒指纹任务
 void IRAM_ATTR handleTouchInterrupt() {
-  touchTriggered = true; // 设置中断标志
+  if (touch_queue == NULL) {
+    return;
+  }
+  TouchEvent event;
+  event.timestamp = touchClockMs();
+  BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+  xQueueOverwriteFromISR(touch_queue, &event, &xHigherPriorityTaskWoken);
+  portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+void postTouchEvent(uint32_t timestamp) {
+  if (touch_queue == NULL) {
+    return;
+  }
+  TouchEvent event;
+  event.timestamp = timestamp;
+  xQueueOverwrite(touch_queue, &event);
+}
+
+// 初始化触摸事件队列
+void init_touch_queue() {
+    touch_queue = xQueueCreate(1, sizeof(TouchEvent));
 }
 
 // 事件组句柄
@@ -7,6 +7,7 @@
 #define COMMON_H
 #pragma once
 #include <Arduino.h>
+#include <esp_timer.h>
 
 #define MAX_FINGERPRINT_NUM 50 // 最大的指纹数量
 #define INDEX_TABLE_LENGTH  32 // 索引表长度
@@ -22,12 +23,27 @@
 extern "C" {
 #endif
 
+// 触摸事件，由中断投递给指纹任务
+typedef struct {
+    uint32_t timestamp; // 触摸发生时间（毫秒，touchClockMs）
+} TouchEvent;
+
+// 触摸事件的时钟（毫秒）：中断、唤醒投递和指纹任务的抬起判断都用它比较时间
+// esp_timer 在中断中可以读取，轻度睡眠期间也继续计时；FreeRTOS tick 在手动轻度睡眠时不保证前进，不能混用
+static inline uint32_t touchClockMs() {
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
 extern EventGroupHandle_t event_group;
-extern volatile bool touchTriggered;
+extern QueueHandle_t touch_queue;
 // bPairMode已移除，改用 bluetoothManager.isPairingMode() 动态判断
 extern float batteryPercentage; // 电池电量百分比
 
 void IRAM_ATTR handleTouchInterrupt();
+// 在任务上下文中投递一次触摸事件（如触摸唤醒），timestamp 为触摸发生时间
+void postTouchEvent(uint32_t timestamp);
+
+void init_touch_queue();
 
 void init_event_group();
 
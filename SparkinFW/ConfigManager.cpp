@@ -9,6 +9,12 @@
 const char* ConfigManager::NAMESPACE = "sparkin";
 const char* ConfigManager::SLEEP_TIMEOUT_KEY = "sleep_time";
 const char* ConfigManager::BLE_ADDRESS_KEY = "ble_addr";
+const char* ConfigManager::MATCH_MODE_KEY = "match_mode";
+const char* ConfigManager::FINGERPRINT_BAUD_KEY = "fp_baud";
+const char* ConfigManager::HOT_SEARCH_KEY = "hot_search";
+const char* ConfigManager::SENSOR_POWER_KEY = "fp_power";
+const char* ConfigManager::REARM_INTERVAL_KEY = "fp_rearm";
+const char* ConfigManager::FINGERPRINT_USAGE_KEY = "fp_usage";
 const char* ConfigManager::FINGERPRINT_NAME_KEY_PREFIX = "fp_name_";
 
 ConfigManager::ConfigManager() {}
@@ -27,6 +33,25 @@ void ConfigManager::load()
     sleepTimeout = prefs.getUInt(SLEEP_TIMEOUT_KEY, DEFAULT_SLEEP_TIMEOUT);
     Serial.printf("Loaded sleep timeout: %u seconds\n", sleepTimeout);
 
+    // 读取指纹比对方式
+    matchMode = prefs.getUChar(MATCH_MODE_KEY, DEFAULT_MATCH_MODE);
+    Serial.printf("Loaded match mode: %u\n", matchMode);
+
+    // 读取指纹模组波特率
+    fingerprintBaud = prefs.getUInt(FINGERPRINT_BAUD_KEY, DEFAULT_FINGERPRINT_BAUD);
+    Serial.printf("Loaded fingerprint baud: %u\n", fingerprintBaud);
+
+    // 读取热点优先搜索开关
+    hotSearch = prefs.getBool(HOT_SEARCH_KEY, DEFAULT_HOT_SEARCH);
+
+    // 读取休眠时指纹模组供电策略
+    sensorPowerPolicy = prefs.getUChar(SENSOR_POWER_KEY, DEFAULT_SENSOR_POWER);
+    Serial.printf("Loaded sensor power policy: %u\n", sensorPowerPolicy);
+
+    // 读取重新接受触摸的最小间隔
+    rearmInterval = prefs.getUShort(REARM_INTERVAL_KEY, DEFAULT_REARM_INTERVAL);
+    Serial.printf("Loaded re-arm interval: %u ms\n", rearmInterval);
+
     // 读取BLE地址
     size_t len = prefs.getBytes(BLE_ADDRESS_KEY, bleAddress, 6);
     if (len == 6) {
@@ -48,6 +73,21 @@ void ConfigManager::save() {
     prefs.putUInt(SLEEP_TIMEOUT_KEY, sleepTimeout);
     Serial.printf("Saved sleep timeout: %u seconds\n", sleepTimeout);
 
+    // 保存指纹比对方式
+    prefs.putUChar(MATCH_MODE_KEY, matchMode);
+
+    // 保存指纹模组波特率
+    prefs.putUInt(FINGERPRINT_BAUD_KEY, fingerprintBaud);
+
+    // 保存热点优先搜索开关
+    prefs.putBool(HOT_SEARCH_KEY, hotSearch);
+
+    // 保存休眠时指纹模组供电策略
+    prefs.putUChar(SENSOR_POWER_KEY, sensorPowerPolicy);
+
+    // 保存重新接受触摸的最小间隔
+    prefs.putUShort(REARM_INTERVAL_KEY, rearmInterval);
+
     // 保存BLE地址（如果有）
     if (bleAddress[0] != 0 || bleAddress[1] != 0 || bleAddress[2] != 0 ||
         bleAddress[3] != 0 || bleAddress[4] != 0 || bleAddress[5] != 0) {
@@ -71,6 +111,63 @@ uint32_t ConfigManager::getSleepTimeout() {
     return sleepTimeout;
 }
 
+void ConfigManager::setMatchMode(uint8_t mode) {
+    matchMode = mode;
+    Serial.printf("Match mode set to: %u\n", matchMode);
+}
+
+uint8_t ConfigManager::getMatchMode() {
+    return matchMode;
+}
+
+void ConfigManager::setFingerprintBaud(uint32_t baud) {
+    fingerprintBaud = baud;
+    Serial.printf("Fingerprint baud set to: %u\n", fingerprintBaud);
+}
+
+uint32_t ConfigManager::getFingerprintBaud() {
+    return fingerprintBaud;
+}
+
+void ConfigManager::setHotSearch(bool enable) {
+    hotSearch = enable;
+}
+
+bool ConfigManager::getHotSearch() {
+    return hotSearch;
+}
+
+void ConfigManager::setSensorPowerPolicy(uint8_t policy) {
+    sensorPowerPolicy = policy;
+    Serial.printf("Sensor power policy set to: %u\n", sensorPowerPolicy);
+}
+
+uint8_t ConfigManager::getSensorPowerPolicy() {
+    return sensorPowerPolicy;
+}
+
+void ConfigManager::setRearmInterval(uint16_t ms) {
+    rearmInterval = ms > MAX_REARM_INTERVAL ? MAX_REARM_INTERVAL : ms;
+    Serial.printf("Re-arm interval set to: %u ms\n", rearmInterval);
+}
+
+uint16_t ConfigManager::getRearmInterval() {
+    return rearmInterval;
+}
+
+bool ConfigManager::loadFingerprintUsage(uint16_t* counts) {
+    size_t size = sizeof(uint16_t) * MAX_FINGERPRINT_NUM;
+    if (prefs.getBytes(FINGERPRINT_USAGE_KEY, counts, size) != size) {
+        memset(counts, 0, size);
+        return false;
+    }
+    return true;
+}
+
+void ConfigManager::saveFingerprintUsage(const uint16_t* counts) {
+    prefs.putBytes(FINGERPRINT_USAGE_KEY, counts, sizeof(uint16_t) * MAX_FINGERPRINT_NUM);
+}
+
 void ConfigManager::clearPairedDevices() {
     // 清除ESP32底层的所有绑定信息
     int dev_num = esp_ble_get_bond_device_num();
@@ -168,6 +265,10 @@ void ConfigManager::clear() {
     // 清除所有配置信息
     prefs.clear();
     sleepTimeout = DEFAULT_SLEEP_TIMEOUT;
+    matchMode = DEFAULT_MATCH_MODE;
+    hotSearch = DEFAULT_HOT_SEARCH;
+    sensorPowerPolicy = DEFAULT_SENSOR_POWER;
+    rearmInterval = DEFAULT_REARM_INTERVAL;
     memset(bleAddress, 0, 6);
 
     // 清除底层BLE绑定
@@ -9,6 +9,7 @@
 #include <Preferences.h>
 #include <Arduino.h>
 #include "BluetoothManager.h"
+#include "Fingerprint.h"
 
 class ConfigManager {
 public:
@@ -28,6 +29,29 @@ public:
     void setSleepTimeout(uint32_t seconds);
     uint32_t getSleepTimeout();
     
+    // 指纹比对方式
+    void setMatchMode(uint8_t mode);
+    uint8_t getMatchMode();
+
+    // 设备休眠时指纹模组的供电策略
+    void setSensorPowerPolicy(uint8_t policy);
+    uint8_t getSensorPowerPolicy();
+
+    // 比对结束后到重新接受触摸的最小间隔（毫秒），手指抬起得更快时按这个间隔等待
+    void setRearmInterval(uint16_t ms);
+    uint16_t getRearmInterval();
+
+    // 热点优先搜索开关
+    void setHotSearch(bool enable);
+    bool getHotSearch();
+    // 各指纹匹配次数，匹配成功后单独保存，不随 save() 写入
+    bool loadFingerprintUsage(uint16_t* counts);
+    void saveFingerprintUsage(const uint16_t* counts);
+
+    // 指纹模组串口波特率（模组掉电保存，启动时按上次协商结果打开串口）
+    void setFingerprintBaud(uint32_t baud);
+    uint32_t getFingerprintBaud();
+
     // 配对设备相关方法
     void clearPairedDevices();
     
@@ -48,6 +72,11 @@ public:
 
 private:
     int sleepTimeout; // 自动休眠时间（秒）
+    uint8_t matchMode; // 指纹比对方式
+    uint32_t fingerprintBaud; // 指纹模组串口波特率
+    bool hotSearch; // 热点优先搜索
+    uint8_t sensorPowerPolicy; // 休眠时指纹模组供电策略
+    uint16_t rearmInterval; // 重新接受触摸的最小间隔（毫秒）
     uint8_t bleAddress[6]; // BLE地址缓存
 
 private:
@@ -55,9 +84,21 @@ private:
     static const char* NAMESPACE;
     static const char* SLEEP_TIMEOUT_KEY;
     static const char* BLE_ADDRESS_KEY;
+    static const char* MATCH_MODE_KEY;
+    static const char* FINGERPRINT_BAUD_KEY;
+    static const char* HOT_SEARCH_KEY;
+    static const char* SENSOR_POWER_KEY;
+    static const char* REARM_INTERVAL_KEY;
+    static const char* FINGERPRINT_USAGE_KEY;
     static const char* FINGERPRINT_NAME_KEY_PREFIX; // 指纹名称key前缀
     static const int MAX_FINGERPRINT_NAME_LEN = 32; // UTF-8定长存储
     static const uint32_t DEFAULT_SLEEP_TIMEOUT = 10; // 默认10s休眠
+    static const uint32_t DEFAULT_FINGERPRINT_BAUD = Fingerprint::LINK_BAUD_DEFAULT;
+    static const uint8_t DEFAULT_MATCH_MODE = Fingerprint::MATCH_MODE_SEARCH; // 默认分步搜索
+    static const uint8_t DEFAULT_SENSOR_POWER = Fingerprint::SENSOR_POWER_OFF; // 默认休眠时断电
+    static const uint16_t DEFAULT_REARM_INTERVAL = 300; // 默认300ms
+    static const bool DEFAULT_HOT_SEARCH = true; // 默认热点优先搜索
+    static const uint16_t MAX_REARM_INTERVAL = 5000;
 };
 
 #endif // CONFIG_MANAGER_H
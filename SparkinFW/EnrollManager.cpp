@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+#include "EnrollManager.h"
+#include "BluetoothManager.h"
+#include "ConfigManager.h"
+#include "LedManager.h"
+#include "Common.h"
+#include "IOPin.h"
+#include "Log.h"
+#include <driver/gpio.h>
+
+extern Fingerprint fingerprint;
+extern BluetoothManager bluetoothManager;
+extern ConfigManager configManager;
+extern LedManager ledManager;
+
+EnrollManager* EnrollManager::_instance = nullptr;
+
+EnrollManager::EnrollManager()
+    : _taskHandle(nullptr), _controlQueue(nullptr), _touchDown(false), _sleepManager(nullptr), _state(ENROLL_IDLE),
+      _templateId(0), _captures(0), _phase(ENROLL_PHASE_COLLECT), _nextBuffer(1), _stateSince(0), _retryAt(0) {
+}
+
+void EnrollManager::begin(SleepManager* sleep) {
+    _sleepManager = sleep;
+    _instance = this;
+    _controlQueue = xQueueCreate(4, sizeof(EnrollEvent));
+
+    xTaskCreate(
+        taskFunction,
+        "EnrollTask",
+        4096,
+        this,
+        1,
+        &_taskHandle
+    );
+}
+
+bool EnrollManager::start(uint16_t templateId) {
+    return sendControl({ENROLL_EVENT_START, templateId});
+}
+
+bool EnrollManager::cancel() {
+    return sendControl({ENROLL_EVENT_CANCEL, 0});
+}
+
+bool EnrollManager::sendControl(const EnrollEvent& event) {
+    if (!_controlQueue || !_taskHandle || xQueueSend(_controlQueue, &event, 0) != pdTRUE) {
+        LOGW("[Enroll] Control queue full, event %u dropped", event.type);
+        return false;
+    }
+    xTaskNotify(_taskHandle, ENROLL_NOTIFY_CONTROL, eSetBits);
+    return true;
+}
+
+// 注册期间的触摸中断：只记录电平并置位，任务处理时以最近的电平为准
+// 可能在 flash 缓存关闭时触发，只能调用 IRAM 中的函数
+void IRAM_ATTR EnrollManager::touchISR() {
+    if (_instance && _instance->_taskHandle) {
+        _instance->_touchDown = gpio_get_level((gpio_num_t)PIN_FINGERPRINT_TOUCH) != 0;
+        BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+        xTaskNotifyFromISR(_instance->_taskHandle, ENROLL_NOTIFY_TOUCH, eSetBits, &xHigherPriorityTaskWoken);
+        portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+    }
+}
+
+bool EnrollManager::fingerDown() {
+    return fingerprint.isFingerTouching();
+}
+
+void EnrollManager::taskFunction(void* param) {
+    EnrollManager* manager = static_cast<EnrollManager*>(param);
+    EnrollEvent event;
+
+    while (true) {
+        uint32_t bits = 0;
+        if (xTaskNotifyWait(0, 0xFFFFFFFF, &bits, ENROLL_TICK_MS / portTICK_PERIOD_MS) != pdTRUE) {
+            manager->handleTick();
+            continue;
+        }
+        if (bits & ENROLL_NOTIFY_CONTROL) {
+            while (xQueueReceive(manager->_controlQueue, &event, 0) == pdTRUE) {
+                manager->handleEvent(event);
+            }
+        }
+        if (bits & ENROLL_NOTIFY_TOUCH) {
+            manager->handleEvent({(uint8_t)(manager->_touchDown ? ENROLL_EVENT_TOUCH_DOWN : ENROLL_EVENT_TOUCH_UP), 0});
+        }
+    }
+}
+
+void EnrollManager::handleEvent(const EnrollEvent& event) {
+    switch (event.type) {
+        case ENROLL_EVENT_START:
+            if (_state != ENROLL_IDLE) {
+                LOGW("[Enroll] Already enrolling, request ignored");
+                bluetoothManager.sendMessage(MSG_FINGERPRINT_REGISTER, &MSG_CMD_FAILURE, 1);
+                break;
+            }
+            beginEnroll(event.templateId);
+            break;
+        case ENROLL_EVENT_CANCEL:
+            if (_state != ENROLL_IDLE) {
+                LOGI("[Enroll] Fingerprint registration cancelled");
+                finish(false);
+            }
+            break;
+        case ENROLL_EVENT_TOUCH_DOWN:
+            if (_state == ENROLL_WAIT_FINGER) {
+                capture();
+            }
+            break;
+        case ENROLL_EVENT_TOUCH_UP:
+            if (_state == ENROLL_WAIT_LIFT) {
+                LOGI("[Enroll] Please touch the sensor to register fingerprint");
+                _state = ENROLL_WAIT_FINGER;
+                _stateSince = millis();
+                bluetoothManager.sendMessage(MSG_PUT_FINGER, &MSG_CMD_EXECUTE, 1);
+            }
+            break;
+    }
+}
+
+// 定时检查：防止休眠、采图失败后重试、补偿丢失的触摸边沿、超时
+void EnrollManager::handleTick() {
+    if (_state == ENROLL_IDLE) {
+        return;
+    }
+    if (_sleepManager) {
+        _sleepManager->resetActivity();
+    }
+    // 注册过程中电脑随时可能收到进度消息，保持快速连接参数
+    bluetoothManager.requestFastConnection();
+
+    if (_state == ENROLL_WAIT_FINGER && fingerDown() && (int32_t)(millis() - _retryAt) >= 0) {
+        capture();
+    } else if (_state == ENROLL_WAIT_LIFT && !fingerDown()) {
+        handleEvent({ENROLL_EVENT_TOUCH_UP, 0});
+    } else if (millis() - _stateSince > ENROLL_IDLE_TIMEOUT_MS) {
+        LOGW("[Enroll] Timed out waiting for finger");
+        finish(false);
+    }
+}
+
+void EnrollManager::beginEnroll(uint16_t templateId) {
+    LOGI("[Enroll] Start enrolling template %u", templateId);
+    _templateId = templateId;
+    _captures = 0;
+    _phase = ENROLL_PHASE_COLLECT;
+    _nextBuffer = 1;
+    _retryAt = millis();
+    _stateSince = millis();
+    _state = ENROLL_WAIT_FINGER;
+
+    // 注册期间由状态机处理触摸，按下和抬起都需要
+    detachInterrupt(digitalPinToInterrupt(PIN_FINGERPRINT_TOUCH));
+    attachInterrupt(digitalPinToInterrupt(PIN_FINGERPRINT_TOUCH), touchISR, CHANGE);
+
+    LOGI("[Enroll] Please touch the sensor to register fingerprint");
+    bluetoothManager.sendMessage(MSG_PUT_FINGER, &MSG_CMD_EXECUTE, 1);
+
+    // 手指已经在传感器上
+    if (fingerDown()) {
+        capture();
+    }
+}
+
+void EnrollManager::capture() {
+    if (_sleepManager) {
+        _sleepManager->resetActivity();
+    }
+
+    // 每次采图只在这一步占用模组
+    if (!fingerprint.captureFeature(_nextBuffer)) {
+        bluetoothManager.sendMessage(MSG_PUT_FINGER, &MSG_CMD_FAILURE, 1);
+        _retryAt = millis() + ENROLL_RETRY_DELAY_MS; // 手指仍在时稍后重试
+        return;
+    }
+    _captures++;
+    bluetoothManager.sendMessage(MSG_PUT_FINGER, &MSG_CMD_SUCCESS, 1);
+
+    if (!advance()) {
+        return; // 已经结束
+    }
+
+    LOGI("[Enroll] Please remove your finger from the sensor");
+    bluetoothManager.sendMessage(MSG_REMOVE_FINGER, &MSG_CMD_SUCCESS, 1);
+    _state = ENROLL_WAIT_LIFT;
+    _stateSince = millis();
+}
+
+// 一次采图成功后决定下一步：选择下一个缓冲区，或者合并存储结束注册；返回 false 表示注册已结束
+bool EnrollManager::advance() {
+    switch (_phase) {
+        case ENROLL_PHASE_COLLECT:
+            if (_nextBuffer == ENROLL_MIN_CAPTURES && fingerprint.mergeFeatures()) {
+                // 合并成功不代表模板质量好，再采一次与模板比对
+                _phase = ENROLL_PHASE_VERIFY;
+                _nextBuffer = 2;
+                return true;
+            }
+            break;
+        case ENROLL_PHASE_VERIFY: {
+            uint16_t score = 0;
+            if (fingerprint.matchFeatures(score) && score >= ENROLL_VERIFY_SCORE) {
+                LOGI("[Enroll] Verify score %u after %u captures, storing early merge", score, _captures);
+                finish(fingerprint.storeTemplate(_templateId));
+                return false;
+            }
+            // 缓冲区1的模板作废，缓冲区2（刚采的）和3仍是有效特征，补采其余缓冲区后按完整注册合并
+            LOGI("[Enroll] Verify score %u too low, collecting a full set", score);
+            _phase = ENROLL_PHASE_REFILL;
+            _nextBuffer = 1;
+            return true;
+        }
+        case ENROLL_PHASE_REFILL:
+            if (_nextBuffer == 1) {
+                _nextBuffer = ENROLL_MIN_CAPTURES + 1;
+                return true;
+            }
+            break;
+    }
+
+    if (_nextBuffer < ENROLL_MAX_CAPTURES) {
+        _nextBuffer++;
+        return true;
+    }
+    // 所有缓冲区都已采集，合并后存储
+    finish(fingerprint.mergeFeatures() && fingerprint.storeTemplate(_templateId));
+    return false;
+}
+
+void EnrollManager::finish(bool success) {
+    _state = ENROLL_IDLE;
+
+    // 恢复正常的触摸识别中断
+    detachInterrupt(digitalPinToInterrupt(PIN_FINGERPRINT_TOUCH));
+    attachInterrupt(digitalPinToInterrupt(PIN_FINGERPRINT_TOUCH), handleTouchInterrupt, RISING);
+    ledManager.resetState(); // 采图时模组会自动控制灯
+
+    if (success) {
+        // 注册成功，生成默认的名字
+        String name_prefix = "指纹";
+        configManager.setFingerprintName(_templateId, name_prefix + String(_templateId + 1));
+        LOGI("[Enroll] Enrolled template %u after %u captures", _templateId, _captures);
+        bluetoothManager.sendMessage(MSG_FINGERPRINT_REGISTER, &MSG_CMD_SUCCESS, 1);
+    } else {
+        LOGW("[Enroll] Enrollment failed after %u captures", _captures);
+        bluetoothManager.sendMessage(MSG_FINGERPRINT_REGISTER, &MSG_CMD_FAILURE, 1);
+    }
+}
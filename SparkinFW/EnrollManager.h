@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+#ifndef ENROLL_MANAGER_H
+#define ENROLL_MANAGER_H
+
+#include <Arduino.h>
+#include "Fingerprint.h"
+#include "SleepManager.h"
+
+// 指纹注册状态机：手指按下/抬起由触摸中断驱动，每次采图才占用模组
+class EnrollManager {
+public:
+    EnrollManager();
+    void begin(SleepManager* sleep);
+
+    // 开始注册，立即返回；结果通过 MSG_FINGERPRINT_REGISTER 发送，返回 false 表示请求没有送达状态机
+    bool start(uint16_t templateId);
+    // 取消注册，返回 false 表示请求没有送达状态机
+    bool cancel();
+    // 是否正在注册
+    bool isActive() const { return _state != ENROLL_IDLE; }
+
+    static const uint8_t ENROLL_MIN_CAPTURES = 3;   // 采够该次数后尝试提前合并
+    static const uint8_t ENROLL_MAX_CAPTURES = 5;   // 完整注册的特征数（使用的特征缓冲区数量）
+    static const uint16_t ENROLL_VERIFY_SCORE = 100; // 提前合并的模板与新采特征的比对得分达到该值才提前结束
+
+private:
+    enum EnrollState {
+        ENROLL_IDLE = 0,
+        ENROLL_WAIT_FINGER,  // 等待手指按下
+        ENROLL_WAIT_LIFT,    // 等待手指抬起
+    };
+
+    // 采图阶段
+    enum EnrollPhase {
+        ENROLL_PHASE_COLLECT = 0, // 依次采集到缓冲区1~5，第3次后尝试提前合并
+        ENROLL_PHASE_VERIFY,      // 提前合并成功，再采一次到缓冲区2与模板比对
+        ENROLL_PHASE_REFILL,      // 比对得分不够，补采缓冲区1、4、5后按完整注册合并
+    };
+
+    enum EnrollEventType {
+        ENROLL_EVENT_START = 0,
+        ENROLL_EVENT_CANCEL,
+        ENROLL_EVENT_TOUCH_DOWN,
+        ENROLL_EVENT_TOUCH_UP,
+    };
+
+    struct EnrollEvent {
+        uint8_t type;
+        uint16_t templateId;
+    };
+
+    // 任务通知位：控制事件走单独的队列，触摸边沿只置位，抖动产生的多个边沿合并为一次处理
+    static const uint32_t ENROLL_NOTIFY_CONTROL = 1 << 0; // 控制队列中有开始/取消事件
+    static const uint32_t ENROLL_NOTIFY_TOUCH = 1 << 1;   // 触摸状态变化，按 _touchDown 处理
+
+    static void taskFunction(void* param);
+    bool sendControl(const EnrollEvent& event);
+    static void IRAM_ATTR touchISR();
+
+    void handleEvent(const EnrollEvent& event);
+    void handleTick();
+    void beginEnroll(uint16_t templateId);
+    void capture();
+    bool advance();
+    void finish(bool success);
+    bool fingerDown();
+
+    static EnrollManager* _instance; // 供中断函数使用
+
+    TaskHandle_t _taskHandle;
+    QueueHandle_t _controlQueue;
+    volatile bool _touchDown;   // 中断中记录的最近一次触摸电平
+    SleepManager* _sleepManager;
+    volatile EnrollState _state;
+    uint16_t _templateId;
+    uint8_t _captures;          // 已成功采集的特征数
+    EnrollPhase _phase;
+    uint8_t _nextBuffer;        // 下一次采图写入的特征缓冲区
+    uint32_t _stateSince;       // 进入当前状态的时间
+    uint32_t _retryAt;          // 采图失败后手指仍在时的重试时间
+
+    static const uint32_t ENROLL_TICK_MS = 200;          // 状态机定时检查间隔
+    static const uint32_t ENROLL_RETRY_DELAY_MS = 1000;  // 采图失败后重试间隔
+    static const uint32_t ENROLL_IDLE_TIMEOUT_MS = 60000; // 等待手指超时
+};
+
+#endif
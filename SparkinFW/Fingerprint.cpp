@@ -5,39 +5,82 @@
  */
 #include "Fingerprint.h"
 #include "Common.h"
-#include "IOPin.h"
-#include "BluetoothManager.h"
+#include "Log.h"
 
-// 简单的RAII锁辅助类
-class FingerprintLock {
-    SemaphoreHandle_t _mutex;
-public:
-    FingerprintLock(SemaphoreHandle_t mutex) : _mutex(mutex) {
-        if (_mutex) xSemaphoreTake(_mutex, portMAX_DELAY);
-    }
-    ~FingerprintLock() {
-        if (_mutex) xSemaphoreGive(_mutex);
-    }
+// 采图失败时按确认码决定重试方式
+enum RetryAction
+{
+    RETRY_NOW = 0, // 立即重试
+    RETRY_BACKOFF, // 等待一段时间后重试，计入退避次数
+    RETRY_ABORT,   // 立即中止
+};
+
+struct RetryRule
+{
+    uint8_t code;     // 确认码
+    uint8_t action;   // 重试方式
+    uint16_t delayMs; // 退避时间
+    uint32_t FingerprintOutcomeCounts::*counter; // 计入的结果分类
+};
+
+static const RetryRule RETRY_RULES[] = {
+    {CONFIRM_NO_FINGER,        RETRY_NOW,     0,   &FingerprintOutcomeCounts::noFinger},
+    {CONFIRM_IMAGE_FAIL,       RETRY_BACKOFF, 100, &FingerprintOutcomeCounts::poorImage},
+    {CONFIRM_IMAGE_DRY,        RETRY_BACKOFF, 100, &FingerprintOutcomeCounts::poorImage},
+    {CONFIRM_IMAGE_WET,        RETRY_BACKOFF, 100, &FingerprintOutcomeCounts::poorImage},
+    {CONFIRM_IMAGE_MESSY,      RETRY_BACKOFF, 100, &FingerprintOutcomeCounts::poorImage},
+    {CONFIRM_FEATURE_FEW,      RETRY_BACKOFF, 100, &FingerprintOutcomeCounts::poorImage},
+    {CONFIRM_NO_VALID_IMAGE,   RETRY_BACKOFF, 100, &FingerprintOutcomeCounts::poorImage},
+    {CONFIRM_PACKET_ERROR,     RETRY_BACKOFF, 20,  &FingerprintOutcomeCounts::commError},
+    {CONFIRM_NO_RESPONSE,      RETRY_ABORT,   0,   &FingerprintOutcomeCounts::commError}, // 模组无应答，重试只会再等一次超时
+    {CONFIRM_NOT_FOUND,        RETRY_ABORT,   0,   &FingerprintOutcomeCounts::noMatch},
+    {CONFIRM_NOT_MATCH,        RETRY_ABORT,   0,   &FingerprintOutcomeCounts::noMatch},
 };
+static const RetryRule RETRY_RULE_FATAL = {CONFIRM_OK, RETRY_ABORT, 0, &FingerprintOutcomeCounts::fatal}; // 表中没有的确认码
+
+static const RetryRule &findRetryRule(uint8_t code)
+{
+    for (const RetryRule &rule : RETRY_RULES)
+    {
+        if (rule.code == code)
+            return rule;
+    }
+    return RETRY_RULE_FATAL;
+}
 
 // #define HLK_DEBUG //打开日志打印
 
-bool bCancelRegister = false; // 用于取消注册指纹的标志
-extern BluetoothManager bluetoothManager; // 蓝牙管理器对象
 // 构造函数
-Fingerprint::Fingerprint(int rx_pin, int tx_pin)
+Fingerprint::Fingerprint(FingerprintTransport &transport)
+    : _transport(transport)
 {
-    _rx_pin = rx_pin;
-    _tx_pin = tx_pin;
-    _buffer_id = 0;
-    _mutex = xSemaphoreCreateMutex(); // 创建互斥锁
+    _lastCmd = 0;
+    _matchMode = MATCH_MODE_SEARCH;
+    _baudRate = LINK_BAUD_DEFAULT;
+    _sysParams = {};
+    memset(_indexTable, 0, sizeof(_indexTable));
+    _templateCount = 0;
+    _indexGeneration = 1; // 与缓存代数不同，首次读取时从模组加载
+    _cachedGeneration = 0;
+    _cacheMutex = xSemaphoreCreateMutex();
+    _hotSearch = true;
+    _lastMatchedId = -1;
+    memset(_usageCount, 0, sizeof(_usageCount));
+    _usageDirty = false;
+    _outcomes = {};
+    _rxSignal = xSemaphoreCreateBinary(); // 串口数据到达信号
 }
 
 // 初始化函数
 void Fingerprint::begin(uint32_t baud_rate)
 {
-    Serial1.begin(baud_rate, SERIAL_8N1, _rx_pin, _tx_pin);
-    pinMode(PIN_FINGERPRINT_POWER, OUTPUT);
+    _baudRate = baud_rate;
+    _transport.begin(baud_rate);
+    // 事务的最后一条指令在事务结束时计入耗时统计，不等下一条指令
+    _scheduler.setTransactionEndHook([this]() { _trace.end(); });
+    _scheduler.begin();
+    // 串口收到数据时通知等待的任务，不再忙等轮询
+    _transport.onReceive([this]() { onSerialReceive(); });
 }
 
 // 打印十六进制数据
@@ -55,69 +98,33 @@ void Fingerprint::printHex(uint8_t *data, uint8_t len)
 
 void Fingerprint::setPower(bool on)
 {
-    FingerprintLock lock(_mutex);
-    if (on)
-    {
-        digitalWrite(PIN_FINGERPRINT_POWER, HIGH);
-        delay(100); // 等待模组上电稳定
-        Serial.println("[FP] Fingerprint module powered ON");
-    }
-    else
-    {
-        digitalWrite(PIN_FINGERPRINT_POWER, LOW);
-        Serial.println("[FP] Fingerprint module powered OFF");
-    }
+    _scheduler.run(FingerprintScheduler::PRIORITY_UNLOCK, [&]() {
+        if (on)
+        {
+            _transport.setPower(true);
+            delay(100); // 等待模组上电稳定
+            LOGI("[FP] Fingerprint module powered ON");
+        }
+        else
+        {
+            _transport.setPower(false);
+            LOGI("[FP] Fingerprint module powered OFF");
+        }
+        return true;
+    });
 }
 
 // 读取模组基本参数
 bool Fingerprint::readInfo()
 {
-    FingerprintLock lock(_mutex);
-    uint8_t response[32] = {0};
-    uint8_t index = 0;
-    uint32_t startTime = millis();
-
-    Serial.println("+--------------------+----------------------+");
-    Serial.println("|       ZW101 FINGERPRINT SENSOR INFO       |");
-    sendCmd12(CMD_READ_SYSPARA);
+    return _scheduler.run(FingerprintScheduler::PRIORITY_MANAGE, [&]() -> bool {
+        Serial.println("+--------------------+----------------------+");
+        Serial.println("|       ZW101 FINGERPRINT SENSOR INFO       |");
 
-    // 等待响应包
-    while (millis() - startTime < 2000)
-    {
-        if (Serial1.available())
-        {
-            response[index++] = Serial1.read();
-            if (index >= 28)
-                break;
-        }
-    }
-
-    // 检查确认码
-    if (index >= 28 && response[9] == 0x00)
-    {
-        uint16_t register_cnt = (uint16_t)(response[10] << 8) | response[11];
-        uint16_t fp_temp_size = (uint16_t)(response[12] << 8) | response[13];
-        uint16_t fp_lib_size = (uint16_t)(response[14] << 8) | response[15];
-        uint16_t score_level = (uint16_t)(response[16] << 8) | response[17];
-        uint32_t device_addr = (uint32_t)(response[18] << 24) | (response[19] << 16) | (response[20] << 8) | response[21];
-        uint16_t data_pack_size = (uint16_t)(response[22] << 8) | response[23];
-        if (0 == data_pack_size)
+        if (!readSystemParameters())
         {
-            data_pack_size = 32;
+            return false; // 失败
         }
-        else if (1 == data_pack_size)
-        {
-            data_pack_size = 64;
-        }
-        else if (2 == data_pack_size)
-        {
-            data_pack_size = 128;
-        }
-        else if (3 == data_pack_size)
-        {
-            data_pack_size = 256;
-        }
-        uint16_t baud_set = (uint16_t)(response[24] << 8) | response[25];
 
         const int colWidth = 21; // 单元格内容宽度（不含边框）
         char buf[32];
@@ -147,850 +154,1201 @@ bool Fingerprint::readInfo()
         };
 
         // 逐行输出
-        snprintf(buf, sizeof(buf), "%u", register_cnt);
+        snprintf(buf, sizeof(buf), "%u", _sysParams.registerCount);
         printRow("REGISTER TIMES", buf);
-        snprintf(buf, sizeof(buf), "0x%X", fp_temp_size);
+        snprintf(buf, sizeof(buf), "0x%X", _sysParams.templateSize);
         printRow("TEMPLATE SIZE", buf);
-        snprintf(buf, sizeof(buf), "%u", fp_lib_size);
+        snprintf(buf, sizeof(buf), "%u", _sysParams.librarySize);
         printRow("LIBRARY SIZE", buf);
-        snprintf(buf, sizeof(buf), "%u", score_level);
+        snprintf(buf, sizeof(buf), "%u", _sysParams.scoreLevel);
         printRow("SCORE LEVEL", buf);
-        snprintf(buf, sizeof(buf), "0x%lX", device_addr);
+        snprintf(buf, sizeof(buf), "0x%lX", _sysParams.deviceAddress);
         printRow("DEVICE ADDRESS", buf);
-        snprintf(buf, sizeof(buf), "%u", data_pack_size);
+        snprintf(buf, sizeof(buf), "%u", _sysParams.packetSize);
         printRow("DATA PACK SIZE", buf);
-        snprintf(buf, sizeof(buf), "%u", baud_set * 9600);
+        snprintf(buf, sizeof(buf), "%lu", _sysParams.baudRate);
         printRow("BAUD RATE", buf);
 
         Serial.println("+---------------------+---------------------+");
         return true; // 成功
+    });
+}
+
+// 读取系统参数到 _sysParams，在调度器事务中调用
+bool Fingerprint::readSystemParameters()
+{
+    sendFrame(FRAME_READ_SYSPARA);
+
+    // 等待响应包并检查确认码
+    FingerprintResponse frame;
+    if (!receiveFrame(frame, commandTimeout(CMD_READ_SYSPARA)) ||
+        frame.confirm() != 0x00 || frame.payloadLength < 17)
+    {
+        return false;
     }
-    else
+
+    _sysParams.registerCount = frame.word(1);
+    _sysParams.templateSize = frame.word(3);
+    _sysParams.librarySize = frame.word(5);
+    _sysParams.scoreLevel = frame.word(7);
+    _sysParams.deviceAddress = ((uint32_t)frame.word(9) << 16) | frame.word(11);
+    _sysParams.packetSize = 32 << (frame.word(13) & 0x03); // 0~3 对应 32/64/128/256 字节
+    _sysParams.baudRate = (uint32_t)frame.word(15) * 9600;
+    return true;
+}
+
+// 写系统寄存器，在调度器事务中调用
+bool Fingerprint::writeSystemRegister(uint8_t reg, uint8_t value)
+{
+    sendFrame(FingerprintFrame::encode(CMD_WRITE_REG, reg, value));
+    if (receiveResponse())
     {
-        return false; // 失败
+        LOGD("[FP] Write register %u = %u OK", reg, value);
+        return true;
     }
+    LOGW("[FP] Write register %u = %u failed", reg, value);
+    return false;
+}
+
+// 切换本地串口波特率，并丢弃切换前后的残留数据
+void Fingerprint::setSerialBaudRate(uint32_t baudRate)
+{
+    _transport.setBaudRate(baudRate);
+    _baudRate = baudRate;
+    drainInput();
 }
 
-// 注册指纹
-bool Fingerprint::registerFingerprint(int template_id)
+// 依次尝试当前、快速、默认波特率，找到模组正在使用的波特率
+bool Fingerprint::probeBaudRate()
 {
-    FingerprintLock lock(_mutex);
-    _buffer_id = 1;
-    while (_buffer_id <= 5)
+    const uint32_t candidates[] = {_baudRate, LINK_BAUD_FAST, LINK_BAUD_DEFAULT};
+    for (size_t i = 0; i < sizeof(candidates) / sizeof(candidates[0]); i++)
     {
-        Serial.println("Please touch the sensor to register fingerprint...");
-        //发送放上手指消息
-        bluetoothManager.sendMessage(MSG_PUT_FINGER, &MSG_CMD_EXECUTE, 1);
-        while (digitalRead(PIN_FINGERPRINT_TOUCH) == LOW)
+        if (i > 0 && candidates[i] == candidates[0])
+            continue;
+        if (candidates[i] != _baudRate)
+            setSerialBaudRate(candidates[i]);
+        if (readSystemParameters())
+        {
+            LOGI("[FP] Module responds at %lu baud", _baudRate);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Fingerprint::negotiateLink(uint32_t baudRate, uint16_t packetSize)
+{
+    return _scheduler.run(FingerprintScheduler::PRIORITY_MANAGE, [&]() -> bool {
+        if (!probeBaudRate())
         {
-            // 等待手指接触传感器
-            if (bCancelRegister)
+            LOGE("[FP] Link negotiation failed: module not responding");
+            setSerialBaudRate(LINK_BAUD_DEFAULT);
+            return false;
+        }
+
+        // 数据包长度：32 << code
+        if (_sysParams.packetSize != packetSize)
+        {
+            uint8_t code = 0;
+            while (code < 3 && (32u << code) < packetSize)
+                code++;
+            if (writeSystemRegister(REG_PACKET_SIZE, code))
             {
-                Serial.println("Fingerprint registration cancelled.");
-                return false; // 取消注册
+                _sysParams.packetSize = 32 << code;
             }
-            delay(100);
         }
 
+        // 波特率：应答以旧波特率返回，之后模组切换到新波特率
+        uint8_t baudCode = baudRate / 9600;
+        if (_baudRate != baudRate && baudCode >= 1 && baudCode <= 12 && baudCode * 9600 == baudRate)
+        {
+            uint32_t oldBaudRate = _baudRate;
+            if (writeSystemRegister(REG_BAUD_RATE, baudCode))
+            {
+                setSerialBaudRate(baudRate);
+                if (!readSystemParameters())
+                {
+                    // 新波特率不通，回退
+                    LOGW("[FP] No response at %lu baud, falling back", baudRate);
+                    setSerialBaudRate(oldBaudRate);
+                    if (!readSystemParameters())
+                    {
+                        setSerialBaudRate(LINK_BAUD_DEFAULT);
+                        if (!readSystemParameters())
+                        {
+                            LOGE("[FP] Link negotiation failed: module lost");
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+
+        LOGI("[FP] Link: %lu baud, packet size %u", _baudRate, _sysParams.packetSize);
+        return true;
+    });
+}
+
+// 注册步骤：采图并生成特征到指定缓冲区
+bool Fingerprint::captureFeature(uint8_t bufferId)
+{
+    return _scheduler.run(FingerprintScheduler::PRIORITY_ENROLL, [&]() -> bool {
         // 步骤1：获取图像
-        sendCmd12(CMD_GET_IMAGE);
-        // 等待指纹模组响应
+        sendFrame(FRAME_GET_IMAGE);
+        if (!receiveResponse())
+        {
+            LOGW("Get Image Failed!");
+            return false;
+        }
+        LOGD("Get Image OK!");
+
+        // 步骤2：生成特征
+        sendFrame(FingerprintFrame::encode(CMD_GEN_CHAR, bufferId));
+        if (!receiveResponse())
+        {
+            LOGW("CMD_GEN_CHAR Failed!");
+            return false;
+        }
+        LOGD("CMD_GEN_CHAR OK! Buffer %u", bufferId);
+        return true;
+    });
+}
+
+// 注册步骤：合并各缓冲区特征生成模板
+bool Fingerprint::mergeFeatures()
+{
+    return _scheduler.run(FingerprintScheduler::PRIORITY_ENROLL, [&]() -> bool {
+        sendFrame(FRAME_REG_MODEL);
         if (receiveResponse())
         {
-            Serial.println("Get Image OK!");
+            LOGD("CMD_REG_MODEL OK!");
+            return true;
         }
-        else
+        LOGW("CMD_REG_MODEL Failed!");
+        return false;
+    });
+}
+
+// 注册步骤：合并后的模板与新采的特征比对，用得分判断模板质量
+bool Fingerprint::matchFeatures(uint16_t &score)
+{
+    score = 0;
+    return _scheduler.run(FingerprintScheduler::PRIORITY_ENROLL, [&]() -> bool {
+        sendFrame(FingerprintFrame::encode(CMD_MATCH));
+        FingerprintResponse frame;
+        if (!receiveFrame(frame, commandTimeout(CMD_MATCH)))
+            return false;
+        if (frame.confirm() != 0x00)
         {
-            Serial.println("Get Image Failed!");
-            bluetoothManager.sendMessage(MSG_PUT_FINGER, &MSG_CMD_FAILURE, 1);
-            delay(1000);
-            continue;
+            LOGD("CMD_MATCH not matched, confirm %02X", frame.confirm());
+            return false;
         }
-        // 步骤2：生成特征
-        sendCmd13(CMD_GEN_CHAR, _buffer_id);
+        score = frame.word(1);
+        LOGD("CMD_MATCH OK! Score %u", score);
+        return true;
+    });
+}
+
+// 注册步骤：存储合并后的模板
+bool Fingerprint::storeTemplate(uint16_t template_id)
+{
+    return _scheduler.run(FingerprintScheduler::PRIORITY_ENROLL, [&]() -> bool {
+        sendFrame(FingerprintFrame::encode(CMD_STORE_CHAR, 1, FingerprintFrame::hi(template_id), FingerprintFrame::lo(template_id)));
         if (receiveResponse())
         {
-            Serial.println("CMD_GEN_CHAR OK!");
-            _buffer_id++;
+            LOGI("CMD_STORE_CHAR OK! Template ID: %u", template_id);
+            updateIndexCache(template_id, true);
+            return true;
+        }
+        invalidateIndexCache(); // 没有收到应答，不确定是否已存储
+        return false;
+    });
+}
+
+// 搜索指纹
+bool Fingerprint::searchFingerprint(FingerprintMatchResult &result)
+{
+    return _scheduler.run(FingerprintScheduler::PRIORITY_UNLOCK, [&]() -> bool {
+        result = {};
+        result.matchMode = MATCH_MODE_SEARCH;
+        uint32_t startTime = millis();
+        uint32_t stageTime = startTime;
+        bool extracted = false;
+        uint8_t backoffs = 0;
+        // 按确认码重试：没有手指立即重试，图像质量差短暂退避，其他错误立即中止
+        while (millis() - startTime < CAPTURE_WINDOW_MS && result.attempts < UINT8_MAX)
+        {
+            // 步骤1：获取图像
+            result.attempts++;
+            _trace.setRetry(result.attempts - 1);
+            sendFrame(FRAME_GET_IMAGE);
+            uint8_t code = receiveConfirm();
+            if (code == CONFIRM_OK)
+            {
+                LOGD("Get Image OK!");
+                result.captureMs = millis() - stageTime;
+                stageTime = millis();
+
+                // 步骤2：生成特征
+                sendFrame(FRAME_GEN_CHAR_1);
+                code = receiveConfirm();
+                if (code == CONFIRM_OK)
+                {
+                    LOGD("CMD_GEN_CHAR OK!");
+                    result.extractMs = millis() - stageTime;
+                    _outcomes.ok++;
+                    extracted = true;
+                    break;
+                }
+                LOGW("CMD_GEN_CHAR Failed! code %02X", code);
+                stageTime = startTime; // 重新采图，采图耗时从头累计
+            }
+            else if (code != CONFIRM_NO_FINGER)
+            {
+                LOGW("Get Image Failed! code %02X", code);
+            }
+            if (!retryAfter(code, backoffs))
+            {
+                break;
+            }
+        }
+        if (!extracted)
+        {
+            LOGW("CMD_SEARCH skipped, no valid image!");
+            return false;
+        }
+
+        // 步骤3：搜索指纹，范围由索引表决定
+        stageTime = millis();
+        uint8_t indexTable[INDEX_TABLE_LENGTH];
+        int templateCount = 0;
+        uint16_t firstPage = 0;
+        uint16_t lastPage = MAX_FINGERPRINT_NUM - 1;
+        if (copyIndexCache(indexTable, &templateCount) || (refreshIndexCache() && copyIndexCache(indexTable, &templateCount)))
+        {
+            if (templateCount == 0)
+            {
+                LOGI("CMD_SEARCH skipped, library is empty!");
+                return false;
+            }
+            firstPage = INDEX_TABLE_LENGTH * 8;
+            lastPage = 0;
+            for (uint16_t id = 0; id < INDEX_TABLE_LENGTH * 8; id++)
+            {
+                if (indexTable[id / 8] & (1 << (id % 8)))
+                {
+                    firstPage = min(firstPage, id);
+                    lastPage = id;
+                }
+            }
         }
         else
         {
-            Serial.println("CMD_GEN_CHAR Failed!");
-            bluetoothManager.sendMessage(MSG_PUT_FINGER, &MSG_CMD_FAILURE, 1);
-            continue;
+            templateCount = 0; // 索引表不可用，搜索全部页
         }
 
-        // 发送成功消息
-        bluetoothManager.sendMessage(MSG_PUT_FINGER, &MSG_CMD_SUCCESS, 1);
-       
-        Serial.println("Please remove your finger from the sensor...");
-        // 发送要求离开手指消息
-        bluetoothManager.sendMessage(MSG_REMOVE_FINGER, &MSG_CMD_SUCCESS, 1);
-        while (digitalRead(PIN_FINGERPRINT_TOUCH) == HIGH)
+        bool found = false;
+        // 第一阶段：热点模板，只有模板数量多于热点数量时才有意义
+        if (_hotSearch && templateCount > HOT_SET_SIZE)
         {
-            if (bCancelRegister)
+            uint16_t hotIds[HOT_SET_SIZE];
+            int hotCount = selectHotSet(indexTable, hotIds);
+            for (int i = 0; i < hotCount && !found; i++)
+            {
+                found = searchRange(hotIds[i], 1, result);
+            }
+            if (found)
             {
-                Serial.println("Fingerprint registration cancelled.");
-                return false; // 取消注册
+                LOGI("CMD_SEARCH hot set hit, ID %u", result.templateId);
             }
-            // 等待手指离开传感器
-            delay(100);
         }
-    }
+        // 第二阶段：整个有效范围
+        if (!found)
+        {
+            found = searchRange(firstPage, lastPage - firstPage + 1, result);
+        }
+        result.searchMs = millis() - stageTime;
+        if (found)
+        {
+            recordMatch(result.templateId);
+            LOGI("CMD_SEARCH OK! ID %u, score %u, attempts %u", result.templateId, result.score, result.attempts);
+            return true;
+        }
+        _outcomes.noMatch++;
+        LOGW("CMD_SEARCH Failed!");
+        return false;
+    });
+}
 
-    // 步骤3：合并特征
-    sendCmd12(CMD_REG_MODEL);
-    if (receiveResponse())
+// 根据确认码计数并决定是否重试，需要退避时在这里等待，在调度器事务中调用
+bool Fingerprint::retryAfter(uint8_t code, uint8_t &backoffs)
+{
+    const RetryRule &rule = findRetryRule(code);
+    _outcomes.*rule.counter += 1;
+    switch (rule.action)
     {
-        Serial.println("CMD_REG_MODEL OK!");
+    case RETRY_NOW:
+        return true;
+    case RETRY_BACKOFF:
+        if (++backoffs > CAPTURE_MAX_BACKOFF)
+        {
+            return false;
+        }
+        _scheduler.idle(rule.delayMs); // 退避期间模组空闲，排队的短事务可以在这里执行
+        return true;
+    default:
+        LOGW("[FP] Capture aborted, code %02X", code);
+        return false;
     }
-    else
+}
+
+void Fingerprint::getOutcomeCounts(FingerprintOutcomeCounts &counts)
+{
+    counts = _outcomes;
+}
+
+// 在缓冲区1的特征与指定页范围内的模板之间搜索，在调度器事务中调用
+bool Fingerprint::searchRange(uint16_t startPage, uint16_t pageCount, FingerprintMatchResult &result)
+{
+    sendFrame(FingerprintFrame::encode(CMD_SEARCH, 1,
+                                       FingerprintFrame::hi(startPage), FingerprintFrame::lo(startPage),
+                                       FingerprintFrame::hi(pageCount), FingerprintFrame::lo(pageCount)));
+    FingerprintResponse frame;
+    if (receiveFrame(frame, commandTimeout(CMD_SEARCH)) && frame.confirm() == 0x00)
     {
-        Serial.println("CMD_REG_MODEL Failed!");
-        return 0;
+        // 应答包含页码和得分
+        result.templateId = frame.word(1);
+        result.score = frame.word(3);
+        return true;
     }
+    return false;
+}
 
-    // 步骤4：存储模板
-    _buffer_id = 1;
-    sendCmd15(CMD_STORE_CHAR, _buffer_id, template_id);
-    if (receiveResponse())
+// 选出热点模板：最近一次匹配的模板优先，其余按匹配次数从高到低，只选索引表中存在的
+int Fingerprint::selectHotSet(const uint8_t *indexTable, uint16_t *hotIds)
+{
+    auto present = [&](int id) {
+        return id >= 0 && id < MAX_FINGERPRINT_NUM && (indexTable[id / 8] & (1 << (id % 8)));
+    };
+    int hotCount = 0;
+    if (present(_lastMatchedId))
     {
-        Serial.print("CMD_STORE_CHAR OK! Template ID: ");
-        Serial.println(template_id);
+        hotIds[hotCount++] = _lastMatchedId;
     }
-    else
+    while (hotCount < HOT_SET_SIZE)
     {
-        return 0;
+        int best = -1;
+        for (int id = 0; id < MAX_FINGERPRINT_NUM; id++)
+        {
+            if (!present(id) || _usageCount[id] == 0)
+                continue;
+            bool taken = false;
+            for (int i = 0; i < hotCount; i++)
+                taken |= hotIds[i] == id;
+            if (!taken && (best < 0 || _usageCount[id] > _usageCount[best]))
+                best = id;
+        }
+        if (best < 0)
+            break;
+        hotIds[hotCount++] = best;
     }
-
-    return 1;
+    return hotCount;
 }
 
-// 搜索指纹
-bool Fingerprint::searchFingerprint()
+// 记录一次成功匹配
+void Fingerprint::recordMatch(uint16_t id)
 {
-    FingerprintLock lock(_mutex);
-    int serch_cnt = 0;
-    _buffer_id = 1;
-    while (serch_cnt <= 5)
+    if (id >= MAX_FINGERPRINT_NUM)
+        return;
+    _lastMatchedId = id;
+    if (_usageCount[id] == UINT16_MAX)
     {
-        // 步骤1：获取图像
-        sendCmd12(CMD_GET_IMAGE);
+        // 计数饱和时全部减半，保留相对顺序并让旧的使用习惯逐渐淡出
+        for (int i = 0; i < MAX_FINGERPRINT_NUM; i++)
+            _usageCount[i] >>= 1;
+    }
+    _usageCount[id]++;
+    _usageDirty = true;
+}
 
-        // 等待指纹模组响应
-        if (receiveResponse())
+void Fingerprint::setUsageCounts(const uint16_t *counts)
+{
+    _scheduler.run(FingerprintScheduler::PRIORITY_MANAGE, [&]() {
+        memcpy(_usageCount, counts, sizeof(_usageCount));
+        _usageDirty = false;
+        return true;
+    });
+}
+
+void Fingerprint::getUsageCounts(uint16_t *counts)
+{
+    _scheduler.run(FingerprintScheduler::PRIORITY_MANAGE, [&]() {
+        memcpy(counts, _usageCount, sizeof(_usageCount));
+        return true;
+    }, true);
+}
+
+bool Fingerprint::takeUsageChanges(uint16_t *counts)
+{
+    return _scheduler.run(FingerprintScheduler::PRIORITY_MANAGE, [&]() {
+        if (!_usageDirty)
+            return false;
+        memcpy(counts, _usageCount, sizeof(_usageCount));
+        _usageDirty = false;
+        return true;
+    }, true);
+}
+
+bool Fingerprint::autoIdentifyFingerprint(FingerprintMatchResult &result)
+{
+    return _scheduler.run(FingerprintScheduler::PRIORITY_UNLOCK, [&]() -> bool {
+        result = {};
+        result.matchMode = MATCH_MODE_AUTO_IDENTIFY;
+        result.attempts = 1;
+        uint32_t startTime = millis();
+        uint32_t imageTime = startTime;
+
+        uint8_t backoffs = 0;
+
+        // 发送命令，模组依次返回指令合法性检测、采图结果、搜索结果三个应答包
+        sendFrame(FRAME_AUTO_IDENTIFY);
+
+        FingerprintResponse frame;
+        while (receiveFrame(frame, commandTimeout(CMD_AUTO_IDENTIFY)))
         {
-            Serial.println("Get Image OK!");
+            uint8_t stage = frame.payloadLength > 1 ? frame.payload[1] : 0xFF;
+            if (frame.confirm() != CONFIRM_OK)
+            {
+                LOGW("[FP] AutoIdentify stage %02X failed, code %02X, %lu ms",
+                     stage, frame.confirm(), millis() - startTime);
+                if (stage != AUTO_STAGE_IMAGE)
+                {
+                    _outcomes.*findRetryRule(frame.confirm()).counter += 1; // 其他阶段失败只计数
+                    return false;
+                }
+                // 采图阶段失败按确认码重试，重新发送整条指令
+                if (!retryAfter(frame.confirm(), backoffs) || millis() - startTime >= CAPTURE_WINDOW_MS)
+                {
+                    return false;
+                }
+                result.attempts++;
+                _trace.setRetry(result.attempts - 1);
+                drainInput();
+                sendFrame(FRAME_AUTO_IDENTIFY);
+                continue;
+            }
+
+            switch (stage)
+            {
+            case AUTO_STAGE_CHECK:
+                LOGD("[FP] AutoIdentify command OK, %lu ms", millis() - startTime);
+                break;
+            case AUTO_STAGE_IMAGE:
+                _outcomes.ok++;
+                imageTime = millis();
+                result.captureMs = imageTime - startTime;
+                LOGD("[FP] AutoIdentify image OK, %lu ms", millis() - startTime);
+                break;
+            case AUTO_STAGE_SEARCH:
+                result.searchMs = millis() - imageTime;
+                result.templateId = frame.word(2);
+                result.score = frame.word(4);
+                LOGI("[FP] AutoIdentify matched ID %u, score %u, %lu ms",
+                     result.templateId, result.score, millis() - startTime);
+                recordMatch(result.templateId);
+                return true;
+            default:
+                LOGW("[FP] AutoIdentify unexpected stage %02X", stage);
+                break;
+            }
         }
-        else
+        _outcomes.commError++;
+        LOGW("[FP] AutoIdentify no result, %lu ms", millis() - startTime);
+        return false;
+    });
+}
+
+bool Fingerprint::matchFingerprint(FingerprintMatchResult &result)
+{
+    uint32_t startTime = millis();
+    bool matched = _matchMode == MATCH_MODE_AUTO_IDENTIFY ? autoIdentifyFingerprint(result) : searchFingerprint(result);
+    result.totalMs = millis() - startTime;
+    return matched;
+}
+
+void Fingerprint::setMatchMode(uint8_t mode)
+{
+    if (mode != MATCH_MODE_SEARCH && mode != MATCH_MODE_AUTO_IDENTIFY)
+    {
+        LOGW("[FP] Unknown match mode %02X, ignored", mode);
+        return;
+    }
+    _matchMode = mode;
+    LOGI("[FP] Match mode set to: %s", mode == MATCH_MODE_AUTO_IDENTIFY ? "AutoIdentify" : "Search");
+}
+
+// 模板备份
+bool Fingerprint::uploadTemplate(uint16_t id, const TemplateDataCallback &onData)
+{
+    return _scheduler.run(FingerprintScheduler::PRIORITY_MANAGE, [&]() -> bool {
+        // 步骤1：读出模板到缓冲区1
+        sendFrame(FingerprintFrame::encode(CMD_LOAD_CHAR, 1, FingerprintFrame::hi(id), FingerprintFrame::lo(id)));
+        if (!receiveResponse())
         {
-            Serial.println("Get Image Failed!");
-            serch_cnt++;
-            delay(1000);
-            continue;
+            LOGW("[FP] Load template %u failed", id);
+            return false;
         }
-        // 步骤2：生成特征
-        sendCmd13(CMD_GEN_CHAR, _buffer_id);
-        if (receiveResponse())
+
+        // 步骤2：上传缓冲区1，应答包之后模组连续发送数据包
+        sendFrame(FingerprintFrame::encode(CMD_UP_CHAR, 1));
+        if (!receiveResponse())
         {
-            Serial.println("CMD_GEN_CHAR OK!");
-            break;
+            LOGW("[FP] Upload template %u failed", id);
+            return false;
         }
-        else
+
+        // 步骤3：逐包接收并交给回调，不缓存整个模板
+        FingerprintResponse frame;
+        size_t total = 0;
+        while (receiveFrame(frame, commandTimeout(CMD_UP_CHAR)))
         {
-            Serial.println("CMD_GEN_CHAR Failed!");
-            serch_cnt++;
-            delay(500);
-            continue;
+            if (frame.pid != FingerprintFrame::PID_DATA && frame.pid != FingerprintFrame::PID_DATA_END)
+            {
+                LOGW("[FP] Upload template %u: unexpected packet %02X", id, frame.pid);
+                return false;
+            }
+            bool last = frame.pid == FingerprintFrame::PID_DATA_END;
+            total += frame.payloadLength;
+            if (!onData(frame.payload, frame.payloadLength, last))
+            {
+                LOGW("[FP] Upload template %u aborted", id);
+                return false; // 剩余数据在下次发送指令前丢弃
+            }
+            if (last)
+            {
+                LOGI("[FP] Uploaded template %u, %u bytes", id, total);
+                return true;
+            }
         }
-    }
-    // 步骤3：搜索指纹
-    _buffer_id = 1;
-    sendCmd17(CMD_SEARCH, _buffer_id, 1, 1);
-    if (receiveResponse())
-    {
-        Serial.println("CMD_SEARCH OK!");
-        return 1;
-    }
-    Serial.println("CMD_SEARCH Failed!");
-    return 0;
+        LOGW("[FP] Upload template %u timeout after %u bytes", id, total);
+        return false;
+    });
 }
 
-bool Fingerprint::autoIdentifyFingerprint()
+// 诊断用的原始图像上传
+bool Fingerprint::uploadImage(uint32_t waitMs, FingerprintImageResult &result, const TemplateDataCallback &onData)
 {
-    FingerprintLock lock(_mutex);
-    int search_cnt = 0;
-    _buffer_id = 1;
-    int startTime = millis();
+    return _scheduler.run(FingerprintScheduler::PRIORITY_MANAGE, [&]() -> bool {
+        result = {};
+        result.featureCode = CONFIRM_NO_RESPONSE;
 
-    // 发送命令
-    sendCmd17(CMD_AUTO_IDENTIFY, 0, 0xFFFF, 0);
-    // 等待指纹模组响应
-    if (receiveResponse())
-    {
-        Serial.print("指令合法性检测 OK!");
-        Serial.println(millis() - startTime);
-        startTime = millis();
-        if (receiveResponse())
+        // 步骤1：等待手指并采图
+        uint32_t startTime = millis();
+        do
+        {
+            sendFrame(FRAME_GET_IMAGE);
+            result.captureCode = receiveConfirm();
+            if (result.captureCode != CONFIRM_NO_FINGER)
+                break;
+            _scheduler.idle(IMAGE_POLL_MS);
+        } while (millis() - startTime < waitMs);
+        result.captureMs = millis() - startTime;
+        if (result.captureCode != CONFIRM_OK)
         {
-            Serial.print("采图结果 OK!");
-            if (receiveResponse())
+            LOGW("[FP] Image capture failed, code %02X", result.captureCode);
+            return false;
+        }
+
+        // 步骤2：生成特征只用于判断图像质量，图像缓冲区保持不变
+        sendFrame(FRAME_GEN_CHAR_1);
+        result.featureCode = receiveConfirm();
+
+        // 步骤3：上传图像，应答包之后模组连续发送数据包，逐包交给回调
+        uint32_t uploadStart = millis();
+        sendFrame(FingerprintFrame::encode(CMD_UP_IMAGE));
+        if (!receiveResponse())
+        {
+            LOGW("[FP] Upload image failed");
+            return false;
+        }
+        FingerprintResponse frame;
+        while (receiveFrame(frame, commandTimeout(CMD_UP_IMAGE)))
+        {
+            if (frame.pid != FingerprintFrame::PID_DATA && frame.pid != FingerprintFrame::PID_DATA_END)
+            {
+                LOGW("[FP] Upload image: unexpected packet %02X", frame.pid);
+                return false;
+            }
+            bool last = frame.pid == FingerprintFrame::PID_DATA_END;
+            result.bytes += frame.payloadLength;
+            if (!onData(frame.payload, frame.payloadLength, last))
+            {
+                LOGW("[FP] Upload image aborted after %u bytes", result.bytes);
+                return false; // 剩余数据在下次发送指令前丢弃
+            }
+            if (last)
             {
-                Serial.print("搜索结果 OK!");
+                result.uploadMs = millis() - uploadStart;
+                LOGI("[FP] Uploaded image, %u bytes, feature code %02X, %u ms",
+                     result.bytes, result.featureCode, result.uploadMs);
                 return true;
             }
         }
-    }
+        LOGW("[FP] Upload image timeout after %u bytes", result.bytes);
+        return false;
+    });
+}
+
+// 模板恢复
+bool Fingerprint::downloadTemplate(uint16_t id, const uint8_t *data, size_t length)
+{
+    return _scheduler.run(FingerprintScheduler::PRIORITY_MANAGE, [&]() -> bool {
+        if (data == nullptr || length == 0)
+        {
+            return false;
+        }
+
+        // 步骤1：下载到缓冲区1
+        sendFrame(FingerprintFrame::encode(CMD_DOWN_CHAR, 1));
+        if (!receiveResponse())
+        {
+            LOGW("[FP] Download template %u failed", id);
+            return false;
+        }
+
+        // 步骤2：按数据包长度分包发送，数据包没有应答
+        size_t packetSize = _sysParams.packetSize ? _sysParams.packetSize : LINK_PACKET_SIZE_DEFAULT;
+        for (size_t offset = 0; offset < length; offset += packetSize)
+        {
+            size_t n = min(packetSize, length - offset);
+            sendDataPacket(data + offset, n, offset + n >= length);
+        }
+
+        // 步骤3：存储模板
+        sendFrame(FingerprintFrame::encode(CMD_STORE_CHAR, 1, FingerprintFrame::hi(id), FingerprintFrame::lo(id)));
+        if (receiveResponse())
+        {
+            LOGI("[FP] Restored template %u, %u bytes", id, length);
+            updateIndexCache(id, true);
+            return true;
+        }
+        LOGW("[FP] Store restored template %u failed", id);
+        invalidateIndexCache();
+        return false;
+    });
 }
 
 // 删除指定指纹
 bool Fingerprint::deleteFingerprint(uint16_t id)
 {
-    FingerprintLock lock(_mutex);
-    // 发送删除指令
-    sendCmd16(CMD_DELETE_CHAR, id, 1);
+    return _scheduler.run(FingerprintScheduler::PRIORITY_MANAGE, [&]() -> bool {
+        // 发送删除指令
+        sendFrame(FingerprintFrame::encode(CMD_DELETE_CHAR, FingerprintFrame::hi(id), FingerprintFrame::lo(id), 0x00, 0x01));
 
-    // 等待响应包
-    if (receiveResponse())
-    {
-        Serial.print("Deleted fingerprint with ID: ");
-        Serial.println(id);
-        return true; // 成功
-    }
-    else
-    {
-        Serial.println("Failed to delete fingerprint");
-        return false; // 失败
-    }
+        // 等待响应包
+        if (receiveResponse())
+        {
+            LOGI("Deleted fingerprint with ID: %u", id);
+            updateIndexCache(id, false);
+            if (id < MAX_FINGERPRINT_NUM && _usageCount[id] != 0)
+            {
+                _usageCount[id] = 0;
+                _usageDirty = true;
+            }
+            if (_lastMatchedId == id)
+                _lastMatchedId = -1;
+            return true; // 成功
+        }
+        else
+        {
+            LOGW("Failed to delete fingerprint");
+            invalidateIndexCache();
+            return false; // 失败
+        }
+    });
 }
 
 // 清空指纹库
 bool Fingerprint::clearAllLib()
 {
-    FingerprintLock lock(_mutex);
-    sendCmd12(CMD_CLEAR_LIB);
-    if (receiveResponse())
-    {
-        return 1;
-    }
-    return 0;
+    return _scheduler.run(FingerprintScheduler::PRIORITY_MANAGE, [&]() -> bool {
+        sendFrame(FRAME_CLEAR_LIB);
+        if (receiveResponse())
+        {
+            clearIndexCache();
+            memset(_usageCount, 0, sizeof(_usageCount));
+            _usageDirty = true;
+            _lastMatchedId = -1;
+            return 1;
+        }
+        invalidateIndexCache();
+        return 0;
+    });
 }
 
 bool Fingerprint::setLEDAutoManual(int autoMode)
 {
-    FingerprintLock lock(_mutex);
-    // 发送呼吸灯自动手动切换指令
-    sendCmd13(CMD_LED_AUTO_MANUAL, autoMode);
-    if (receiveResponse())
-    {
-        Serial.print("LED Auto/Manual Mode set to: ");
-        Serial.println(autoMode == 0xFF ? "Auto" : "Manual");
-        return true; // 成功
-    }
-    else
-    {
-        Serial.println("Failed to set LED Auto/Manual Mode");
-        return false; // 失败
-    }
+    return _scheduler.run(FingerprintScheduler::PRIORITY_LED, [&]() -> bool {
+        // 发送呼吸灯自动手动切换指令
+        sendFrame(FingerprintFrame::encode(CMD_LED_AUTO_MANUAL, autoMode));
+        if (receiveResponse())
+        {
+            LOGD("LED Auto/Manual Mode set to: %s", autoMode == 0xFF ? "Auto" : "Manual");
+            return true; // 成功
+        }
+        else
+        {
+            LOGW("Failed to set LED Auto/Manual Mode");
+            return false; // 失败
+        }
+    }, true);
 }
 
 bool Fingerprint::setLEDCmd(uint8_t code, uint8_t startColor, uint8_t endColor, uint8_t loopCount)
 {
-    FingerprintLock lock(_mutex);
-    // 发送呼吸灯指令
-    sendCmd16(CMD_LED_CM, code, startColor, endColor, loopCount);
-    if (receiveResponse())
-    {
-        Serial.print("LED Command set: ");
-        Serial.print("Code: ");
-        Serial.print(code, HEX);
-        Serial.print(", Start Color: ");
-        Serial.print(startColor, HEX);
-        Serial.print(", End Color: ");
-        Serial.print(endColor, HEX);
-        Serial.print(", Loop Count: ");
-        Serial.println(loopCount);
-        return true; // 成功
-    }
-    else
-    {
-        Serial.println("Failed to set LED Command");
-        return false; // 失败
-    }
+    return _scheduler.run(FingerprintScheduler::PRIORITY_LED, [&]() -> bool {
+        // 发送呼吸灯指令
+        sendFrame(FingerprintFrame::encode(CMD_LED_CM, code, startColor, endColor, loopCount));
+        if (receiveResponse())
+        {
+            LOGD("LED Command set: Code: %X, Start Color: %X, End Color: %X, Loop Count: %u",
+                 code, startColor, endColor, loopCount);
+            return true; // 成功
+        }
+        else
+        {
+            LOGW("Failed to set LED Command");
+            return false; // 失败
+        }
+    }, true);
 }
 
 bool Fingerprint::setLEDCmd(uint8_t code, uint8_t startColor, uint8_t endColorOrdutyCicle, uint8_t loopCount, uint8_t time)
 {
-    FingerprintLock lock(_mutex);
-    // 发送呼吸灯指令
-    sendCmd17(CMD_LED_CM, code, startColor, endColorOrdutyCicle, loopCount, time);
-    if (receiveResponse())
-    {
-        Serial.print("LED Command set: ");
-        Serial.print("Code: ");
-        Serial.print(code, HEX);
-        Serial.print(", Start Color: ");
-        Serial.print(startColor, HEX);
-        Serial.print(", End Color Or Duty Cycle: ");
-        Serial.print(endColorOrdutyCicle, HEX);
-        Serial.print(", Loop Count: ");
-        Serial.println(loopCount);
-        Serial.print(", Time: ");
-        Serial.println(time);
-        return true; // 成功
-    }
-    else
-    {
-        Serial.println("Failed to set LED Command");
-        return false; // 失败
-    }
+    return _scheduler.run(FingerprintScheduler::PRIORITY_LED, [&]() -> bool {
+        // 发送呼吸灯指令
+        sendFrame(FingerprintFrame::encode(CMD_LED_CM, code, startColor, endColorOrdutyCicle, loopCount, time));
+        if (receiveResponse())
+        {
+            LOGD("LED Command set: Code: %X, Start Color: %X, End Color Or Duty Cycle: %X, Loop Count: %u, Time: %u",
+                 code, startColor, endColorOrdutyCicle, loopCount, time);
+            return true; // 成功
+        }
+        else
+        {
+            LOGW("Failed to set LED Command");
+            return false; // 失败
+        }
+    }, true);
 }
 
 // 读取有效模板数量
 int Fingerprint::readValidTempleteNum()
 {
-    FingerprintLock lock(_mutex);
-    sendCmd12(CMD_VALID_TEMPLATE_NUM);
     int templateNum = 0;
-    if (receiveResponse(templateNum))
+    uint8_t indexTable[INDEX_TABLE_LENGTH];
+    if (copyIndexCache(indexTable, &templateNum))
     {
         return templateNum;
     }
-    return 0;
+
+    bool loaded = _scheduler.run(FingerprintScheduler::PRIORITY_MANAGE, [&]() -> bool {
+        return copyIndexCache(indexTable, &templateNum) || (refreshIndexCache() && copyIndexCache(indexTable, &templateNum));
+    });
+    return loaded ? templateNum : 0;
 }
 
 // 读取索引表
 bool Fingerprint::readIndexTable(uint8_t *indexTable)
 {
-    FingerprintLock lock(_mutex);
-    // 初始化索引表
-    memset(indexTable, 0, 32);
-    
-    sendCmd13(CMD_READ_INDEX, 0);
-    if (receiveIndexTable(indexTable))
+    // 缓存有效时直接返回，不访问模组，也不等待正在进行的比对
+    if (copyIndexCache(indexTable, nullptr))
     {
-        Serial.println("Index Table read OK");
-        Serial.print("Index Table: ");
-        for (int i = 0; i < 32; i++)
+        return true;
+    }
+
+    return _scheduler.run(FingerprintScheduler::PRIORITY_MANAGE, [&]() -> bool {
+        // 排队期间缓存可能已被其他事务刷新
+        if (copyIndexCache(indexTable, nullptr) || (refreshIndexCache() && copyIndexCache(indexTable, nullptr)))
         {
-            Serial.print("[" + String(i) + "]:");
-            for (int bit = 0; bit < 8; bit++) {
-                Serial.print((indexTable[i] & (1 << bit)) ? "1" : "0");
-            }
-            Serial.print(" ");
+            return true; // 成功
         }
-        Serial.println();
-        return true; // 成功
-    }
-    else
-    {
-        Serial.println("Failed to read index table");
         // 确保失败时索引表被清零
-        memset(indexTable, 0, 32);
+        memset(indexTable, 0, INDEX_TABLE_LENGTH);
         return false; // 失败
-    }
+    });
 }
 
-// 休眠
-bool Fingerprint::sleepFingerprint()
+bool Fingerprint::loadIndexTable()
 {
-    sendCmd12(CMD_SLEEP); // 发送休眠指令
-    if (receiveResponse())
-    {
-        return true; // 成功
-    }
-    else
+    return _scheduler.run(FingerprintScheduler::PRIORITY_MANAGE, [&]() -> bool {
+        return refreshIndexCache();
+    });
+}
+
+// 缓存有效时拷贝索引表和模板数量
+bool Fingerprint::copyIndexCache(uint8_t *indexTable, int *templateCount)
+{
+    bool valid = false;
+    if (xSemaphoreTake(_cacheMutex, portMAX_DELAY) == pdTRUE)
     {
-        return false; // 失败
+        valid = _cachedGeneration == _indexGeneration;
+        if (valid)
+        {
+            memcpy(indexTable, _indexTable, INDEX_TABLE_LENGTH);
+            if (templateCount)
+                *templateCount = _templateCount;
+        }
+        xSemaphoreGive(_cacheMutex);
     }
+    return valid;
 }
 
-// 发送指令包
-void Fingerprint::sendCmd12(uint8_t cmd)
-{
-    uint8_t packet[12];
-    uint16_t length = 3;
-    uint16_t checksum = 1 + length + cmd;
-
-    // 构建指令包
-    packet[0] = HEADER_HIGH;
-    packet[1] = HEADER_LOW;
-    packet[2] = (DEVICE_ADDRESS >> 24) & 0xFF;
-    packet[3] = (DEVICE_ADDRESS >> 16) & 0xFF;
-    packet[4] = (DEVICE_ADDRESS >> 8) & 0xFF;
-    packet[5] = DEVICE_ADDRESS & 0xFF;
-    packet[6] = 0x01;                 // 包标识：命令包
-    packet[7] = (length >> 8) & 0xFF; // 包长度高字节
-    packet[8] = length & 0xFF;        // 包长度低字节
-    packet[9] = cmd;
-    packet[10] = (checksum >> 8) & 0xFF;
-    packet[11] = checksum & 0xFF;
-
-#if defined(HLK_DEBUG)
-    Serial.println("send1:");
-    printHex(packet, (12));
-#endif
+// 从模组读取索引表更新缓存，在调度器事务中调用
+bool Fingerprint::refreshIndexCache()
+{
+    uint8_t indexTable[INDEX_TABLE_LENGTH] = {0};
+    uint32_t generation = _indexGeneration; // 事务执行期间指纹库不会被修改
 
-    // 发送指令包
-    for (int i = 0; i < (12); i++)
+    sendFrame(FRAME_READ_INDEX);
+    if (!receiveIndexTable(indexTable))
     {
-        Serial1.write(packet[i]);
+        LOGW("Failed to read index table");
+        return false;
     }
-}
-
-// 发送指令包
-void Fingerprint::sendCmd13(uint8_t cmd, uint8_t param1)
-{
-    uint8_t packet[13];
-    uint16_t length = 4;
-    uint16_t checksum = 1 + length + cmd + param1;
-
-    // 构建指令包
-    packet[0] = HEADER_HIGH;
-    packet[1] = HEADER_LOW;
-    packet[2] = (DEVICE_ADDRESS >> 24) & 0xFF;
-    packet[3] = (DEVICE_ADDRESS >> 16) & 0xFF;
-    packet[4] = (DEVICE_ADDRESS >> 8) & 0xFF;
-    packet[5] = DEVICE_ADDRESS & 0xFF;
-    packet[6] = 0x01;                 // 包标识：命令包
-    packet[7] = (length >> 8) & 0xFF; // 包长度高字节
-    packet[8] = length & 0xFF;        // 包长度低字节
-    packet[9] = cmd;
-    packet[10] = param1;
-    packet[11] = (checksum >> 8) & 0xFF;
-    packet[12] = checksum & 0xFF;
 
-#if defined(HLK_DEBUG)
-    Serial.println("send2:");
-    printHex(packet, (13));
-#endif
+    int count = 0;
+    for (int i = 0; i < INDEX_TABLE_LENGTH; i++)
+    {
+        count += __builtin_popcount(indexTable[i]);
+    }
 
-    // 发送指令包
-    for (int i = 0; i < (13); i++)
+    if (xSemaphoreTake(_cacheMutex, portMAX_DELAY) == pdTRUE)
+    {
+        memcpy(_indexTable, indexTable, INDEX_TABLE_LENGTH);
+        _templateCount = count;
+        _cachedGeneration = generation;
+        xSemaphoreGive(_cacheMutex);
+    }
+    LOGI("Index Table read OK, %d templates", count);
+    // 索引表按32位一组记录，十六进制的字节顺序与模组返回的顺序一致
+    uint32_t words[INDEX_TABLE_LENGTH / 4];
+    for (int i = 0; i < INDEX_TABLE_LENGTH / 4; i++)
     {
-        Serial1.write(packet[i]);
+        words[i] = (uint32_t)indexTable[i * 4] << 24 | (uint32_t)indexTable[i * 4 + 1] << 16 |
+                   (uint32_t)indexTable[i * 4 + 2] << 8 | indexTable[i * 4 + 3];
     }
+    LOGD("Index Table %08X %08X %08X %08X %08X %08X %08X %08X",
+         words[0], words[1], words[2], words[3], words[4], words[5], words[6], words[7]);
+    return true;
 }
 
-// 发送指令包
-void Fingerprint::sendCmd15(uint8_t cmd, uint8_t param1, uint16_t param2)
-{
-    uint8_t packet[15];
-    uint16_t length = 6;
-    uint16_t checksum = 1 + length + cmd + param1 + (param2 >> 8) + (param2 & 0xFF);
-
-    // 构建指令包
-    packet[0] = HEADER_HIGH;
-    packet[1] = HEADER_LOW;
-    packet[2] = (DEVICE_ADDRESS >> 24) & 0xFF;
-    packet[3] = (DEVICE_ADDRESS >> 16) & 0xFF;
-    packet[4] = (DEVICE_ADDRESS >> 8) & 0xFF;
-    packet[5] = DEVICE_ADDRESS & 0xFF;
-    packet[6] = 0x01;                 // 包标识：命令包
-    packet[7] = (length >> 8) & 0xFF; // 包长度高字节
-    packet[8] = length & 0xFF;        // 包长度低字节
-    packet[9] = cmd;
-    packet[10] = param1;
-    packet[11] = (param2 >> 8) & 0xFF;
-    packet[12] = param2 & 0xFF;
-    packet[13] = (checksum >> 8) & 0xFF;
-    packet[14] = checksum & 0xFF;
+// 修改指纹库成功后同步更新缓存
+void Fingerprint::updateIndexCache(uint16_t id, bool present)
+{
+    if (id >= INDEX_TABLE_LENGTH * 8)
+        return;
+    if (xSemaphoreTake(_cacheMutex, portMAX_DELAY) == pdTRUE)
+    {
+        bool valid = _cachedGeneration == _indexGeneration;
+        _indexGeneration++;
+        if (valid)
+        {
+            uint8_t mask = 1 << (id % 8);
+            bool wasPresent = _indexTable[id / 8] & mask;
+            if (present && !wasPresent)
+            {
+                _indexTable[id / 8] |= mask;
+                _templateCount++;
+            }
+            else if (!present && wasPresent)
+            {
+                _indexTable[id / 8] &= ~mask;
+                _templateCount--;
+            }
+            _cachedGeneration = _indexGeneration;
+        }
+        xSemaphoreGive(_cacheMutex);
+    }
+}
 
-#if defined(HLK_DEBUG)
-    Serial.println("send:");
-    printHex(packet, (15));
-#endif
+void Fingerprint::clearIndexCache()
+{
+    if (xSemaphoreTake(_cacheMutex, portMAX_DELAY) == pdTRUE)
+    {
+        memset(_indexTable, 0, INDEX_TABLE_LENGTH);
+        _templateCount = 0;
+        _cachedGeneration = ++_indexGeneration;
+        xSemaphoreGive(_cacheMutex);
+    }
+}
 
-    // 发送指令包
-    for (int i = 0; i < (15); i++)
+// 指令结果不确定，下次读取时从模组重新加载
+void Fingerprint::invalidateIndexCache()
+{
+    if (xSemaphoreTake(_cacheMutex, portMAX_DELAY) == pdTRUE)
     {
-        Serial1.write(packet[i]);
+        _indexGeneration++;
+        xSemaphoreGive(_cacheMutex);
     }
 }
 
-// 发送指令包
-void Fingerprint::sendCmd16(uint8_t cmd, uint8_t param1, uint16_t param2)
-{
-    uint8_t packet[16];
-    uint16_t length = 7;
-    uint16_t checksum = 1 + length + cmd + (param1 >> 8) + (param1 & 0xFF) + (param2 >> 8) + (param2 & 0xFF);
-
-    // 构建指令包
-    packet[0] = HEADER_HIGH;
-    packet[1] = HEADER_LOW;
-    packet[2] = (DEVICE_ADDRESS >> 24) & 0xFF;
-    packet[3] = (DEVICE_ADDRESS >> 16) & 0xFF;
-    packet[4] = (DEVICE_ADDRESS >> 8) & 0xFF;
-    packet[5] = DEVICE_ADDRESS & 0xFF;
-    packet[6] = 0x01;                 // 包标识：命令包
-    packet[7] = (length >> 8) & 0xFF; // 包长度高字节
-    packet[8] = length & 0xFF;        // 包长度低字节
-    packet[9] = cmd;
-    packet[10] = (param1 >> 8) & 0xFF;
-    packet[11] = param1 & 0xFF;
-    packet[12] = (param2 >> 8) & 0xFF;
-    packet[13] = param2 & 0xFF;
-    packet[14] = (checksum >> 8) & 0xFF;
-    packet[15] = checksum & 0xFF;
+// 休眠
+bool Fingerprint::sleepFingerprint()
+{
+    return _scheduler.run(FingerprintScheduler::PRIORITY_MANAGE, [&]() -> bool {
+        sendFrame(FRAME_SLEEP); // 发送休眠指令
+        if (receiveResponse())
+        {
+            return true; // 成功
+        }
+        else
+        {
+            return false; // 失败
+        }
+    });
+}
 
-#if defined(HLK_DEBUG)
-    Serial.println("send:");
-    printHex(packet, (16));
-#endif
+bool Fingerprint::resumeFromSleep()
+{
+    return _scheduler.run(FingerprintScheduler::PRIORITY_UNLOCK, [&]() -> bool {
+        drainInput(); // 丢弃休眠期间可能残留的数据
+        if (!readSystemParameters())
+        {
+            LOGW("[FP] Module did not respond after sleep");
+            return false;
+        }
+        return true;
+    });
+}
 
-    // 发送指令包
-    for (int i = 0; i < (16); i++)
+// 按实测耗时设定超时：取追踪统计中的最大耗时的两倍加余量，模组偶尔变慢时留有空间；
+// 超时本身也计入统计（耗时为等待的时间），所以一次超时后下一次的超时会变长，直到回到手册值
+uint32_t Fingerprint::commandTimeout(uint8_t cmd)
+{
+    uint32_t limit = commandTimeoutLimit(cmd);
+    FingerprintTraceHistogram histogram;
+    if (!_trace.histogramOf(cmd, histogram) || histogram.count < TIMEOUT_MIN_SAMPLES)
     {
-        Serial1.write(packet[i]);
+        return limit;
     }
+    return min(limit, histogram.maxMs * 2 + TIMEOUT_MARGIN_MS);
 }
 
-// 发送指令包
-void Fingerprint::sendCmd16(uint8_t cmd, uint8_t param1, uint16_t param2, uint16_t param3, uint16_t param4)
-{
-    uint8_t packet[16];
-    uint16_t length = 7;
-    uint16_t checksum = 1 + length + cmd + param1 + param2 + param3 + param4;
-
-    // 构建指令包
-    packet[0] = HEADER_HIGH;
-    packet[1] = HEADER_LOW;
-    packet[2] = (DEVICE_ADDRESS >> 24) & 0xFF;
-    packet[3] = (DEVICE_ADDRESS >> 16) & 0xFF;
-    packet[4] = (DEVICE_ADDRESS >> 8) & 0xFF;
-    packet[5] = DEVICE_ADDRESS & 0xFF;
-    packet[6] = 0x01;                 // 包标识：命令包
-    packet[7] = (length >> 8) & 0xFF; // 包长度高字节
-    packet[8] = length & 0xFF;        // 包长度低字节
-    packet[9] = cmd;
-    packet[10] = param1;
-    packet[11] = param2;
-    packet[12] = param3;
-    packet[13] = param4;
-    packet[14] = (checksum >> 8) & 0xFF;
-    packet[15] = checksum & 0xFF;
+// 各指令的应答超时上限（毫秒），按模组手册的典型处理时间加余量设定，还没有实测数据时使用
+uint32_t Fingerprint::commandTimeoutLimit(uint8_t cmd)
+{
+    switch (cmd)
+    {
+    case CMD_LED_CM:
+    case CMD_LED_AUTO_MANUAL:
+    case CMD_READ_SYSPARA:
+    case CMD_VALID_TEMPLATE_NUM:
+    case CMD_READ_INDEX:
+    case CMD_SLEEP:
+        return 200;
+    case CMD_GET_IMAGE:
+    case CMD_GEN_CHAR:
+    case CMD_MATCH:
+        return 300;
+    case CMD_LOAD_CHAR:
+        return 300;
+    case CMD_SEARCH:
+    case CMD_REG_MODEL:
+    case CMD_STORE_CHAR:
+    case CMD_DELETE_CHAR:
+    case CMD_UP_CHAR:   // 上传过程中相邻数据包的间隔
+    case CMD_UP_IMAGE:
+    case CMD_DOWN_CHAR:
+        return 500;
+    case CMD_CLEAR_LIB:
+        return 1000;
+    case CMD_AUTO_IDENTIFY:
+        return 2000; // 每个阶段都包含等待采图的时间
+    default:
+        return 500;
+    }
+}
 
-#if defined(HLK_DEBUG)
-    Serial.println("send:");
-    printHex(packet, (16));
-#endif
+// 串口收到数据时由UART事件任务回调，唤醒正在等待应答的任务
+void Fingerprint::onSerialReceive()
+{
+    if (_rxSignal)
+        xSemaphoreGive(_rxSignal);
+}
 
-    // 发送指令包
-    for (int i = 0; i < (16); i++)
+// 丢弃串口中残留的数据，准备接收新的应答
+void Fingerprint::drainInput()
+{
+    while (_transport.available())
     {
-        Serial1.write(packet[i]);
+        _transport.read();
     }
+    _parser.reset();
+    if (_rxSignal)
+        xSemaphoreTake(_rxSignal, 0);
 }
 
 // 发送指令包
-void Fingerprint::sendCmd17(uint8_t cmd, uint8_t param1, uint16_t param2, uint16_t param3)
-{
-    uint8_t packet[17];
-    uint16_t length = 8;
-    uint16_t checksum = 1 + length + cmd + param1 + (param2 >> 8) + (param2 & 0xFF) + (param3 >> 8) + (param3 & 0xFF);
-
-    // 构建指令包
-    packet[0] = HEADER_HIGH;
-    packet[1] = HEADER_LOW;
-    packet[2] = (DEVICE_ADDRESS >> 24) & 0xFF;
-    packet[3] = (DEVICE_ADDRESS >> 16) & 0xFF;
-    packet[4] = (DEVICE_ADDRESS >> 8) & 0xFF;
-    packet[5] = DEVICE_ADDRESS & 0xFF;
-    packet[6] = 0x01;                 // 包标识：命令包
-    packet[7] = (length >> 8) & 0xFF; // 包长度高字节
-    packet[8] = length & 0xFF;        // 包长度低字节
-    packet[9] = cmd;
-    packet[10] = param1;
-    packet[11] = (param2 >> 8) & 0xFF;
-    packet[12] = param2 & 0xFF;
-    packet[13] = (param3 >> 8) & 0xFF;
-    packet[14] = param3 & 0xFF;
-    packet[15] = (checksum >> 8) & 0xFF;
-    packet[16] = checksum & 0xFF;
-
+void Fingerprint::sendBytes(const uint8_t *data, size_t len)
+{
 #if defined(HLK_DEBUG)
     Serial.println("send:");
-    printHex(packet, (17));
+    printHex((uint8_t *)data, len);
 #endif
 
-    // 发送指令包
-    for (int i = 0; i < (17); i++)
-    {
-        Serial1.write(packet[i]);
-    }
-}
-
-void Fingerprint::sendCmd17(uint8_t cmd, uint8_t param1, uint8_t param2, uint8_t param3, uint8_t param4, uint8_t param5)
-{
-    uint8_t packet[17];
-    uint16_t length = 8;
-    uint16_t checksum = 1 + length + cmd + param1 + param2 + param3 + param4 + param5;
-
-    // 构建指令包
-    packet[0] = HEADER_HIGH;
-    packet[1] = HEADER_LOW;
-    packet[2] = (DEVICE_ADDRESS >> 24) & 0xFF;
-    packet[3] = (DEVICE_ADDRESS >> 16) & 0xFF;
-    packet[4] = (DEVICE_ADDRESS >> 8) & 0xFF;
-    packet[5] = DEVICE_ADDRESS & 0xFF;
-    packet[6] = 0x01;                 // 包标识：命令包
-    packet[7] = (length >> 8) & 0xFF; // 包长度高字节
-    packet[8] = length & 0xFF;        // 包长度低字节
-    packet[9] = cmd;
-    packet[10] = param1;
-    packet[11] = param2;
-    packet[12] = param3;
-    packet[13] = param4;
-    packet[14] = param5;
-    packet[15] = (checksum >> 8) & 0xFF;
-    packet[16] = checksum & 0xFF;
+    drainInput();
+    _lastCmd = data[FingerprintFrame::HEAD_LENGTH];
+    _trace.begin(_lastCmd);
+    _transport.write(data, len);
+}
 
+// 发送数据包，不清空接收缓冲，也不改变应答超时对应的指令
+void Fingerprint::sendDataPacket(const uint8_t *data, size_t len, bool last)
+{
+    uint8_t packet[FingerprintFrame::MAX_FRAME_LENGTH];
+    size_t packetLength = FingerprintFrame::encodeData(last, data, min(len, FingerprintFrame::MAX_PAYLOAD_LENGTH), packet);
 #if defined(HLK_DEBUG)
-    Serial.println("send:");
-    printHex(packet, (17));
+    Serial.println("send data:");
+    printHex(packet, packetLength);
 #endif
-
-    // 发送指令包
-    for (int i = 0; i < (17); i++)
-    {
-        Serial1.write(packet[i]);
-    }
+    _transport.write(packet, packetLength);
 }
 
-// 接收响应包
-bool Fingerprint::receiveResponse()
+// 接收一个完整且校验正确的包，收到最后一个字节立即返回；超时返回false
+bool Fingerprint::receiveFrame(FingerprintResponse &frame, uint32_t timeoutMs)
 {
-    uint8_t response[50] = {0};
-    uint8_t index = 0;
     uint32_t startTime = millis();
-    uint32_t lastDataTime = startTime;
-
-    // 等待响应包
-    while (millis() - startTime < 500)
-    { // 保留超时机制，但可以提前退出
-        if (Serial1.available())
+    while (true)
+    {
+        while (_parser.hasPending() || _transport.available())
         {
-            response[index++] = Serial1.read();
-            lastDataTime = millis(); // 更新最后一次接收数据的时间
-
-            // 检查是否已接收到完整的响应包
-            // 通常响应包至少有12字节，索引到11，且第9字节是确认码
-            if (index >= 12)
+            FingerprintFrameParser::Status status;
+            if (_parser.hasPending())
             {
-                // 检查包头
-                if (response[0] == HEADER_HIGH && response[1] == HEADER_LOW)
-                {
-                    // 获取包长度
-                    uint16_t packageLength = (response[7] << 8) | response[8];
-                    // 计算完整包应有的长度：包头(2) + 设备地址(4) + 包标识(1) + 包长度(2) + 校验和(2)
-                    uint16_t totalLength = 2 + 4 + 1 + packageLength + 2;
-
-                    // 如果已接收到完整包，提前退出
-                    if (index >= totalLength)
-                    {
-                        break;
-                    }
-                }
+                // 坏包重新扫描后剩下的字节
+                status = _parser.poll();
             }
-        }
-        else
-        {
-            // 如果一段时间内没有新数据（例如20ms），且已经接收了一些数据，可能表示数据已传输完毕
-            if (index > 0 && (millis() - lastDataTime > 200))
+            else
             {
-                break;
+                _trace.firstByte();
+                status = _parser.feed((uint8_t)_transport.read());
             }
-            // 没有数据可读时，让出CPU给其他任务，避免触发看门狗
-            yield();
-        }
-    }
-
-    // 打印响应包
+            if (status == FingerprintFrameParser::FRAME_READY)
+            {
+                frame = _parser.frame();
+                // 数据包没有确认码，能收到数据包说明之前的应答成功
+                _trace.frame(frame.pid == FingerprintFrame::PID_ACK ? frame.confirm() : (uint8_t)CONFIRM_OK);
 #if defined(HLK_DEBUG)
-    printResponse(response, index);
+                printResponse(frame.payload, frame.payloadLength);
 #endif
+                return true;
+            }
+        }
 
-    // 检查确认码
-    if (index >= 12 && response[9] == 0x00)
-    {
-        return true; // 成功
-    }
-    else
-    {
-        return false; // 失败
+        uint32_t elapsed = millis() - startTime;
+        if (elapsed >= timeoutMs)
+        {
+            LOGW("[FP] Response timeout, cmd %02X, %lu ms", _lastCmd, timeoutMs);
+            _trace.frame(CONFIRM_NO_RESPONSE);
+            return false;
+        }
+        // 阻塞等待串口数据到达，不再轮询
+        xSemaphoreTake(_rxSignal, (timeoutMs - elapsed) / portTICK_PERIOD_MS + 1);
     }
 }
 
-bool Fingerprint::waitStartSignal()
+// 接收应答包并返回确认码，超时返回 CONFIRM_NO_RESPONSE
+uint8_t Fingerprint::receiveConfirm()
 {
-    FingerprintLock lock(_mutex);
-    uint32_t startTime = millis();
-
-    // 等待响应包，最多等待500毫秒
-    while (millis() - startTime < 500)
-    { // 保留超时机制，但可以提前退出
-        if (Serial1.available())
-        {
-            if(Serial1.read() == 0x55) // 检测到开始信号
-            {
-                Serial.println("[FP] Start signal received.");
-                return true; // 成功接收到开始信号
-            }
-        }
-        // 使用 yield() 代替 delay()，让其他任务有机会运行，避免触发看门狗
-        yield();
-        delayMicroseconds(10000); // 10ms
+    FingerprintResponse frame;
+    if (!receiveFrame(frame, commandTimeout(_lastCmd)))
+    {
+        return CONFIRM_NO_RESPONSE;
     }
-    return false; // 超时未接收到开始信号
+    return frame.confirm();
 }
 
 // 接收响应包
-bool Fingerprint::receiveResponse(int &data)
+bool Fingerprint::receiveResponse()
 {
-    uint8_t response[50] = {0};
-    uint8_t index = 0;
-    uint32_t startTime = millis();
-    uint32_t lastDataTime = startTime;
-
-    // 等待响应包
-    while (millis() - startTime < 500)
-    { // 保留超时机制，但可以提前退出
-        if (Serial1.available())
-        {
-            response[index++] = Serial1.read();
-            lastDataTime = millis(); // 更新最后一次接收数据的时间
-
-            // 检查是否已接收到完整的响应包
-            // 通常响应包至少有12字节，且第9字节是确认码
-            if (index >= 12)
-            {
-                // 检查包头
-                if (response[0] == HEADER_HIGH && response[1] == HEADER_LOW)
-                {
-                    // 获取包长度
-                    uint16_t packageLength = (response[7] << 8) | response[8];
-                    // 计算完整包应有的长度：包头(2) + 设备地址(4) + 包标识(1) + 包内容(packageLength) + 校验和(2)
-                    uint16_t totalLength = 2 + 4 + 1 + packageLength + 2;
-
-                    // 如果已接收到完整包，提前退出
-                    if (index >= totalLength)
-                    {
-                        break;
-                    }
-                }
-            }
-        }
-        else
-        {
-            // 如果一段时间内没有新数据（例如200ms），且已经接收了一些数据，可能表示数据已传输完毕
-            if (index > 0 && (millis() - lastDataTime > 200))
-            {
-                break;
-            }
-            // 没有数据可读时，让出CPU给其他任务，避免触发看门狗
-            yield();
-        }
-    }
-
-    // 打印响应包
-#if defined(HLK_DEBUG)
-    printResponse(response, index);
-#endif
-
-    data = (response[10] << 8) | response[11]; // 获取数据包中的数据
-    // 检查确认码
-    if (index >= 12 && response[9] == 0x00)
+    FingerprintResponse frame;
+    if (!receiveFrame(frame, commandTimeout(_lastCmd)))
     {
-        return true; // 成功
-    }
-    else
-    {
-        return false; // 失败
+        return false;
     }
+    // 检查确认码
+    return frame.confirm() == 0x00;
 }
 
-
-// 接收响应包
-bool Fingerprint::receiveIndexTable(uint8_t* data)
+bool Fingerprint::waitStartSignal()
 {
-    uint8_t response[45] = {0};
-    uint8_t index = 0;
-    uint32_t startTime = millis();
-    uint32_t lastDataTime = startTime;
+    return _scheduler.run(FingerprintScheduler::PRIORITY_UNLOCK, [&]() -> bool {
+        uint32_t startTime = millis();
 
-    // 等待响应包
-    while (millis() - startTime < 1000)
-    { // 保留超时机制，但可以提前退出
-        if (Serial1.available())
+        // 等待开始信号，最多等待500毫秒
+        while (millis() - startTime < 500)
         {
-            response[index++] = Serial1.read();
-            lastDataTime = millis(); // 更新最后一次接收数据的时间
-
-            // 检查是否已接收到完整的响应包
-            // 通常响应包至少有12字节，且第9字节是确认码
-            if (index >= 12)
+            while (_transport.available())
             {
-                // 检查包头
-                if (response[0] == HEADER_HIGH && response[1] == HEADER_LOW)
+                if(_transport.read() == 0x55) // 检测到开始信号
                 {
-                    // 获取包长度
-                    uint16_t packageLength = (response[7] << 8) | response[8];
-                    // 计算完整包应有的长度：包头(2) + 设备地址(4) + 包标识(1) + 包长度(2) + 包内容(packageLength) 
-                    uint16_t totalLength = 2 + 4 + 1 + 2 + packageLength;
-
-                    // 如果已接收到完整包，提前退出
-                    if (index >= totalLength)
-                    {
-                        break;
-                    }
+                    LOGI("[FP] Start signal received.");
+                    return true; // 成功接收到开始信号
                 }
             }
+            // 阻塞等待串口数据，让出CPU
+            xSemaphoreTake(_rxSignal, 10 / portTICK_PERIOD_MS);
         }
-        else
-        {
-            // 如果一段时间内没有新数据（例如200ms），且已经接收了一些数据，可能表示数据已传输完毕
-            if (index > 0 && (millis() - lastDataTime > 200))
-            {
-                break;
-            }
-        }
-    }
+        return false; // 超时未接收到开始信号
+    });
+}
 
-    // 检查是否接收到了足够的数据
-    if (index < 12) {
-        Serial.printf("[FP] receiveIndexTable: Insufficient data received, only %d bytes\n", index);
+// 接收响应包
+bool Fingerprint::receiveResponse(int &data)
+{
+    FingerprintResponse frame;
+    if (!receiveFrame(frame, commandTimeout(_lastCmd)))
+    {
+        data = 0;
         return false;
     }
+    data = frame.word(1); // 获取数据包中的数据
+    // 检查确认码
+    return frame.confirm() == 0x00;
+}
 
-    // 检查包头
-    if (response[0] != HEADER_HIGH || response[1] != HEADER_LOW) {
-        Serial.printf("[FP] receiveIndexTable: Invalid header %02X %02X\n", response[0], response[1]);
+// 接收响应包
+bool Fingerprint::receiveIndexTable(uint8_t* data)
+{
+    FingerprintResponse frame;
+    if (!receiveFrame(frame, commandTimeout(_lastCmd))) {
+        LOGW("[FP] receiveIndexTable: No valid frame received");
         return false;
     }
 
-    // 打印响应包
-#if defined(HLK_DEBUG)
-    printResponse(response, index);
-#endif
-    // 从索引10开始复制32字节到data数组
-    memcpy(data, &response[10], 32);
     // 检查确认码
-    if (response[9] == 0x00)
+    if (frame.confirm() != 0x00)
     {
-        Serial.println("[FP] receiveIndexTable: Success");
-        return true; // 成功
+        LOGW("[FP] receiveIndexTable: Error response code %02X", frame.confirm());
+        return false; // 失败
     }
-    else
+    if (frame.payloadLength < 1 + INDEX_TABLE_LENGTH)
     {
-        Serial.printf("[FP] receiveIndexTable: Error response code %02X\n", response[9]);
-        return false; // 失败
+        LOGW("[FP] receiveIndexTable: Short payload %d", frame.payloadLength);
+        return false;
     }
+    // 确认码之后是32字节索引表
+    memcpy(data, frame.payload + 1, INDEX_TABLE_LENGTH);
+    LOGD("[FP] receiveIndexTable: Success");
+    return true; // 成功
 }
 // 打印响应包
-void Fingerprint::printResponse(uint8_t *response, uint8_t length)
+void Fingerprint::printResponse(const uint8_t *response, size_t length)
 {
     Serial.print("Response:");
-    for (int i = 0; i < length; i++)
+    for (size_t i = 0; i < length; i++)
     {
         if (response[i] < 0x10)
             Serial.print('0');
@@ -998,4 +1356,4 @@ void Fingerprint::printResponse(uint8_t *response, uint8_t length)
         Serial.print(" ");
     }
     Serial.println();
-}
\ No newline at end of file
+}
@@ -9,15 +9,67 @@
 #include <Arduino.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
+#include <functional>
+#include "FingerprintFrame.h"
+#include "FingerprintTrace.h"
+#include "FingerprintScheduler.h"
+#include "FingerprintTransport.h"
+#include "Common.h"
+
+// 模组系统参数（读模组基本参数指令的应答）
+struct FingerprintSystemParameters
+{
+    uint16_t registerCount;  // 注册次数
+    uint16_t templateSize;   // 指纹模板大小
+    uint16_t librarySize;    // 指纹库大小
+    uint16_t scoreLevel;     // 安全等级
+    uint32_t deviceAddress;  // 设备地址
+    uint16_t packetSize;     // 数据包长度（字节）
+    uint32_t baudRate;       // 波特率
+};
+
+// 指纹比对结果
+struct FingerprintMatchResult
+{
+    uint16_t templateId;  // 匹配的模板ID
+    uint16_t score;       // 匹配得分
+    uint8_t attempts;     // 采图次数（含失败重试）
+    uint8_t matchMode;    // 比对方式
+    uint16_t captureMs;   // 采图耗时（含重试）
+    uint16_t extractMs;   // 生成特征耗时（自动验证模式包含在搜索耗时中）
+    uint16_t searchMs;    // 搜索耗时
+    uint16_t totalMs;     // 从触摸到比对完成的总耗时
+};
+
+// 诊断用的原始图像上传结果
+struct FingerprintImageResult
+{
+    uint8_t captureCode;  // 采图确认码，CONFIRM_NO_FINGER 表示等待时间内没有手指
+    uint8_t featureCode;  // 对这张图像生成特征的确认码，反映图像质量
+    uint32_t bytes;       // 上传的图像数据长度
+    uint16_t captureMs;   // 等待手指并采图的耗时
+    uint16_t uploadMs;    // 图像上传耗时（含数据回调的等待）
+};
+
+// 采图和比对结果分类计数，由确认码重试策略统计
+struct FingerprintOutcomeCounts
+{
+    uint32_t ok;         // 采图并生成特征成功
+    uint32_t noFinger;   // 还没有手指，立即重试
+    uint32_t poorImage;  // 图像质量差（干、湿、乱、特征点少），短暂退避后重试
+    uint32_t commError;  // 通信错误（收包错误、无应答）
+    uint32_t noMatch;    // 特征正常但指纹库中没有匹配
+    uint32_t fatal;      // 其他错误，立即中止
+};
 
 class Fingerprint
 {
 public:
     // 构造函数
-    Fingerprint(int rx_pin, int tx_pin);
+    Fingerprint(FingerprintTransport &transport);
 
     // 初始化函数
-    void begin(uint32_t baud_rate = 57600);
+    void begin(uint32_t baud_rate = LINK_BAUD_DEFAULT);
 
     // 开启和关闭电源
     void setPower(bool on);
@@ -25,29 +77,81 @@ public:
     // 等待指纹模组启动信号
     bool waitStartSignal();
 
+    // 手指是否在传感器上（触摸输出线）
+    bool isFingerTouching() { return _transport.isTouched(); }
+
     // 读取模组基本参数
     bool readInfo();
+    const FingerprintSystemParameters &systemParameters() const { return _sysParams; }
+
+    // 协商通信参数：找到模组当前波特率，再提高波特率和数据包长度，失败时回退到默认波特率
+    bool negotiateLink(uint32_t baudRate = LINK_BAUD_FAST, uint16_t packetSize = LINK_PACKET_SIZE_MAX);
+    uint32_t getBaudRate() const { return _baudRate; }
+    uint16_t getPacketSize() const { return _sysParams.packetSize; }
 
-    // 注册指纹
-    bool registerFingerprint(int template_id = 0);
+    // 注册指纹的各个步骤，每一步是一个单独的事务，两次采图之间不占用模组
+    bool captureFeature(uint8_t bufferId);
+    bool mergeFeatures();
+    // 比对缓冲区1（合并后的模板）与缓冲区2的特征，score 为比对得分，不匹配时为0
+    bool matchFeatures(uint16_t &score);
+    bool storeTemplate(uint16_t template_id);
 
     // 搜索指纹
-    bool searchFingerprint();
-    bool autoIdentifyFingerprint();
+    bool searchFingerprint(FingerprintMatchResult &result);
+    bool autoIdentifyFingerprint(FingerprintMatchResult &result);
+    // 按当前比对方式验证指纹
+    bool matchFingerprint(FingerprintMatchResult &result);
+
+    // 热点优先搜索：先搜索最近/最常匹配的模板，未命中再搜索整个有效范围
+    void setHotSearch(bool enable) { _hotSearch = enable; }
+    bool getHotSearch() const { return _hotSearch; }
+    // 各模板的匹配次数，用于选出热点模板，由调用者负责持久化
+    void setUsageCounts(const uint16_t *counts);
+    void getUsageCounts(uint16_t *counts);
+    // 匹配次数在上次取出后有变化时复制到 counts 并清除变化标志，没有变化返回 false
+    bool takeUsageChanges(uint16_t *counts);
+
+    // 确认码重试策略的各类结果计数
+    void getOutcomeCounts(FingerprintOutcomeCounts &counts);
+
+    // 指令耗时追踪
+    FingerprintTrace &trace() { return _trace; }
+    // 指令的应答超时（毫秒）：记录够 TIMEOUT_MIN_SAMPLES 次后按实测最大耗时设定，不超过手册值
+    uint32_t commandTimeout(uint8_t cmd);
+
+    // 指令调度器，用于异步提交事务（事务中可以直接调用本类的公开接口）
+    FingerprintScheduler &scheduler() { return _scheduler; }
+
+    // 比对方式
+    void setMatchMode(uint8_t mode);
+    uint8_t getMatchMode() const { return _matchMode; }
+
+    // 模板备份：从指纹库读出模板并逐个数据包回调，回调返回false中止
+    typedef std::function<bool(const uint8_t *data, uint16_t length, bool last)> TemplateDataCallback;
+    bool uploadTemplate(uint16_t id, const TemplateDataCallback &onData);
+    // 诊断：等待手指采图（最长 waitMs），生成特征记录图像质量，然后上传原始图像并逐个数据包回调
+    // 采图失败时不上传图像，返回 false；回调返回 false 中止上传
+    bool uploadImage(uint32_t waitMs, FingerprintImageResult &result, const TemplateDataCallback &onData);
+    // 模板恢复：按协商的数据包长度分包下载模板并存入指纹库
+    bool downloadTemplate(uint16_t id, const uint8_t *data, size_t length);
 
     // 删除指定指纹
     bool deleteFingerprint(uint16_t id);
     // 清空指纹库
     bool clearAllLib();
 
-    // 读取有效模板数量
+    // 读取有效模板数量（来自索引表缓存）
     int readValidTempleteNum();
 
-    // 读取索引表
+    // 读取索引表（来自缓存，缓存失效时才访问模组）
     bool readIndexTable(uint8_t *indexTable);
+    // 从模组读取索引表到缓存，启动时调用一次
+    bool loadIndexTable();
 
-    // 休眠
+    // 休眠，模组进入低功耗，触摸输出保持工作
     bool sleepFingerprint();
+    // 休眠后恢复：读一次系统参数确认模组可以通信，不需要重新上电握手
+    bool resumeFromSleep();
 
     // 呼吸灯自动手动切换
     bool setLEDAutoManual(int autoMode);
@@ -77,12 +181,29 @@ public:
     static const uint8_t LED_RED_GREEN_ON = 0x06;
     static const uint8_t LED_RED_BLUE_ON = 0x05;
     static const uint8_t LED_GREEN_BLUE_ON = 0x03;
-private:
-    // 定义指令包格式
-    static const uint8_t HEADER_HIGH = 0xEF;
-    static const uint8_t HEADER_LOW = 0x01;
-    static const uint32_t DEVICE_ADDRESS = 0xFFFFFFFF;
 
+    // 通信参数
+    static const uint32_t LINK_BAUD_DEFAULT = 57600;    // 模组出厂波特率
+    static const uint32_t LINK_BAUD_FAST = 115200;      // 波特率寄存器为 N*9600，N 最大为12
+    static const uint16_t LINK_PACKET_SIZE_MAX = 256;   // 数据包长度寄存器 0~3 对应 32/64/128/256 字节
+    static const uint16_t LINK_PACKET_SIZE_DEFAULT = 128; // 模组出厂数据包长度
+
+    // 比对方式
+    static const uint8_t MATCH_MODE_SEARCH = 0x00;        // 采图、生成特征、搜索三次往返
+    static const uint8_t MATCH_MODE_AUTO_IDENTIFY = 0x01; // 自动验证，一条指令完成采图到搜索
+    static const int HOT_SET_SIZE = 2;                    // 热点模板数量
+
+    // 比对时的采图重试限制
+    static const uint32_t CAPTURE_WINDOW_MS = 3000;   // 从开始采图算起的最长重试时间
+    static const uint8_t CAPTURE_MAX_BACKOFF = 5;     // 图像质量差、通信错误最多重试次数
+    static const uint32_t IMAGE_POLL_MS = 50;         // 诊断采图等待手指时的轮询间隔
+    static const uint32_t TIMEOUT_MIN_SAMPLES = 8;    // 指令记录够这么多次后才按实测耗时设定超时
+    static const uint32_t TIMEOUT_MARGIN_MS = 50;     // 实测最大耗时的两倍再加上这个余量
+
+    // 设备休眠时模组的供电策略
+    static const uint8_t SENSOR_POWER_OFF = 0x00;   // 断电，唤醒时需要上电并等待启动信号
+    static const uint8_t SENSOR_POWER_SLEEP = 0x01; // 模组休眠，唤醒时跳过上电握手
+private:
     // 定义指令码
     static const uint8_t CMD_GET_IMAGE = 0x01;             // 获取图像
     static const uint8_t CMD_GEN_CHAR = 0x02;              // 生成特征
@@ -90,8 +211,13 @@ private:
     static const uint8_t CMD_SEARCH = 0x04;                // 搜索指纹
     static const uint8_t CMD_REG_MODEL = 0x05;             // 合并特征
     static const uint8_t CMD_STORE_CHAR = 0x06;            // 存储模板
+    static const uint8_t CMD_LOAD_CHAR = 0x07;             // 读出模板到缓冲区
+    static const uint8_t CMD_UP_CHAR = 0x08;               // 上传缓冲区中的模板
+    static const uint8_t CMD_DOWN_CHAR = 0x09;             // 下载模板到缓冲区
+    static const uint8_t CMD_UP_IMAGE = 0x0A;              // 上传图像缓冲区中的原始图像
     static const uint8_t CMD_DELETE_CHAR = 0x0C;            // 存储模板
     static const uint8_t CMD_CLEAR_LIB = 0x0D;              // 清空指纹库
+    static const uint8_t CMD_WRITE_REG = 0x0E;              // 写系统寄存器
     static const uint8_t CMD_READ_SYSPARA = 0x0F;           // 读模组基本参数
     static const uint8_t CMD_AUTO_IDENTIFY = 0x32;          // 自动验证指纹
     static const uint8_t CMD_VALID_TEMPLATE_NUM = 0x1D;     // 读取有效模版数
@@ -100,24 +226,83 @@ private:
     static const uint8_t CMD_LED_AUTO_MANUAL = 0x60;        // 呼吸灯自动手动切换
     static const uint8_t CMD_LED_CM = 0x3C;                 // 呼吸灯指令
 
+    // 系统寄存器
+    static const uint8_t REG_BAUD_RATE = 4;                 // 波特率控制寄存器
+    static const uint8_t REG_PACKET_SIZE = 6;               // 数据包长度寄存器
+
+    // 自动验证指令分阶段应答的参数
+    static const uint8_t AUTO_STAGE_CHECK = 0x00;           // 指令合法性检测
+    static const uint8_t AUTO_STAGE_IMAGE = 0x01;           // 采图结果
+    static const uint8_t AUTO_STAGE_SEARCH = 0x05;          // 搜索结果
+
+    // 参数固定的指令包，编译期生成（含校验和）
+    static constexpr auto FRAME_GET_IMAGE = FingerprintFrame::encode(CMD_GET_IMAGE);
+    static constexpr auto FRAME_GEN_CHAR_1 = FingerprintFrame::encode(CMD_GEN_CHAR, 1);
+    static constexpr auto FRAME_REG_MODEL = FingerprintFrame::encode(CMD_REG_MODEL);
+    static constexpr auto FRAME_CLEAR_LIB = FingerprintFrame::encode(CMD_CLEAR_LIB);
+    static constexpr auto FRAME_READ_SYSPARA = FingerprintFrame::encode(CMD_READ_SYSPARA);
+    static constexpr auto FRAME_AUTO_IDENTIFY = FingerprintFrame::encode(CMD_AUTO_IDENTIFY, 0, 0xFF, 0xFF, 0x00, 0x00); // 分数等级0，ID 0xFFFF（全库搜索），参数0
+    static constexpr auto FRAME_VALID_TEMPLATE_NUM = FingerprintFrame::encode(CMD_VALID_TEMPLATE_NUM);
+    static constexpr auto FRAME_READ_INDEX = FingerprintFrame::encode(CMD_READ_INDEX, 0); // 索引表第0页
+    static constexpr auto FRAME_SLEEP = FingerprintFrame::encode(CMD_SLEEP);
+
     // 成员变量
-    int _rx_pin;
-    int _tx_pin;
-    uint8_t _buffer_id;
-    SemaphoreHandle_t _mutex; // 互斥锁
+    FingerprintTransport &_transport; // 串口、电源和触摸线
+    uint8_t _lastCmd;              // 最近一次发送的指令码，用于选择应答超时
+    volatile uint8_t _matchMode;   // 比对方式
+    uint32_t _baudRate;            // 当前串口波特率
+    FingerprintSystemParameters _sysParams; // 最近一次读取的系统参数
+
+    // 索引表缓存：修改指纹库的指令成功后直接更新缓存；结果不确定时只增加代数，
+    // 下次读取发现缓存代数与指纹库代数不一致时再从模组重新读取
+    uint8_t _indexTable[INDEX_TABLE_LENGTH];
+    int _templateCount;
+    uint32_t _indexGeneration;     // 指纹库修改代数
+    uint32_t _cachedGeneration;    // 缓存内容对应的代数
+    SemaphoreHandle_t _cacheMutex; // 缓存锁，读取缓存不经过调度器
+
+    // 热点搜索
+    volatile bool _hotSearch;
+    int _lastMatchedId;            // 最近一次匹配的模板ID，-1表示没有
+    uint16_t _usageCount[MAX_FINGERPRINT_NUM]; // 各模板匹配次数
+    bool _usageDirty;              // 匹配次数有未保存的变化
+    FingerprintScheduler _scheduler; // 指令调度器，所有访问模组的操作都作为事务在这里执行
+    SemaphoreHandle_t _rxSignal;   // 串口数据到达信号
+    FingerprintFrameParser _parser; // 应答包解析器
+    FingerprintOutcomeCounts _outcomes; // 重试策略结果计数
+    FingerprintTrace _trace;       // 指令耗时追踪
 
     // 私有方法
-    void sendCmd12(uint8_t cmd);
-    void sendCmd13(uint8_t cmd, uint8_t param1);
-    void sendCmd15(uint8_t cmd, uint8_t param1, uint16_t param2);
-    void sendCmd16(uint8_t cmd, uint8_t param1, uint16_t param2);
-    void sendCmd16(uint8_t cmd, uint8_t param1, uint16_t param2, uint16_t param3, uint16_t param4);
-    void sendCmd17(uint8_t cmd, uint8_t param1, uint16_t param2, uint16_t param3);
-    void sendCmd17(uint8_t cmd, uint8_t param1, uint8_t param2, uint8_t param3, uint8_t param4, uint8_t param5);
+    // 发送指令包，整包一次写入串口
+    template <size_t N>
+    void sendFrame(const FingerprintCommand<N> &frame)
+    {
+        sendBytes(frame.bytes, N);
+    }
+    void sendBytes(const uint8_t *data, size_t len);
+    void sendDataPacket(const uint8_t *data, size_t len, bool last);
+    bool readSystemParameters();
+    bool writeSystemRegister(uint8_t reg, uint8_t value);
+    void setSerialBaudRate(uint32_t baudRate);
+    bool probeBaudRate();
+    void drainInput();
+    void onSerialReceive();
+    static uint32_t commandTimeoutLimit(uint8_t cmd);
+    bool receiveFrame(FingerprintResponse &frame, uint32_t timeoutMs);
     bool receiveResponse();
+    uint8_t receiveConfirm();
+    bool retryAfter(uint8_t code, uint8_t &backoffs);
     bool receiveResponse(int &data);
     bool receiveIndexTable(uint8_t* data);
-    void printResponse(uint8_t *response, uint8_t length);
+    bool copyIndexCache(uint8_t *indexTable, int *templateCount);
+    bool searchRange(uint16_t startPage, uint16_t pageCount, FingerprintMatchResult &result);
+    int selectHotSet(const uint8_t *indexTable, uint16_t *hotIds);
+    void recordMatch(uint16_t id);
+    bool refreshIndexCache();
+    void updateIndexCache(uint16_t id, bool present);
+    void clearIndexCache();
+    void invalidateIndexCache();
+    void printResponse(const uint8_t *response, size_t length);
 };
 
 
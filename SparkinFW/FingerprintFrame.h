@@ -0,0 +1,384 @@
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+#ifndef FINGERPRINT_FRAME_H
+#define FINGERPRINT_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// ZW101 包格式：
+// 包头(2) + 设备地址(4) + 包标识(1) + 包长度(2) + 内容(N) + 校验和(2)
+// 包长度 = 内容长度 + 校验和长度，校验和 = 包标识 + 包长度 + 内容 的逐字节累加
+
+// 定长指令包，长度在编译期确定，可以放在栈上或作为常量
+template <size_t N>
+struct FingerprintCommand
+{
+    uint8_t bytes[N];
+
+    static constexpr size_t size() { return N; }
+};
+
+// 应答包确认码
+enum FingerprintConfirmCode : uint8_t
+{
+    CONFIRM_OK = 0x00,               // 执行成功
+    CONFIRM_PACKET_ERROR = 0x01,     // 数据包接收错误
+    CONFIRM_NO_FINGER = 0x02,        // 传感器上没有手指
+    CONFIRM_IMAGE_FAIL = 0x03,       // 录入图像失败
+    CONFIRM_IMAGE_DRY = 0x04,        // 图像太干、太淡
+    CONFIRM_IMAGE_WET = 0x05,        // 图像太湿、太糊
+    CONFIRM_IMAGE_MESSY = 0x06,      // 图像太乱，生成不了特征
+    CONFIRM_FEATURE_FEW = 0x07,      // 特征点太少
+    CONFIRM_NOT_MATCH = 0x08,        // 指纹不匹配
+    CONFIRM_NOT_FOUND = 0x09,        // 没有搜索到指纹
+    CONFIRM_MERGE_FAIL = 0x0A,       // 特征合并失败
+    CONFIRM_BAD_ADDRESS = 0x0B,      // 地址序号超出指纹库范围
+    CONFIRM_NO_VALID_IMAGE = 0x15,   // 缓冲区内没有有效原始图
+    CONFIRM_FINGER_NOT_MOVED = 0x17, // 残留指纹或两次采图之间手指没有移动
+    CONFIRM_FLASH_ERROR = 0x18,      // 读写 FLASH 出错
+    CONFIRM_TIMEOUT = 0x26,          // 模组内部超时
+    CONFIRM_NO_RESPONSE = 0xFF,      // 没有收到应答（不是模组返回的确认码）
+};
+
+// 解析后的应答包，payload 指向接收缓冲区，不拷贝数据
+struct FingerprintResponse
+{
+    uint8_t pid;             // 包标识
+    const uint8_t *payload;  // 包内容（应答包第一个字节是确认码）
+    uint16_t payloadLength;  // 包内容长度，不含校验和
+
+    uint8_t confirm() const { return payloadLength > 0 ? payload[0] : CONFIRM_NO_RESPONSE; }
+
+    // 读取内容中的大端16位数据
+    uint16_t word(uint16_t offset) const
+    {
+        if (offset + 1 >= payloadLength)
+            return 0;
+        return (uint16_t)(payload[offset] << 8) | payload[offset + 1];
+    }
+};
+
+class FingerprintFrame
+{
+public:
+    static constexpr uint8_t HEADER_HIGH = 0xEF;
+    static constexpr uint8_t HEADER_LOW = 0x01;
+    static constexpr uint32_t DEVICE_ADDRESS = 0xFFFFFFFF;
+
+    // 包标识
+    static constexpr uint8_t PID_COMMAND = 0x01;  // 命令包
+    static constexpr uint8_t PID_DATA = 0x02;     // 数据包（后续还有数据包）
+    static constexpr uint8_t PID_ACK = 0x07;      // 应答包
+    static constexpr uint8_t PID_DATA_END = 0x08; // 最后一个数据包
+
+    static constexpr size_t HEAD_LENGTH = 9;     // 包头 + 设备地址 + 包标识 + 包长度
+    static constexpr size_t CHECKSUM_LENGTH = 2;
+    static constexpr size_t MIN_FRAME_LENGTH = HEAD_LENGTH + CHECKSUM_LENGTH;
+    static constexpr size_t MAX_PAYLOAD_LENGTH = 256; // 模组最大数据包长度
+    static constexpr size_t MAX_FRAME_LENGTH = MIN_FRAME_LENGTH + MAX_PAYLOAD_LENGTH;
+
+    // 解析结果
+    enum DecodeStatus
+    {
+        DECODE_OK = 0,
+        DECODE_INCOMPLETE,   // 数据不足一个完整包
+        DECODE_BAD_HEADER,   // 包头或设备地址不匹配
+        DECODE_BAD_LENGTH,   // 包长度字段非法
+        DECODE_BAD_CHECKSUM, // 校验和错误
+    };
+
+    static constexpr uint8_t hi(uint16_t value) { return (uint8_t)(value >> 8); }
+    static constexpr uint8_t lo(uint16_t value) { return (uint8_t)(value & 0xFF); }
+
+    // 生成指令包：cmd 为指令码，params 为逐字节参数（16位参数用 hi()/lo() 拆分）
+    // 参数全部为常量时整个包（包括校验和）在编译期生成
+    template <typename... Params>
+    static constexpr FingerprintCommand<MIN_FRAME_LENGTH + 1 + sizeof...(Params)> encode(uint8_t cmd, Params... params)
+    {
+        constexpr size_t contentLength = 1 + sizeof...(Params);
+        constexpr uint16_t length = contentLength + CHECKSUM_LENGTH;
+        FingerprintCommand<MIN_FRAME_LENGTH + contentLength> frame{};
+        const uint8_t content[contentLength] = {cmd, static_cast<uint8_t>(params)...};
+
+        frame.bytes[0] = HEADER_HIGH;
+        frame.bytes[1] = HEADER_LOW;
+        frame.bytes[2] = (DEVICE_ADDRESS >> 24) & 0xFF;
+        frame.bytes[3] = (DEVICE_ADDRESS >> 16) & 0xFF;
+        frame.bytes[4] = (DEVICE_ADDRESS >> 8) & 0xFF;
+        frame.bytes[5] = DEVICE_ADDRESS & 0xFF;
+        frame.bytes[6] = PID_COMMAND;
+        frame.bytes[7] = hi(length);
+        frame.bytes[8] = lo(length);
+        for (size_t i = 0; i < contentLength; i++)
+        {
+            frame.bytes[HEAD_LENGTH + i] = content[i];
+        }
+        uint16_t sum = checksum(&frame.bytes[6], 3 + contentLength);
+        frame.bytes[HEAD_LENGTH + contentLength] = hi(sum);
+        frame.bytes[HEAD_LENGTH + contentLength + 1] = lo(sum);
+        return frame;
+    }
+
+    // 生成数据包写入 out（容量至少 MIN_FRAME_LENGTH + len），last 为 true 时是最后一个数据包，返回整包长度
+    static size_t encodeData(bool last, const uint8_t *data, size_t len, uint8_t *out)
+    {
+        uint16_t length = len + CHECKSUM_LENGTH;
+        out[0] = HEADER_HIGH;
+        out[1] = HEADER_LOW;
+        out[2] = (DEVICE_ADDRESS >> 24) & 0xFF;
+        out[3] = (DEVICE_ADDRESS >> 16) & 0xFF;
+        out[4] = (DEVICE_ADDRESS >> 8) & 0xFF;
+        out[5] = DEVICE_ADDRESS & 0xFF;
+        out[6] = last ? PID_DATA_END : PID_DATA;
+        out[7] = hi(length);
+        out[8] = lo(length);
+        memcpy(&out[HEAD_LENGTH], data, len);
+        uint16_t sum = checksum(&out[6], 3 + len);
+        out[HEAD_LENGTH + len] = hi(sum);
+        out[HEAD_LENGTH + len + 1] = lo(sum);
+        return HEAD_LENGTH + len + CHECKSUM_LENGTH;
+    }
+
+    static constexpr uint16_t checksum(const uint8_t *data, size_t len)
+    {
+        uint16_t sum = 0;
+        for (size_t i = 0; i < len; i++)
+        {
+            sum += data[i];
+        }
+        return sum;
+    }
+
+    // 根据包头计算整包长度，数据不足包头长度时返回0
+    static size_t frameLength(const uint8_t *buf, size_t len)
+    {
+        if (len < HEAD_LENGTH)
+            return 0;
+        return HEAD_LENGTH + (((uint16_t)buf[7] << 8) | buf[8]);
+    }
+
+    // 解析 buf 起始处的一个完整包
+    static DecodeStatus decode(const uint8_t *buf, size_t len, FingerprintResponse &out)
+    {
+        if (len < HEAD_LENGTH)
+            return DECODE_INCOMPLETE;
+        if (buf[0] != HEADER_HIGH || buf[1] != HEADER_LOW ||
+            buf[2] != ((DEVICE_ADDRESS >> 24) & 0xFF) || buf[3] != ((DEVICE_ADDRESS >> 16) & 0xFF) ||
+            buf[4] != ((DEVICE_ADDRESS >> 8) & 0xFF) || buf[5] != (DEVICE_ADDRESS & 0xFF))
+            return DECODE_BAD_HEADER;
+
+        uint16_t length = ((uint16_t)buf[7] << 8) | buf[8];
+        if (length < CHECKSUM_LENGTH)
+            return DECODE_BAD_LENGTH;
+        size_t total = HEAD_LENGTH + length;
+        if (len < total)
+            return DECODE_INCOMPLETE;
+
+        uint16_t expected = ((uint16_t)buf[total - 2] << 8) | buf[total - 1];
+        if (checksum(&buf[6], total - 6 - CHECKSUM_LENGTH) != expected)
+            return DECODE_BAD_CHECKSUM;
+
+        out.pid = buf[6];
+        out.payload = &buf[HEAD_LENGTH];
+        out.payloadLength = length - CHECKSUM_LENGTH;
+        return DECODE_OK;
+    }
+};
+
+// 增量式应答包解析器：逐字节喂入串口数据，收到最后一个字节即完成一帧
+// 包头/地址/包标识/长度不合法或校验失败时只丢弃包头第一个字节，其余已缓存的字节重新扫描，
+// 这样夹在垃圾数据中的真实包头不会随坏包一起丢掉
+class FingerprintFrameParser
+{
+public:
+    enum Status
+    {
+        NEED_MORE = 0,  // 还没有完整的包
+        FRAME_READY,    // 已收到完整且校验正确的包，可调用 frame() 读取
+    };
+
+    FingerprintFrameParser() { reset(); }
+
+    void reset()
+    {
+        _pos = 0;
+        _total = 0;
+        _pendingHead = 0;
+        _pendingLength = 0;
+    }
+
+    Status feed(uint8_t b)
+    {
+        if (_pendingLength == 0)
+        {
+            Status status = step(b);
+            if (status == FRAME_READY || _pendingLength == 0)
+                return status;
+        }
+        else
+        {
+            // 重新扫描剩下的字节还没处理完，新字节排在它们后面
+            appendPending(b);
+        }
+        return drainPending();
+    }
+
+    // 上一个包之后是否还有待重新扫描的字节，有则应先调用 poll() 而不是等待新数据
+    bool hasPending() const { return _pendingLength > 0; }
+
+    // 继续处理待重新扫描的字节
+    Status poll() { return drainPending(); }
+
+    // 最近一次 FRAME_READY 的包，指向内部缓冲区
+    const FingerprintResponse &frame() const { return _frame; }
+
+    // 统计信息
+    uint32_t resyncBytes() const { return _resyncBytes; }
+    uint32_t checksumErrors() const { return _checksumErrors; }
+
+private:
+    // 处理一个字节
+    Status step(uint8_t b)
+    {
+        if (!accept(b))
+        {
+            if (_pos == 0)
+            {
+                _resyncBytes++;
+                return NEED_MORE;
+            }
+            // 前面缓存的字节可能包含下一个包头，连同当前字节一起重新扫描
+            _buf[_pos++] = b;
+            rescan();
+            return NEED_MORE;
+        }
+
+        _buf[_pos++] = b;
+        if (_pos == FingerprintFrame::HEAD_LENGTH)
+        {
+            _total = FingerprintFrame::frameLength(_buf, _pos);
+        }
+        if (_total == 0 || _pos < _total)
+        {
+            return NEED_MORE;
+        }
+
+        // 整包已收齐，校验
+        if (FingerprintFrame::decode(_buf, _pos, _frame) != FingerprintFrame::DECODE_OK)
+        {
+            _checksumErrors++;
+            rescan();
+            return NEED_MORE;
+        }
+        _pos = 0; // frame() 指向的数据在下一次 feed 之前有效
+        _total = 0;
+        return FRAME_READY;
+    }
+
+    // 丢弃当前包头的第一个字节，其余缓存字节放回待处理字节的最前面
+    void rescan()
+    {
+        _resyncBytes++;
+        prependPending(&_buf[1], _pos - 1);
+        _pos = 0;
+        _total = 0;
+    }
+
+    // 处理待重新扫描的字节，收到完整包时立即返回，剩下的字节留到下一次 feed
+    Status drainPending()
+    {
+        while (_pendingLength > 0)
+        {
+            uint8_t b = _pending[_pendingHead++];
+            _pendingLength--;
+            if (step(b) == FRAME_READY)
+                return FRAME_READY;
+        }
+        _pendingHead = 0;
+        return NEED_MORE;
+    }
+
+    void prependPending(const uint8_t *data, size_t len)
+    {
+        if (len > _pendingHead)
+        {
+            // 前面的空间不够，把已有字节挪到后面
+            if (len + _pendingLength > PENDING_CAPACITY)
+            {
+                _resyncBytes += len + _pendingLength - PENDING_CAPACITY;
+                _pendingLength = PENDING_CAPACITY - len;
+            }
+            memmove(&_pending[len], &_pending[_pendingHead], _pendingLength);
+            _pendingHead = len;
+        }
+        _pendingHead -= len;
+        memcpy(&_pending[_pendingHead], data, len);
+        _pendingLength += len;
+    }
+
+    void appendPending(uint8_t b)
+    {
+        if (_pendingHead + _pendingLength == PENDING_CAPACITY)
+        {
+            if (_pendingLength == PENDING_CAPACITY)
+            {
+                // 不会发生：待处理字节不超过一个最大包加上之后到达的少量字节
+                _resyncBytes++;
+                return;
+            }
+            memmove(_pending, &_pending[_pendingHead], _pendingLength);
+            _pendingHead = 0;
+        }
+        _pending[_pendingHead + _pendingLength++] = b;
+    }
+
+    // 检查第 _pos 个字节是否符合包格式
+    bool accept(uint8_t b) const
+    {
+        switch (_pos)
+        {
+        case 0:
+            return b == FingerprintFrame::HEADER_HIGH;
+        case 1:
+            return b == FingerprintFrame::HEADER_LOW;
+        case 2:
+            return b == ((FingerprintFrame::DEVICE_ADDRESS >> 24) & 0xFF);
+        case 3:
+            return b == ((FingerprintFrame::DEVICE_ADDRESS >> 16) & 0xFF);
+        case 4:
+            return b == ((FingerprintFrame::DEVICE_ADDRESS >> 8) & 0xFF);
+        case 5:
+            return b == (FingerprintFrame::DEVICE_ADDRESS & 0xFF);
+        case 6:
+            return b == FingerprintFrame::PID_COMMAND || b == FingerprintFrame::PID_DATA ||
+                   b == FingerprintFrame::PID_ACK || b == FingerprintFrame::PID_DATA_END;
+        case 8:
+        {
+            uint16_t length = ((uint16_t)_buf[7] << 8) | b;
+            return length >= FingerprintFrame::CHECKSUM_LENGTH &&
+                   length <= FingerprintFrame::MAX_PAYLOAD_LENGTH + FingerprintFrame::CHECKSUM_LENGTH;
+        }
+        default:
+            return true;
+        }
+    }
+
+    static constexpr size_t PENDING_CAPACITY = FingerprintFrame::MAX_FRAME_LENGTH * 2;
+
+    uint8_t _buf[FingerprintFrame::MAX_FRAME_LENGTH];
+    size_t _pos;
+    size_t _total;
+    uint8_t _pending[PENDING_CAPACITY]; // 等待重新扫描的字节
+    size_t _pendingHead;
+    size_t _pendingLength;
+    FingerprintResponse _frame = {};
+    uint32_t _resyncBytes = 0;
+    uint32_t _checksumErrors = 0;
+};
+
+#endif // FINGERPRINT_FRAME_H
@@ -5,12 +5,17 @@
  */
 #include "FingerprintManager.h"
 #include "Common.h"
+#include "LedManager.h"
+#include "ConfigManager.h"
+#include "Log.h"
 
 extern Fingerprint fingerprint;
+extern LedManager ledManager;
 extern BatteryManager batteryManager;
+extern ConfigManager configManager;
 
 FingerprintManager::FingerprintManager() 
-    : _taskHandle(nullptr), _sleepManager(nullptr), _unlockManager(nullptr) {
+    : _taskHandle(nullptr), _rearmTime(0), _usageUnsaved(false), _sleepManager(nullptr), _unlockManager(nullptr) {
 }
 
 void FingerprintManager::begin(SleepManager* sleep, UnlockManager* unlock) {
@@ -30,39 +35,120 @@ void FingerprintManager::begin(SleepManager* sleep, UnlockManager* unlock) {
 void FingerprintManager::taskFunction(void* param) {
     FingerprintManager* manager = static_cast<FingerprintManager*>(param);
     
+    TouchEvent event;
+
     while (true) {
-        if (touchTriggered) {
-            // 重置睡眠时间
-            if (manager->_sleepManager) {
-                manager->_sleepManager->preventSleep(false); // 确保没有被意外阻止
-                manager->_sleepManager->resetActivity();
-            }
-            
-            Serial.println("[FP] IRQ detected! Auto searching fingerprint...");
+        // 阻塞等待触摸中断投递的事件，空闲时不占用CPU；有未保存的匹配次数时空闲一段时间后保存
+        TickType_t wait = manager->_usageUnsaved ? USAGE_SAVE_IDLE_MS / portTICK_PERIOD_MS : portMAX_DELAY;
+        if (xQueueReceive(touch_queue, &event, wait) != pdTRUE) {
+            manager->saveUsage();
+            continue;
+        }
+
+        // 重置睡眠时间
+        if (manager->_sleepManager) {
+            manager->_sleepManager->preventSleep(false); // 确保没有被意外阻止
+            manager->_sleepManager->resetActivity();
+        }
+        if (manager->_unlockManager) {
+            manager->_unlockManager->beginMatch();
+        }
+
+        LOGI("[FP] IRQ detected %u ms ago (%u ms after re-arm)! Auto searching fingerprint...",
+             (uint32_t)(touchClockMs() - event.timestamp), (uint32_t)(event.timestamp - manager->_rearmTime));
+
+        // 开始验证指纹，比对方式由配置决定
+        FingerprintMatchResult result;
+        bool matched = fingerprint.matchFingerprint(result);
+        ledManager.resetState(); // 采图时模组会自动控制灯
+        LOGI("[FP] Match took %u ms (%s): capture %u ms, extract %u ms, search %u ms, attempts %u",
+             result.totalMs, result.matchMode == Fingerprint::MATCH_MODE_AUTO_IDENTIFY ? "AutoIdentify" : "Search",
+             result.captureMs, result.extractMs, result.searchMs, result.attempts);
+        if (matched) {
+            LOGI("[FP] Match succeed!");
             
-            // 开始搜索验证指纹
-            if (fingerprint.searchFingerprint()) {
-                Serial.println("[FP] Match succeed!");
-                
-                // 请求解锁
-                if (manager->_unlockManager) {
-                    manager->_unlockManager->requestUnlock();
-                }
-            } else {
-                Serial.println("[FP] Match fail!");
+            // 请求解锁，比对结果随解锁请求发送给电脑
+            if (manager->_unlockManager && !manager->_unlockManager->requestUnlock(result)) {
+                manager->_unlockManager->endMatch();
             }
-            
-            // 防止重复触发
-            vTaskDelay(1000 / portTICK_PERIOD_MS);
-            
-            // 检查电池电量
-            batteryManager.CheckBatteryLow();
 
-            // 重置中断标志
-            touchTriggered = false;
+            // 匹配次数不在每次解锁后写 NVS，空闲或休眠前批量保存
+            manager->_usageUnsaved = true;
+        } else {
+            LOGW("[FP] Match fail!");
+            FingerprintOutcomeCounts outcomes;
+            fingerprint.getOutcomeCounts(outcomes);
+            LOGW("[FP] Outcomes: ok %u, no finger %u, poor image %u, comm error %u, no match %u, fatal %u",
+                 outcomes.ok, outcomes.noFinger, outcomes.poorImage, outcomes.commError, outcomes.noMatch, outcomes.fatal);
+            if (manager->_unlockManager) {
+                manager->_unlockManager->endMatch();
+            }
         }
-        
-        // 这里的延时可以适当调整，用于轮询touchTriggered
-        vTaskDelay(50 / portTICK_PERIOD_MS);
+
+        // 等手指抬起后再接受下一次触摸，电量由主循环定时测量，不占用这段时间
+        manager->rearm(touchClockMs());
+
+        // 低电量提示仍然跟在每次触摸之后，使用最近一次测量的电量
+        batteryManager.warnIfLow();
+    }
+}
+
+void FingerprintManager::saveUsage() {
+    _usageUnsaved = false;
+    uint16_t usageCounts[MAX_FINGERPRINT_NUM];
+    if (fingerprint.takeUsageChanges(usageCounts)) {
+        configManager.saveFingerprintUsage(usageCounts);
+        LOGD("[FP] Usage counts saved");
+    }
+}
+
+// 等待触摸线持续为低 LIFT_DEBOUNCE_MS，返回 true 表示手指已抬起，liftTime 为触摸线最后一次变低的时间
+// 这里的时间都用 touchClockMs()，与触摸事件的时间戳直接比较
+bool FingerprintManager::waitForLift(uint32_t& liftTime) {
+    uint32_t startTime = touchClockMs();
+    liftTime = startTime;
+    bool wasTouching = true;
+    while (touchClockMs() - startTime < LIFT_TIMEOUT_MS) {
+        bool touching = fingerprint.isFingerTouching();
+        if (touching) {
+            wasTouching = true;
+        } else {
+            if (wasTouching) {
+                liftTime = touchClockMs(); // 抖动时重新计时
+                wasTouching = false;
+            }
+            if (touchClockMs() - liftTime >= LIFT_DEBOUNCE_MS) {
+                return true;
+            }
+        }
+        vTaskDelay(LIFT_POLL_MS / portTICK_PERIOD_MS);
+    }
+    return false;
+}
+
+// 比对结束后重新接受触摸：先等手指抬起，再保证距上次比对结束不少于最小间隔
+void FingerprintManager::rearm(uint32_t matchEnd) {
+    uint32_t liftTime;
+    bool lifted = waitForLift(liftTime);
+
+    // 最小间隔防止抖动或误触连续触发
+    uint32_t minInterval = configManager.getRearmInterval();
+    uint32_t elapsed = touchClockMs() - matchEnd;
+    if (elapsed < minInterval) {
+        vTaskDelay((minInterval - elapsed) / portTICK_PERIOD_MS);
+    }
+
+    // 抬起之前的触摸事件（按压期间和抬起时的抖动）丢弃；抬起之后的是新的触摸，保留
+    TouchEvent pending;
+    if (xQueuePeek(touch_queue, &pending, 0) == pdTRUE && (!lifted || (int32_t)(pending.timestamp - liftTime) < 0)) {
+        xQueueReceive(touch_queue, &pending, 0);
+    }
+
+    _rearmTime = touchClockMs();
+    if (lifted) {
+        LOGI("[FP] Re-armed %u ms after match (finger lifted after %u ms)",
+             _rearmTime - matchEnd, liftTime - matchEnd);
+    } else {
+        LOGI("[FP] Finger not lifted, re-armed after %u ms", _rearmTime - matchEnd);
     }
 }
@@ -16,11 +16,23 @@ class FingerprintManager {
 public:
     FingerprintManager();
     void begin(SleepManager* sleep, UnlockManager* unlock);
+
+    // 匹配次数有变化时写入 NVS，休眠前调用
+    void saveUsage();
     
+    static const uint32_t LIFT_POLL_MS = 10;        // 等待抬起时检查触摸线的间隔
+    static const uint32_t LIFT_DEBOUNCE_MS = 50;    // 触摸线持续为低这么久才算抬起
+    static const uint32_t LIFT_TIMEOUT_MS = 10000;  // 手指一直不抬起时不再等待
+    static const uint32_t USAGE_SAVE_IDLE_MS = 5000; // 解锁后没有新的触摸这么久才保存匹配次数
+
 private:
     static void taskFunction(void* param);
-    
+    bool waitForLift(uint32_t& liftTime);
+    void rearm(uint32_t matchEnd);
+
     TaskHandle_t _taskHandle;
+    uint32_t _rearmTime;           // 上一次重新接受触摸的时间
+    volatile bool _usageUnsaved;   // 有成功匹配之后还没有保存匹配次数
     SleepManager* _sleepManager;
     UnlockManager* _unlockManager;
 };
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+#include "FingerprintScheduler.h"
+#include "Log.h"
+
+bool FingerprintFuture::wait(TickType_t ticks)
+{
+    if (!_state)
+        return false;
+    if (_state->finished)
+        return true;
+    return xSemaphoreTake(_state->done, ticks) == pdTRUE;
+}
+
+FingerprintScheduler::FingerprintScheduler()
+    : _taskHandle(nullptr)
+{
+    for (int i = 0; i < PRIORITY_COUNT; i++)
+        _queues[i] = nullptr;
+}
+
+void FingerprintScheduler::begin()
+{
+    if (_taskHandle)
+        return;
+    for (int i = 0; i < PRIORITY_COUNT; i++)
+        _queues[i] = xQueueCreate(QUEUE_LENGTH, sizeof(Job *));
+
+    // 与指纹任务同优先级，提交的事务不会被蓝牙之外的任务长时间推迟
+    if (xTaskCreate(taskFunction, "FpSchedTask", 6144, this, 1, &_taskHandle) != pdPASS)
+    {
+        _taskHandle = nullptr;
+        LOGW("[FP] Scheduler task not started, commands run in the caller");
+    }
+}
+
+// 调度任务未启动，或者已经在调度任务中（嵌套事务、间隙中执行的事务）
+bool FingerprintScheduler::runsInline() const
+{
+    return _taskHandle == nullptr || xTaskGetCurrentTaskHandle() == _taskHandle;
+}
+
+bool FingerprintScheduler::enqueue(Job *job, TickType_t ticks)
+{
+    if (xQueueSend(_queues[job->priority], &job, ticks) != pdTRUE)
+    {
+        LOGW("[FP] Scheduler queue %u full, transaction dropped", (uint32_t)job->priority);
+        delete job;
+        return false;
+    }
+    xTaskNotifyGive(_taskHandle);
+    return true;
+}
+
+bool FingerprintScheduler::submit(Priority priority, const Transaction &work, const Completion &done, bool brief)
+{
+    if (_taskHandle == nullptr)
+    {
+        // 没有调度任务时直接执行
+        bool result = perform(work);
+        if (done)
+            done(result);
+        return true;
+    }
+    // 在调度任务中提交（如完成回调里提交下一个事务）同样排队，不会嵌套执行
+    return enqueue(new Job{priority, brief, work, done}, 0);
+}
+
+FingerprintFuture FingerprintScheduler::submit(Priority priority, const Transaction &work, bool brief)
+{
+    FingerprintFuture future;
+    std::shared_ptr<FingerprintFuture::State> state = std::make_shared<FingerprintFuture::State>();
+    bool queued = submit(priority, work, [state](bool result) {
+        state->result = result;
+        state->finished = true;
+        xSemaphoreGive(state->done);
+    }, brief);
+    if (queued)
+        future._state = state;
+    return future;
+}
+
+bool FingerprintScheduler::run(Priority priority, const Transaction &work, bool brief)
+{
+    if (runsInline())
+        return perform(work);
+
+    // 完成信号放在调用方栈上，事务完成之前调用方一直在这里等待
+    StaticSemaphore_t doneBuffer;
+    SemaphoreHandle_t done = xSemaphoreCreateBinaryStatic(&doneBuffer);
+    bool result = false;
+    if (!enqueue(new Job{priority, brief, work, [&result, done](bool r) {
+                             result = r;
+                             xSemaphoreGive(done);
+                         }},
+                 portMAX_DELAY))
+    {
+        vSemaphoreDelete(done);
+        return false;
+    }
+    xSemaphoreTake(done, portMAX_DELAY);
+    vSemaphoreDelete(done);
+    return result;
+}
+
+void FingerprintScheduler::idle(uint32_t ms)
+{
+    if (_taskHandle != nullptr && xTaskGetCurrentTaskHandle() == _taskHandle)
+    {
+        // 间隙中只插入短事务，长事务会推迟当前流程的下一步
+        uint32_t startTime = millis();
+        while (millis() - startTime + GAP_MIN_MS <= ms)
+        {
+            Job *job = takeJob(true);
+            if (!job)
+                break;
+            execute(job);
+        }
+        uint32_t elapsed = millis() - startTime;
+        if (elapsed >= ms)
+            return;
+        ms -= elapsed;
+    }
+    vTaskDelay(ms / portTICK_PERIOD_MS);
+}
+
+// 按优先级取出一个事务；briefOnly 时只看各队列队首的短事务，保持同一优先级内的顺序
+FingerprintScheduler::Job *FingerprintScheduler::takeJob(bool briefOnly)
+{
+    for (int i = 0; i < PRIORITY_COUNT; i++)
+    {
+        Job *job = nullptr;
+        if (xQueuePeek(_queues[i], &job, 0) != pdTRUE)
+            continue;
+        if (briefOnly && !job->brief)
+            continue;
+        xQueueReceive(_queues[i], &job, 0);
+        return job;
+    }
+    return nullptr;
+}
+
+// 执行事务本身，结束后调用事务结束钩子
+bool FingerprintScheduler::perform(const Transaction &work)
+{
+    bool result = work();
+    if (_transactionEnd)
+        _transactionEnd();
+    return result;
+}
+
+void FingerprintScheduler::execute(Job *job)
+{
+    bool result = perform(job->work);
+    if (job->done)
+        job->done(result);
+    delete job;
+}
+
+void FingerprintScheduler::taskFunction(void *param)
+{
+    FingerprintScheduler *scheduler = static_cast<FingerprintScheduler *>(param);
+
+    while (true)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // 每执行完一个事务都重新从最高优先级开始取
+        Job *job;
+        while ((job = scheduler->takeJob(false)) != nullptr)
+        {
+            scheduler->execute(job);
+        }
+    }
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+#ifndef FINGERPRINT_SCHEDULER_H
+#define FINGERPRINT_SCHEDULER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <functional>
+#include <memory>
+
+// 异步提交的事务结果
+class FingerprintFuture
+{
+public:
+    FingerprintFuture() {}
+
+    bool valid() const { return (bool)_state; }
+    // 等待事务完成，超时返回false
+    bool wait(TickType_t ticks = portMAX_DELAY);
+    bool ready() const { return _state && _state->finished; }
+    // 事务的返回值，未完成时为false
+    bool result() const { return _state && _state->result; }
+
+private:
+    friend class FingerprintScheduler;
+
+    struct State
+    {
+        SemaphoreHandle_t done;
+        volatile bool finished;
+        volatile bool result;
+
+        State() : done(xSemaphoreCreateBinary()), finished(false), result(false) {}
+        ~State() { vSemaphoreDelete(done); }
+    };
+    std::shared_ptr<State> _state;
+};
+
+// 指纹模组指令调度器：由调度任务独占串口，按优先级依次执行各调用方提交的事务
+// 事务是一段完整的指令往返（可以包含多条指令），执行期间不会被打断；
+// 事务在等待间隙（如采图失败后的退避）调用 idle()，排队的短事务可以插在间隙中执行
+class FingerprintScheduler
+{
+public:
+    enum Priority : uint8_t
+    {
+        PRIORITY_UNLOCK = 0, // 解锁路径：采图比对，以及唤醒时的上电握手
+        PRIORITY_ENROLL,     // 注册
+        PRIORITY_MANAGE,     // 读取参数、指纹库管理、模板备份恢复
+        PRIORITY_LED,        // 呼吸灯效果
+        PRIORITY_COUNT,
+    };
+
+    typedef std::function<bool()> Transaction;
+    typedef std::function<void(bool result)> Completion;
+
+    static const int QUEUE_LENGTH = 8;      // 每个优先级的排队事务数
+    static const uint32_t GAP_MIN_MS = 20;  // 剩余间隙小于这个时间时不再插入事务
+
+    FingerprintScheduler();
+    // 创建调度任务；调度任务创建之前（以及主机测试中）事务在调用方直接执行
+    void begin();
+
+    // 异步提交，完成后在调度任务中回调（回调中不能调用同步接口等待其他事务）；队列已满返回false
+    // brief 表示事务可以插入其他事务的等待间隙，只用于呼吸灯指令和只读写内存的短事务；
+    // 修改指纹库、刷新索引缓存或打印大量日志的事务不能标记为 brief，否则会在比对过程中改变缓存和热点集合
+    bool submit(Priority priority, const Transaction &work, const Completion &done, bool brief = false);
+    // 异步提交，返回 future；队列已满时返回无效的 future
+    FingerprintFuture submit(Priority priority, const Transaction &work, bool brief = false);
+    // 提交并等待结果；在调度任务中调用时（事务嵌套）直接执行
+    bool run(Priority priority, const Transaction &work, bool brief = false);
+
+    // 在事务中调用：模组空闲 ms 毫秒，期间按优先级执行排队的短事务，剩余时间再等待
+    void idle(uint32_t ms);
+
+    // 每个事务执行完、回调之前在执行事务的任务中调用（用于结束指令耗时记录），在 begin() 之前设置
+    void setTransactionEndHook(const std::function<void()> &hook) { _transactionEnd = hook; }
+
+private:
+    struct Job
+    {
+        Priority priority;
+        bool brief;
+        Transaction work;
+        Completion done;
+    };
+
+    static void taskFunction(void *param);
+    bool runsInline() const;
+    bool enqueue(Job *job, TickType_t ticks);
+    Job *takeJob(bool briefOnly);
+    void execute(Job *job);
+    bool perform(const Transaction &work);
+
+    TaskHandle_t _taskHandle;
+    std::function<void()> _transactionEnd;
+    QueueHandle_t _queues[PRIORITY_COUNT]; // 每个优先级一个 Job* 队列
+};
+
+#endif // FINGERPRINT_SCHEDULER_H
@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+#include "FingerprintTrace.h"
+#include "FingerprintFrame.h"
+
+static const uint32_t NO_FIRST_BYTE = 0xFFFFFFFF;
+
+FingerprintTrace::FingerprintTrace()
+{
+    _current = {};
+    _active = false;
+    _sendUs = 0;
+    _retry = 0;
+    _ringHead = 0;
+    _ringCount = 0;
+    _histogramCount = 0;
+    _mutex = xSemaphoreCreateMutex();
+}
+
+void FingerprintTrace::begin(uint8_t cmd)
+{
+    commit();
+    _sendUs = micros();
+    _current = {};
+    _current.sendMs = millis();
+    _current.firstByteUs = NO_FIRST_BYTE;
+    _current.cmd = cmd;
+    _current.confirm = CONFIRM_NO_RESPONSE;
+    _current.retry = _retry;
+    _active = true;
+}
+
+void FingerprintTrace::firstByte()
+{
+    if (_active && _current.firstByteUs == NO_FIRST_BYTE)
+    {
+        _current.firstByteUs = micros() - _sendUs;
+    }
+}
+
+void FingerprintTrace::frame(uint8_t confirm)
+{
+    if (!_active)
+    {
+        return;
+    }
+    if (confirm == CONFIRM_NO_RESPONSE)
+    {
+        // 超时：已经收到过应答包时保留最后一个包的结果
+        if (_current.frames == 0)
+        {
+            _current.completeUs = micros() - _sendUs;
+        }
+        return;
+    }
+    // 多个应答包的指令（自动验证、上传模板）以最后一个包为准
+    _current.completeUs = micros() - _sendUs;
+    _current.confirm = confirm;
+    if (_current.frames < UINT8_MAX)
+    {
+        _current.frames++;
+    }
+}
+
+// 结束当前指令，写入环形缓冲区和直方图
+void FingerprintTrace::commit()
+{
+    if (!_active)
+    {
+        return;
+    }
+    _active = false;
+    if (_current.completeUs == 0)
+    {
+        _current.completeUs = micros() - _sendUs; // 没有等待应答的指令
+    }
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    _ring[_ringHead] = _current;
+    _ringHead = (_ringHead + 1) % RING_SIZE;
+    if (_ringCount < RING_SIZE)
+    {
+        _ringCount++;
+    }
+
+    FingerprintTraceHistogram *histogram = histogramFor(_current.cmd);
+    if (histogram)
+    {
+        uint32_t ms = _current.completeUs / 1000;
+        histogram->count++;
+        if (_current.frames == 0)
+        {
+            histogram->timeouts++;
+        }
+        else if (_current.confirm != CONFIRM_OK)
+        {
+            histogram->errors++;
+        }
+        histogram->totalMs += ms;
+        histogram->maxMs = max(histogram->maxMs, ms);
+        if (histogram->buckets[bucketOf(ms)] < UINT16_MAX)
+        {
+            histogram->buckets[bucketOf(ms)]++;
+        }
+    }
+    xSemaphoreGive(_mutex);
+}
+
+// 查找指令对应的直方图，没有时分配一个，调用者需持有统计锁
+FingerprintTraceHistogram *FingerprintTrace::histogramFor(uint8_t cmd)
+{
+    for (int i = 0; i < _histogramCount; i++)
+    {
+        if (_histograms[i].cmd == cmd)
+            return &_histograms[i];
+    }
+    if (_histogramCount >= MAX_COMMANDS)
+    {
+        return nullptr;
+    }
+    FingerprintTraceHistogram *histogram = &_histograms[_histogramCount++];
+    *histogram = {};
+    histogram->cmd = cmd;
+    return histogram;
+}
+
+int FingerprintTrace::bucketOf(uint32_t ms)
+{
+    int bucket = 0;
+    while (ms > 0 && bucket < FingerprintTraceHistogram::BUCKETS - 1)
+    {
+        ms >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+bool FingerprintTrace::histogram(int index, FingerprintTraceHistogram &out)
+{
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    bool found = index >= 0 && index < _histogramCount;
+    if (found)
+    {
+        out = _histograms[index];
+    }
+    xSemaphoreGive(_mutex);
+    return found;
+}
+
+bool FingerprintTrace::histogramOf(uint8_t cmd, FingerprintTraceHistogram &out)
+{
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    bool found = false;
+    for (int i = 0; i < _histogramCount && !found; i++)
+    {
+        if (_histograms[i].cmd == cmd)
+        {
+            out = _histograms[i];
+            found = true;
+        }
+    }
+    xSemaphoreGive(_mutex);
+    return found;
+}
+
+// 按时间先后顺序读取最近的指令记录
+int FingerprintTrace::records(FingerprintTraceRecord *out, int maxCount)
+{
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    int count = min(_ringCount, maxCount);
+    int start = (_ringHead - count + RING_SIZE) % RING_SIZE;
+    for (int i = 0; i < count; i++)
+    {
+        out[i] = _ring[(start + i) % RING_SIZE];
+    }
+    xSemaphoreGive(_mutex);
+    return count;
+}
+
+void FingerprintTrace::reset()
+{
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    _ringHead = 0;
+    _ringCount = 0;
+    _histogramCount = 0;
+    xSemaphoreGive(_mutex);
+}
+
+void FingerprintTrace::dump()
+{
+    FingerprintTraceRecord ring[RING_SIZE];
+    int recordCount = records(ring, RING_SIZE);
+    Serial.printf("[Trace] Last %d commands:\n", recordCount);
+    Serial.println("  time(ms)  cmd  retry  first(us)  done(us)  frames  code");
+    for (int i = 0; i < recordCount; i++)
+    {
+        const FingerprintTraceRecord &r = ring[i];
+        if (r.firstByteUs == NO_FIRST_BYTE)
+        {
+            Serial.printf("  %8lu  %02X   %5u  %9s  %8lu  %6u  %02X\n", r.sendMs, r.cmd, r.retry, "-", r.completeUs, r.frames, r.confirm);
+        }
+        else
+        {
+            Serial.printf("  %8lu  %02X   %5u  %9lu  %8lu  %6u  %02X\n", r.sendMs, r.cmd, r.retry, r.firstByteUs, r.completeUs, r.frames, r.confirm);
+        }
+    }
+
+    FingerprintTraceHistogram h;
+    Serial.println("[Trace] Per-command latency (ms), buckets <1 <2 <4 <8 <16 <32 <64 <128 <256 <512 <1024 >=1024:");
+    for (int i = 0; histogram(i, h); i++)
+    {
+        Serial.printf("  %02X count %lu timeout %lu error %lu avg %lu max %lu |", h.cmd, h.count, h.timeouts, h.errors,
+                      h.count ? h.totalMs / h.count : 0, h.maxMs);
+        for (int b = 0; b < FingerprintTraceHistogram::BUCKETS; b++)
+        {
+            Serial.printf(" %u", h.buckets[b]);
+        }
+        Serial.println();
+    }
+}
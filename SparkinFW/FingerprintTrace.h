@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+#ifndef FINGERPRINT_TRACE_H
+#define FINGERPRINT_TRACE_H
+
+#include <Arduino.h>
+
+// 单条指令的耗时记录
+struct FingerprintTraceRecord
+{
+    uint32_t sendMs;      // 发送时间（开机后毫秒）
+    uint32_t firstByteUs; // 发送到收到第一个应答字节的耗时，0xFFFFFFFF 表示没有收到
+    uint32_t completeUs;  // 发送到最后一个应答包收齐的耗时
+    uint8_t cmd;          // 指令码
+    uint8_t confirm;      // 最后一个应答包的确认码，没有应答时为 CONFIRM_NO_RESPONSE
+    uint8_t retry;        // 本次比对中的第几次重试，0 表示首次
+    uint8_t frames;       // 收到的应答包数量
+};
+
+// 单个指令的耗时统计，直方图按毫秒对数分桶：第 i 桶为 [2^(i-1), 2^i) 毫秒，第0桶为 1 毫秒以内
+struct FingerprintTraceHistogram
+{
+    static const int BUCKETS = 12; // 最后一桶包含 1024 毫秒以上
+
+    uint8_t cmd;
+    uint32_t count;        // 指令次数
+    uint32_t timeouts;     // 没有收到应答的次数
+    uint32_t errors;       // 确认码不为0的次数
+    uint32_t totalMs;      // 累计耗时
+    uint32_t maxMs;        // 最大耗时
+    uint16_t buckets[BUCKETS];
+};
+
+// 指纹模组指令耗时追踪：每条指令记录到环形缓冲区和按指令分开的直方图
+// 在指令调度器的事务中调用 begin/firstByte/frame，读取和清除统计可以在任意任务中调用
+class FingerprintTrace
+{
+public:
+    static const int RING_SIZE = 32;    // 保留最近的指令记录数
+    static const int MAX_COMMANDS = 20; // 分开统计的指令数
+
+    FingerprintTrace();
+
+    // 发送指令时调用，上一条指令在这里结束并计入统计
+    void begin(uint8_t cmd);
+    // 收到应答数据时调用，只记录第一个字节的时间
+    void firstByte();
+    // 收到一个完整应答包或超时时调用
+    void frame(uint8_t confirm);
+    // 调度器事务结束时调用，结束最后一条指令并计入统计（之后模组可能断电，不会再有下一条指令）；
+    // 重试次数只属于本事务，同时清零
+    void end() { commit(); _retry = 0; }
+    // 之后发送的指令记为第几次重试，只在调度器事务内调用
+    void setRetry(uint8_t retry) { _retry = retry; }
+
+    // 读取第 index 个指令的统计，超出范围返回 false；一次只复制一个，调用方不需要在栈上放整个数组
+    bool histogram(int index, FingerprintTraceHistogram &out);
+    // 按指令码读取统计，还没有该指令的记录时返回 false
+    bool histogramOf(uint8_t cmd, FingerprintTraceHistogram &out);
+    // 读取统计，返回实际数量
+    int records(FingerprintTraceRecord *out, int maxCount);
+    void reset();
+
+    // 通过串口打印全部统计
+    void dump();
+
+private:
+    void commit();
+    FingerprintTraceHistogram *histogramFor(uint8_t cmd);
+    static int bucketOf(uint32_t ms);
+
+    FingerprintTraceRecord _current; // 正在进行的指令
+    bool _active;
+    uint32_t _sendUs;
+    uint8_t _retry;
+
+    FingerprintTraceRecord _ring[RING_SIZE];
+    int _ringHead;   // 下一条记录写入的位置
+    int _ringCount;
+    FingerprintTraceHistogram _histograms[MAX_COMMANDS];
+    int _histogramCount;
+    SemaphoreHandle_t _mutex; // 统计锁，读取统计不经过指令调度器
+};
+
+#endif // FINGERPRINT_TRACE_H
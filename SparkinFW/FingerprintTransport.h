@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+#ifndef FINGERPRINT_TRANSPORT_H
+#define FINGERPRINT_TRANSPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+
+// 指纹模组的物理连接：串口字节流、电源开关和触摸输出线
+// 设备上由 FingerprintUart 实现，主机上由 host/ 目录下的模组模拟器实现
+class FingerprintTransport
+{
+public:
+    virtual ~FingerprintTransport() {}
+
+    // 字节流
+    virtual void begin(uint32_t baudRate) = 0;
+    virtual void setBaudRate(uint32_t baudRate) = 0; // 等待已写入的数据发送完成后切换
+    virtual size_t write(const uint8_t *data, size_t len) = 0;
+    virtual int available() = 0;
+    virtual int read() = 0;
+    // 收到数据时回调，用于唤醒等待应答的任务
+    virtual void onReceive(const std::function<void()> &callback) = 0;
+
+    // 模组电源
+    virtual void setPower(bool on) = 0;
+    // 触摸输出线，手指在传感器上时为 true
+    virtual bool isTouched() = 0;
+};
+
+#endif // FINGERPRINT_TRANSPORT_H
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+#include "FingerprintUart.h"
+
+FingerprintUart::FingerprintUart(HardwareSerial &serial, int rxPin, int txPin, int powerPin, int touchPin)
+    : _serial(serial), _rxPin(rxPin), _txPin(txPin), _powerPin(powerPin), _touchPin(touchPin)
+{
+}
+
+void FingerprintUart::begin(uint32_t baudRate)
+{
+    _serial.setRxBufferSize(RX_BUFFER_SIZE); // 需要在 begin 之前设置
+    _serial.begin(baudRate, SERIAL_8N1, _rxPin, _txPin);
+    pinMode(_powerPin, OUTPUT);
+}
+
+void FingerprintUart::setBaudRate(uint32_t baudRate)
+{
+    _serial.flush(); // 等待发送完成
+    _serial.updateBaudRate(baudRate);
+}
+
+size_t FingerprintUart::write(const uint8_t *data, size_t len)
+{
+    return _serial.write(data, len);
+}
+
+int FingerprintUart::available()
+{
+    return _serial.available();
+}
+
+int FingerprintUart::read()
+{
+    return _serial.read();
+}
+
+void FingerprintUart::onReceive(const std::function<void()> &callback)
+{
+    // 串口收到数据（FIFO满或数据间隔超时）时回调
+    _serial.onReceive(callback, false);
+}
+
+void FingerprintUart::setPower(bool on)
+{
+    digitalWrite(_powerPin, on ? HIGH : LOW);
+}
+
+bool FingerprintUart::isTouched()
+{
+    return digitalRead(_touchPin) == HIGH;
+}
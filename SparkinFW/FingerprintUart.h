@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+#ifndef FINGERPRINT_UART_H
+#define FINGERPRINT_UART_H
+
+#include <Arduino.h>
+#include "FingerprintTransport.h"
+
+// 设备上的模组连接：硬件串口 + 电源控制引脚 + 触摸输出引脚
+class FingerprintUart : public FingerprintTransport
+{
+public:
+    static const size_t RX_BUFFER_SIZE = 4096; // 串口接收缓冲，能容纳一个完整模板上传
+
+    FingerprintUart(HardwareSerial &serial, int rxPin, int txPin, int powerPin, int touchPin);
+
+    void begin(uint32_t baudRate) override;
+    void setBaudRate(uint32_t baudRate) override;
+    size_t write(const uint8_t *data, size_t len) override;
+    int available() override;
+    int read() override;
+    void onReceive(const std::function<void()> &callback) override;
+
+    void setPower(bool on) override;
+    bool isTouched() override;
+
+private:
+    HardwareSerial &_serial;
+    int _rxPin;
+    int _txPin;
+    int _powerPin;
+    int _touchPin;
+};
+
+#endif // FINGERPRINT_UART_H
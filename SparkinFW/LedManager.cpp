@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+#include "LedManager.h"
+
+extern Fingerprint fingerprint;
+
+LedManager::LedManager()
+    : _stateMutex(nullptr), _inFlight(false), _inFlightEffect{}, _pending{}, _hasPending(false), _current{}, _hasCurrent(false) {
+}
+
+void LedManager::begin() {
+    _stateMutex = xSemaphoreCreateMutex();
+}
+
+void LedManager::requestLedEffect(uint8_t code, uint8_t startColor, uint8_t endColor, uint8_t loopCount) {
+    LedEffect effect = {code, startColor, endColor, loopCount, 0, false};
+    request(effect);
+}
+
+void LedManager::requestLedEffect(uint8_t code, uint8_t startColor, uint8_t endColor, uint8_t loopCount, uint8_t time) {
+    LedEffect effect = {code, startColor, endColor, loopCount, time, true};
+    request(effect);
+}
+
+void LedManager::resetState() {
+    if (_stateMutex && xSemaphoreTake(_stateMutex, portMAX_DELAY) == pdTRUE) {
+        _hasCurrent = false;
+        xSemaphoreGive(_stateMutex);
+    }
+}
+
+void LedManager::request(const LedEffect& effect) {
+    if (!_stateMutex) {
+        return;
+    }
+    if (xSemaphoreTake(_stateMutex, portMAX_DELAY) == pdTRUE) {
+        // 有灯效正在发送时，它完成后就是模组的状态
+        bool duplicate = _inFlight ? (isPersistent(_inFlightEffect) && effect == _inFlightEffect)
+                                   : (_hasCurrent && effect == _current);
+        if (duplicate) {
+            // 与模组将要保持的状态相同，之前排队的灯效也不需要了
+            _hasPending = false;
+        } else {
+            // 覆盖尚未发送的灯效，只保留最新的
+            _pending = effect;
+            _hasPending = true;
+        }
+        xSemaphoreGive(_stateMutex);
+    }
+    submitNext();
+}
+
+// 没有灯效在调度器中时提交最新的待执行灯效
+void LedManager::submitNext() {
+    LedEffect effect;
+    bool send = false;
+    if (xSemaphoreTake(_stateMutex, portMAX_DELAY) == pdTRUE) {
+        if (!_inFlight && _hasPending) {
+            effect = _pending;
+            _hasPending = false;
+            _inFlight = true;
+            _inFlightEffect = effect;
+            send = true;
+        }
+        xSemaphoreGive(_stateMutex);
+    }
+    if (!send) {
+        return;
+    }
+    // 提交时不能持有状态锁：调度任务未启动时事务和回调在这里直接执行
+    bool queued = fingerprint.scheduler().submit(
+        FingerprintScheduler::PRIORITY_LED,
+        [this, effect]() { return apply(effect); },
+        [this, effect](bool success) { onApplied(effect, success); },
+        true);
+    if (!queued && xSemaphoreTake(_stateMutex, portMAX_DELAY) == pdTRUE) {
+        _inFlight = false;
+        xSemaphoreGive(_stateMutex);
+    }
+}
+
+bool LedManager::apply(const LedEffect& effect) {
+    if (effect.hasTime) {
+        return fingerprint.setLEDCmd(effect.code, effect.startColor, effect.endColor, effect.loopCount, effect.time);
+    }
+    return fingerprint.setLEDCmd(effect.code, effect.startColor, effect.endColor, effect.loopCount);
+}
+
+// 在调度任务中回调
+void LedManager::onApplied(const LedEffect& effect, bool success) {
+    if (xSemaphoreTake(_stateMutex, portMAX_DELAY) == pdTRUE) {
+        _current = effect;
+        _hasCurrent = success && isPersistent(effect);
+        _inFlight = false;
+        xSemaphoreGive(_stateMutex);
+    }
+    // 等待期间又有新的请求
+    submitNext();
+}
+
+// 有限次数的闪烁/呼吸结束后灯会熄灭，不作为保持状态
+bool LedManager::isPersistent(const LedEffect& effect) {
+    return effect.loopCount == 0 ||
+           effect.code == Fingerprint::LED_CODE_ON || effect.code == Fingerprint::LED_CODE_OFF;
+}
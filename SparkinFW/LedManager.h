@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+#ifndef LED_MANAGER_H
+#define LED_MANAGER_H
+
+#include <Arduino.h>
+#include "Fingerprint.h"
+
+// 呼吸灯效果，对应模组呼吸灯指令的参数
+struct LedEffect {
+    uint8_t code;
+    uint8_t startColor;
+    uint8_t endColor;
+    uint8_t loopCount;
+    uint8_t time;
+    bool hasTime; // 是否带第五个参数
+
+    bool operator==(const LedEffect& other) const {
+        return code == other.code && startColor == other.startColor && endColor == other.endColor &&
+               loopCount == other.loopCount && hasTime == other.hasTime && (!hasTime || time == other.time);
+    }
+};
+
+// 呼吸灯指令队列：调用方不等待模组应答，灯效以最低优先级提交给指令调度器，
+// 在其他事务之间或采图退避的间隙中发送，同一时间最多有一个灯效在调度器中排队
+class LedManager {
+public:
+    LedManager();
+    void begin();
+
+    // 请求灯效，立即返回；只保留最新的一个待执行灯效，与当前状态或正在发送的灯效相同的请求被丢弃
+    void requestLedEffect(uint8_t code, uint8_t startColor, uint8_t endColor, uint8_t loopCount);
+    void requestLedEffect(uint8_t code, uint8_t startColor, uint8_t endColor, uint8_t loopCount, uint8_t time);
+
+    // 模组掉电或采图后灯的状态不再确定，下一次请求必须发送
+    void resetState();
+
+private:
+    void request(const LedEffect& effect);
+    void submitNext();
+    bool apply(const LedEffect& effect);
+    void onApplied(const LedEffect& effect, bool success);
+    static bool isPersistent(const LedEffect& effect);
+
+    SemaphoreHandle_t _stateMutex;
+    bool _inFlight;        // 是否有已提交给调度器、还没有完成的灯效
+    LedEffect _inFlightEffect;
+    LedEffect _pending;    // 待执行的灯效
+    bool _hasPending;
+    LedEffect _current;    // 模组当前保持的灯效
+    bool _hasCurrent;
+};
+
+#endif
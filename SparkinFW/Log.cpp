@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+#include "Log.h"
+#if !LOG_IMMEDIATE
+#include <esp_memory_utils.h>
+#endif
+
+// 每个槽位的序号减去槽位下标后存储，零初始化的缓冲区即为全部空槽，开机后不需要初始化就可以记录
+// 槽位可写：序号 == 本圈起点；可读：序号 == 本圈起点 + 1；读出后序号推进到下一圈起点
+Log::Record Log::_ring[Log::RING_SIZE];
+std::atomic<uint32_t> Log::_writePos;
+std::atomic<uint32_t> Log::_readPos;
+std::atomic<uint32_t> Log::_dropped;
+
+static const uint32_t RING_MASK = Log::RING_SIZE - 1;
+
+void Log::record(uint8_t level, const char *format, const uint32_t *args, uint8_t argc)
+{
+    uint32_t pos = _writePos.load(std::memory_order_relaxed);
+    Record *slot;
+    while (true)
+    {
+        slot = &_ring[pos & RING_MASK];
+        int32_t diff = (int32_t)(slot->sequence.load(std::memory_order_acquire) - (pos & ~RING_MASK));
+        if (diff == 0)
+        {
+            if (_writePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            // 槽位上一圈的记录还没有输出，缓冲区已满
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        else
+        {
+            pos = _writePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->timestamp = micros();
+    slot->format = format;
+    slot->level = level;
+    slot->argc = argc;
+    for (uint8_t i = 0; i < argc; i++)
+        slot->args[i] = args[i];
+    slot->sequence.store((pos & ~RING_MASK) + 1, std::memory_order_release);
+}
+
+bool Log::pop(uint32_t &timestamp, const char *&format, uint8_t &level, uint8_t &argc, uint32_t *args)
+{
+    uint32_t pos = _readPos.load(std::memory_order_relaxed);
+    Record *slot;
+    while (true)
+    {
+        slot = &_ring[pos & RING_MASK];
+        int32_t diff = (int32_t)(slot->sequence.load(std::memory_order_acquire) - ((pos & ~RING_MASK) + 1));
+        if (diff == 0)
+        {
+            if (_readPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            return false; // 空，或者写入方还没有写完这一条
+        }
+        else
+        {
+            pos = _readPos.load(std::memory_order_relaxed);
+        }
+    }
+
+    timestamp = slot->timestamp;
+    format = slot->format;
+    level = slot->level;
+    argc = slot->argc;
+    for (uint8_t i = 0; i < argc; i++)
+        args[i] = slot->args[i];
+    slot->sequence.store((pos & ~RING_MASK) + RING_SIZE, std::memory_order_release);
+    return true;
+}
+
+#if LOG_IMMEDIATE
+// 同步输出时不经过缓冲区
+#elif LOG_OUTPUT_BINARY
+// 二进制帧：A5 5A 长度 | 时间戳(4) 格式串地址(4) 级别(1) 参数个数(1) 参数(4*n) | 累加和，多字节均为小端
+void Log::output(uint32_t timestamp, const char *format, uint8_t level, uint8_t argc, const uint32_t *args)
+{
+    uint8_t frame[3 + 10 + MAX_ARGS * 4 + 1];
+    uint8_t *payload = frame + 3;
+    uint8_t length = 0;
+    uint32_t address = (uint32_t)(uintptr_t)format;
+    memcpy(payload + length, &timestamp, 4);
+    length += 4;
+    memcpy(payload + length, &address, 4);
+    length += 4;
+    payload[length++] = level;
+    payload[length++] = argc;
+    memcpy(payload + length, args, argc * 4);
+    length += argc * 4;
+
+    uint8_t sum = 0;
+    for (uint8_t i = 0; i < length; i++)
+        sum += payload[i];
+    frame[0] = 0xA5;
+    frame[1] = 0x5A;
+    frame[2] = length;
+    payload[length] = sum;
+    Serial.write(frame, 3 + length + 1);
+}
+#else
+// 在设备上还原文本：逐个转换说明分别调用 snprintf，参数类型由转换字符决定
+void Log::output(uint32_t timestamp, const char *format, uint8_t level, uint8_t argc, const uint32_t *args)
+{
+    static const char LEVEL_CHARS[] = "?EWID";
+    char line[192];
+    size_t length = snprintf(line, sizeof(line), "%c (%lu) ", LEVEL_CHARS[level <= LOG_LEVEL_DEBUG ? level : 0],
+                             (unsigned long)(timestamp / 1000));
+    uint8_t argIndex = 0;
+    const char *p = format;
+    while (*p && length < sizeof(line) - 1)
+    {
+        if (*p != '%')
+        {
+            line[length++] = *p++;
+            continue;
+        }
+        if (p[1] == '%')
+        {
+            line[length++] = '%';
+            p += 2;
+            continue;
+        }
+
+        // 复制标志、宽度和精度，去掉长度修饰符（参数都已经是32位）
+        char spec[16];
+        size_t specLength = 0;
+        spec[specLength++] = *p++;
+        while (*p && strchr("-+ #0123456789.", *p) && specLength < sizeof(spec) - 2)
+            spec[specLength++] = *p++;
+        while (*p && strchr("hlLqjzt", *p))
+            p++;
+        char conversion = *p;
+        if (!conversion)
+            break;
+        p++;
+        spec[specLength++] = conversion;
+        spec[specLength] = '\0';
+
+        size_t space = sizeof(line) - length;
+        uint32_t arg = argIndex < argc ? args[argIndex] : 0;
+        argIndex++;
+        int written;
+        switch (conversion)
+        {
+        case 'd':
+        case 'i':
+        case 'c':
+            written = snprintf(line + length, space, spec, (int)arg);
+            break;
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+            written = snprintf(line + length, space, spec, (unsigned int)arg);
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+        {
+            float value;
+            memcpy(&value, &arg, sizeof(value));
+            written = snprintf(line + length, space, spec, (double)value);
+            break;
+        }
+        case 's':
+        {
+            // 只解引用 flash 中的字符串，避免把已经失效的栈缓冲区当作字符串
+            const char *text = (const char *)(uintptr_t)arg;
+            written = snprintf(line + length, space, spec, esp_ptr_in_drom(text) ? text : "<?>");
+            break;
+        }
+        case 'p':
+            written = snprintf(line + length, space, spec, (void *)(uintptr_t)arg);
+            break;
+        default:
+            written = snprintf(line + length, space, "%s", spec);
+            break;
+        }
+        if (written > 0)
+            length += min((size_t)written, space - 1);
+    }
+    length = min(length, sizeof(line) - 1);
+    line[length] = '\0';
+    Serial.println(line);
+}
+#endif
+
+void Log::drain()
+{
+#if !LOG_IMMEDIATE
+    static uint32_t reportedDropped = 0;
+    uint32_t timestamp;
+    const char *format;
+    uint8_t level;
+    uint8_t argc;
+    uint32_t args[MAX_ARGS];
+    while (pop(timestamp, format, level, argc, args))
+    {
+        output(timestamp, format, level, argc, args);
+    }
+
+    // 丢弃的条数也作为一条日志输出
+    uint32_t droppedCount = dropped();
+    if (droppedCount != reportedDropped)
+    {
+        LOGW("[LOG] %u records dropped", droppedCount - reportedDropped);
+        reportedDropped = droppedCount;
+    }
+#endif
+}
+
+void Log::flush()
+{
+    drain();
+    drain(); // 输出丢弃统计
+}
+
+void Log::taskFunction(void *param)
+{
+    while (true)
+    {
+        drain();
+        vTaskDelay(DRAIN_INTERVAL_MS / portTICK_PERIOD_MS);
+    }
+}
+
+void Log::begin()
+{
+#if !LOG_IMMEDIATE
+    // 与空闲任务同优先级，只在其他任务都不运行时才格式化和输出
+    xTaskCreate(taskFunction, "LogTask", 3072, NULL, tskIDLE_PRIORITY, NULL);
+#endif
+}
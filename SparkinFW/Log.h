@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+#ifndef LOG_H
+#define LOG_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <string.h>
+#include <type_traits>
+
+// 延迟日志：热路径只记录格式串地址和参数到无锁环形缓冲区，由最低优先级任务格式化后输出到串口
+// 格式串必须是字面量（编译期放在 flash 的只读数据段，地址即为格式串编号），%s 参数也只能是字面量
+// 参数只支持32位以内的整数、指针和浮点数（浮点数按 float 记录），格式串末尾不需要换行
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+// 编译期过滤：高于这个级别的日志调用连同格式串一起被编译器去掉
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// 1：输出带校验的二进制帧，由 host/logdecode.py 按固件 ELF 还原文本；0：设备上格式化为文本
+#ifndef LOG_OUTPUT_BINARY
+#define LOG_OUTPUT_BINARY 0
+#endif
+
+// 1：直接调用 Serial.printf 同步输出（主机测试使用）
+#ifndef LOG_IMMEDIATE
+#define LOG_IMMEDIATE 0
+#endif
+
+#define LOG_AT(level, fmt, ...)                             \
+    do                                                      \
+    {                                                       \
+        if ((level) <= LOG_LEVEL)                           \
+            Log::write((level), "" fmt, ##__VA_ARGS__);     \
+    } while (0)
+
+#define LOGE(fmt, ...) LOG_AT(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#define LOGW(fmt, ...) LOG_AT(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#define LOGI(fmt, ...) LOG_AT(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#define LOGD(fmt, ...) LOG_AT(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+
+class Log
+{
+public:
+    static const int MAX_ARGS = 8;
+    static const uint32_t RING_SIZE = 128;        // 必须是2的幂
+    static const uint32_t DRAIN_INTERVAL_MS = 10; // 输出任务的轮询间隔
+
+    // 单条日志记录
+    struct Record
+    {
+        std::atomic<uint32_t> sequence; // 槽位序号，区分空槽和已写入的槽
+        uint32_t timestamp;             // 记录时间（开机后微秒）
+        const char *format;
+        uint8_t level;
+        uint8_t argc;
+        uint32_t args[MAX_ARGS];
+    };
+
+    // 启动输出任务；启动之前的日志留在缓冲区中，缓冲区满后丢弃新日志
+    static void begin();
+    // 在调用方同步输出缓冲区中的全部日志（重启或进入睡眠前调用）
+    static void flush();
+    // 因为缓冲区已满丢弃的日志条数
+    static uint32_t dropped() { return _dropped.load(std::memory_order_relaxed); }
+
+    template <typename... Args>
+    static inline void write(uint8_t level, const char *format, Args... args)
+    {
+        static_assert(sizeof...(Args) <= MAX_ARGS, "too many log arguments");
+#if LOG_IMMEDIATE
+        (void)level;
+        Serial.printf(format, args...);
+        Serial.println();
+#else
+        const uint32_t packed[] = {pack(args)..., 0};
+        record(level, format, packed, sizeof...(Args));
+#endif
+    }
+
+private:
+    template <typename T>
+    static inline uint32_t pack(T value)
+    {
+        static_assert(std::is_integral<T>::value || std::is_enum<T>::value, "log arguments must be integers, floats or pointers");
+        // ESP32 上 long 是32位
+        static_assert(sizeof(T) <= sizeof(long), "64-bit log arguments are not supported");
+        return (uint32_t)value;
+    }
+    template <typename T>
+    static inline uint32_t pack(T *pointer) { return (uint32_t)(uintptr_t)pointer; }
+    static inline uint32_t pack(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+    static inline uint32_t pack(double value) { return pack((float)value); }
+
+    static void record(uint8_t level, const char *format, const uint32_t *args, uint8_t argc);
+    static bool pop(uint32_t &timestamp, const char *&format, uint8_t &level, uint8_t &argc, uint32_t *args);
+    static void output(uint32_t timestamp, const char *format, uint8_t level, uint8_t argc, const uint32_t *args);
+    static void drain();
+    static void taskFunction(void *param);
+
+    static Record _ring[RING_SIZE];
+    static std::atomic<uint32_t> _writePos;
+    static std::atomic<uint32_t> _readPos;
+    static std::atomic<uint32_t> _dropped;
+};
+
+#endif // LOG_H
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+#include "SerialHandle.h"
+#include "Fingerprint.h"
+
+extern Fingerprint fingerprint;
+
+static char commandLine[SERIAL_COMMAND_LENGTH];
+static size_t commandLength = 0;
+
+static void executeSerialCommand(const char* command) {
+    if (strcmp(command, "trace") == 0) {
+        fingerprint.trace().dump();
+    } else if (strcmp(command, "trace reset") == 0) {
+        fingerprint.trace().dump();
+        fingerprint.trace().reset();
+        Serial.println("[Trace] Statistics cleared");
+    } else if (command[0] != '\0') {
+        Serial.printf("Unknown command: %s\n", command);
+        Serial.println("Commands: trace, trace reset");
+    }
+}
+
+void handleSerialInput() {
+    while (Serial.available()) {
+        char c = (char)Serial.read();
+        if (c == '\r' || c == '\n') {
+            commandLine[commandLength] = '\0';
+            executeSerialCommand(commandLine);
+            commandLength = 0;
+        } else if (commandLength < SERIAL_COMMAND_LENGTH - 1) {
+            commandLine[commandLength++] = c;
+        }
+    }
+}
@@ -0,0 +1,17 @@
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+#ifndef SERIAL_HANDLE_H
+#define SERIAL_HANDLE_H
+#include <Arduino.h>
+
+#define SERIAL_COMMAND_LENGTH 32 // 调试串口单行命令最大长度
+
+// 调试串口命令，在 loop() 中调用，不阻塞
+// trace        打印模组指令耗时统计
+// trace reset  打印后清除统计
+void handleSerialInput();
+
+#endif
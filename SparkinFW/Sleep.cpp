@@ -8,6 +8,7 @@
 #include <esp_wifi.h>
 #include <driver/gpio.h>
 #include "IOPin.h"
+#include "Log.h"
 
 void configureWakeupSources() {
     // 确保引脚配置为输入模式
@@ -20,10 +21,11 @@ void configureWakeupSources() {
 }
 
 int enterLightSleep() {
-    Serial.println("[SLEEP]ESP32进入轻度睡眠模式");
+    LOGI("[SLEEP]ESP32进入轻度睡眠模式");
       // 确保唤醒源已正确配置
     configureWakeupSources();
-    // 等待串口输出完成
+    // 输出缓冲区中的日志并等待串口输出完成，否则这些日志要到唤醒后才输出
+    Log::flush();
     Serial.flush();
     
     // 进入轻度睡眠
@@ -33,44 +35,44 @@ int enterLightSleep() {
     int wakeup_pin = -1;  // 初始化唤醒引脚变量
     switch(wakeup_reason) {
         case ESP_SLEEP_WAKEUP_GPIO:{
-            Serial.println("[SLEEP]GPIO唤醒");
+            LOGI("[SLEEP]GPIO唤醒");
             // 检查具体GPIO
             if (digitalRead(PIN_PAIR_BUTTON) == LOW) {
-                Serial.println("[SLEEP]由配对按键引脚唤醒");
+                LOGI("[SLEEP]由配对按键引脚唤醒");
                 wakeup_pin = PIN_PAIR_BUTTON;
             }
             else {
-                Serial.println("[SLEEP]由指纹触摸引脚唤醒");
+                LOGI("[SLEEP]由指纹触摸引脚唤醒");
                 wakeup_pin = PIN_FINGERPRINT_TOUCH;
             }
             break;
         }
         case ESP_SLEEP_WAKEUP_UART:
-            Serial.println("[SLEEP]UART唤醒");
+            LOGI("[SLEEP]UART唤醒");
             break;
         case ESP_SLEEP_WAKEUP_TIMER:
-            Serial.println("[SLEEP]定时器唤醒");
+            LOGI("[SLEEP]定时器唤醒");
             break;
         case ESP_SLEEP_WAKEUP_TOUCHPAD:
-            Serial.println("[SLEEP]触摸唤醒");
+            LOGI("[SLEEP]触摸唤醒");
             break;
         case ESP_SLEEP_WAKEUP_ULP:
-            Serial.println("[SLEEP]ULP唤醒");
+            LOGI("[SLEEP]ULP唤醒");
             break;
         case ESP_SLEEP_WAKEUP_WIFI:
-            Serial.println("[SLEEP]WiFi唤醒");
+            LOGI("[SLEEP]WiFi唤醒");
             break;
         case ESP_SLEEP_WAKEUP_UNDEFINED:
-            Serial.println("[SLEEP]未定义唤醒");
+            LOGI("[SLEEP]未定义唤醒");
             break;
         default:
-            Serial.printf("[SLEEP]其他唤醒源: %d\n", wakeup_reason);
+            LOGI("[SLEEP]其他唤醒源: %d", (int)wakeup_reason);
             break;
     }
     
     // 醒来后的处理
     gpio_wakeup_disable((gpio_num_t)PIN_PAIR_BUTTON);
     
-    Serial.println("[SLEEP]设备已唤醒");
+    LOGI("[SLEEP]设备已唤醒");
     return wakeup_pin;
 }
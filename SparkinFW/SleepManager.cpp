@@ -4,21 +4,26 @@
  * All rights reserved
  */
 #include "SleepManager.h"
+#include "LedManager.h"
 #include "Sleep.h"
 #include "Fingerprint.h"
 #include "BluetoothManager.h"
 #include "Common.h"
 #include "IOPin.h"
 #include "ButtonHandle.h"
+#include "FingerprintManager.h"
+#include "Log.h"
 
 extern Fingerprint fingerprint;
+extern LedManager ledManager;
 extern BluetoothManager bluetoothManager;
 extern ConfigManager configManager;
 extern ButtonHandler buttonHandler;
+extern FingerprintManager fingerprintManager;
 extern void handleTouchInterrupt();
 
 SleepManager::SleepManager() 
-    : _lastActivityTime(0), _bPreventSleep(false), _bSleepMode(false) {
+    : _lastActivityTime(0), _bPreventSleep(false), _bSleepMode(false), _bSensorSleeping(false) {
 }
 
 void SleepManager::begin() {
@@ -95,7 +100,7 @@ void SleepManager::loop() {
 }
 
 void SleepManager::enterSleepMode() {
-    Serial.println("[SLEEP]自动休眠时间已到，准备进入休眠模式...");
+    LOGI("[SLEEP]自动休眠时间已到，准备进入休眠模式...");
     _bSleepMode = true;
     
     // 禁用自动广播，防止断开连接后立即重连
@@ -104,16 +109,25 @@ void SleepManager::enterSleepMode() {
     // 停止按键任务和定时器，准备休眠
     buttonHandler.end();
 
-    // 指纹模块休眠
-    fingerprint.setPower(false);
-    Serial.println("[SLEEP]指纹模块已进入休眠模式");
+    // 休眠期间可能掉电，先保存还没有写入的匹配次数
+    fingerprintManager.saveUsage();
+
+    // 指纹模块按配置休眠或断电，休眠指令失败时断电
+    _bSensorSleeping = false;
+    if (configManager.getSensorPowerPolicy() == Fingerprint::SENSOR_POWER_SLEEP && fingerprint.sleepFingerprint()) {
+        _bSensorSleeping = true;
+        LOGI("[SLEEP]指纹模块已进入低功耗休眠");
+    } else {
+        fingerprint.setPower(false);
+        LOGI("[SLEEP]指纹模块已断电");
+    }
 
     // 取消中断
     detachInterrupt(digitalPinToInterrupt(PIN_FINGERPRINT_TOUCH));
 
     // 断开蓝牙
     if (bluetoothManager.isConnected()) {
-        Serial.println("[SLEEP]蓝牙已经连接，尝试断开...");
+        LOGI("[SLEEP]蓝牙已经连接，尝试断开...");
         bluetoothManager.disconnectCurrentDevice();
         // 等待客户端断开连接
         EventBits_t uxBits = xEventGroupWaitBits(
@@ -125,45 +139,53 @@ void SleepManager::enterSleepMode() {
         );
         
         if (uxBits & EVENT_BIT_BLE_DISCONNECTED) {
-            Serial.println("[SLEEP]蓝牙断开连接成功");
+            LOGI("[SLEEP]蓝牙断开连接成功");
         } else {
-            Serial.println("[SLEEP]蓝牙断开连接超时");
+            LOGI("[SLEEP]蓝牙断开连接超时");
         }
     }
 
     // 进入轻度睡眠
     int wakeUpPin = enterLightSleep();
+    uint32_t wakeTime = touchClockMs();
     
     // 唤醒后的处理
     wakeUp();
     
-    // 如果是触摸唤醒，触发一次指纹识别逻辑（这里通过全局标志位传递给FingerprintManager）
+    // 如果是触摸唤醒，投递一次触摸事件给FingerprintManager触发指纹识别
+    // 时间戳取唤醒时刻，指纹任务打印的延迟即为唤醒到开始采图的耗时
     if(wakeUpPin == PIN_FINGERPRINT_TOUCH) {
-        touchTriggered = true;
+        postTouchEvent(wakeTime);
     }
 }
 
 void SleepManager::wakeUp() {
-    Serial.println("[SLEEP]从休眠中唤醒");
-    Serial.flush();
-    
-    Serial.println("[SLEEP]准备调用 buttonHandler.begin()");
-    Serial.flush();
-    
+    LOGI("[SLEEP]从休眠中唤醒");
+    LOGD("[SLEEP]准备调用 buttonHandler.begin()");
+
     // 1. 首先启动按键任务，确保能够检测按键状态
     //    即使按键在唤醒时已经按下，也能被检测到
     buttonHandler.begin();
     
-    Serial.println("[SLEEP]buttonHandler.begin() 调用完成");
-    Serial.flush();
+    LOGD("[SLEEP]buttonHandler.begin() 调用完成");
     
     // 2. 恢复自动广播（只是设置标志位，不会阻塞）
     bluetoothManager.enableAutoAdvertising(true);
 
-    // 3. 重新初始化指纹模块（阻塞操作）
-    //    注意：这里会阻塞最多500ms，但按键任务已经在运行了
-    fingerprint.setPower(true);
-    fingerprint.waitStartSignal();
+    // 3. 恢复指纹模块
+    //    模组只是休眠时读一次参数确认即可；断电时需要上电并等待启动信号（最多阻塞600ms，但按键任务已经在运行了）
+    uint32_t sensorStart = millis();
+    if (!(_bSensorSleeping && fingerprint.resumeFromSleep())) {
+        if (_bSensorSleeping) {
+            // 模组没有响应，断电重启
+            fingerprint.setPower(false);
+        }
+        fingerprint.setPower(true);
+        fingerprint.waitStartSignal();
+    }
+    _bSensorSleeping = false;
+    LOGI("[SLEEP]指纹模块恢复耗时 %u ms", (uint32_t)(millis() - sensorStart));
+    ledManager.resetState(); // 模组重新上电或唤醒，灯恢复默认状态
     
     // 4. 恢复中断
     attachInterrupt(digitalPinToInterrupt(PIN_FINGERPRINT_TOUCH), handleTouchInterrupt, RISING);
@@ -36,6 +36,7 @@ private:
     uint32_t _lastActivityTime;
     bool _bPreventSleep;
     bool _bSleepMode;
+    bool _bSensorSleeping; // 指纹模组只是休眠而没有断电
 };
 
 #endif
@@ -9,6 +9,7 @@
 
 #include "IOPin.h"
 #include "Fingerprint.h"
+#include "FingerprintUart.h"
 #include "BluetoothManager.h"
 #include "BleKeyboard.h"
 #include "BluetoothHandle.h"
@@ -21,11 +22,17 @@
 #include "SleepManager.h"
 #include "UnlockManager.h"
 #include "FingerprintManager.h"
+#include "LedManager.h"
+#include "EnrollManager.h"
+#include "SerialHandle.h"
+#include "Log.h"
 
 #define BLUETOOTH_NAME "Sparkin FP01"
 
 // 定义类对象
-Fingerprint fingerprint(PIN_FINGERPRINT_RX, PIN_FINGERPRINT_TX);  //指纹传感器对象
+FingerprintUart fingerprintUart(Serial1, PIN_FINGERPRINT_RX, PIN_FINGERPRINT_TX,
+                                PIN_FINGERPRINT_POWER, PIN_FINGERPRINT_TOUCH); //指纹模组串口、电源和触摸线
+Fingerprint fingerprint(fingerprintUart);                         //指纹传感器对象
 BluetoothManager bluetoothManager;                                //蓝牙管理器
 BleKeyboard bleKeyboard;                                          //键盘对象
 ConfigManager configManager;                                      //配置信息
@@ -35,6 +42,8 @@ BatteryManager batteryManager(PIN_BATTERY_ADC, PIN_BATTERY_TEST); //电池管理
 SleepManager sleepManager;                                        //休眠管理器
 UnlockManager unlockManager;                                      //解锁管理器
 FingerprintManager fingerprintManager;                            //指纹消息管理器
+LedManager ledManager;                                            //呼吸灯指令队列
+EnrollManager enrollManager;                                      //指纹注册状态机
 
 // 用于跟踪触摸引脚的上一个状态
 int lastTouchState = LOW;
@@ -43,6 +52,8 @@ void setup() {
   // 初始化串口
   Serial.begin(115200);
   Serial.println(">>>>>>>>>>Sparkin Fingerprint Started!<<<<<<<<<<");
+  // 启动日志输出任务，热路径上的日志先写入缓冲区，空闲时再输出到串口
+  Log::begin();
 
   // 版本信息
   versionInfo.deviceId = String(ESP.getEfuseMac(), HEX);
@@ -56,13 +67,27 @@ void setup() {
   configManager.load();
   
   // 初始化指纹模组
-  fingerprint.begin(57600);
+  fingerprint.begin(configManager.getFingerprintBaud());  // 按上次协商的波特率打开串口
+  fingerprint.setMatchMode(configManager.getMatchMode());
+  fingerprint.setHotSearch(configManager.getHotSearch());
+  uint16_t usageCounts[MAX_FINGERPRINT_NUM];
+  configManager.loadFingerprintUsage(usageCounts);
+  fingerprint.setUsageCounts(usageCounts);  // 热点搜索使用的匹配次数
   fingerprint.setPower(true);  // 开启指纹模组电源
   fingerprint.waitStartSignal();  // 等待指纹模组启动信号
+  // 协商通信参数：提高波特率和数据包长度，失败回退到57600
+  fingerprint.negotiateLink();
+  if (fingerprint.getBaudRate() != configManager.getFingerprintBaud()) {
+    configManager.setFingerprintBaud(fingerprint.getBaudRate());
+    configManager.save();
+  }
   // 上电打印模组基本参数
   fingerprint.readInfo();
-  // 设置初始等待颜色
-  fingerprint.setLEDCmd(Fingerprint::LED_CODE_BLINK,0x06,0x11,0x00,4);  // 黄色闪烁灯
+  // 读取索引表到缓存，之后查询指纹列表不再访问模组
+  fingerprint.loadIndexTable();
+  // 启动呼吸灯指令队列，设置初始等待颜色
+  ledManager.begin();
+  ledManager.requestLedEffect(Fingerprint::LED_CODE_BLINK,0x06,0x11,0x00,4);  // 黄色闪烁灯
 
   // 检查电池电量初始化
   batteryManager.init();
@@ -70,6 +95,7 @@ void setup() {
   // 初始化蓝牙
   bluetoothManager.begin(BLUETOOTH_NAME, &bleKeyboard);
   bluetoothManager.setMessageCallback(handleBluetoothMessage);
+  bluetoothManager.setBulkCallback(handleBulkMessage);
   bluetoothManager.setAutoReconnect(true);  // 启用自动重连
 
   // 按键事件
@@ -77,6 +103,8 @@ void setup() {
 
   // 初始化事件组
   init_event_group();
+  // 初始化触摸事件队列，必须在挂中断之前
+  init_touch_queue();
 
   // 引脚初始化
   pinMode(PIN_PAIR_BUTTON, INPUT_PULLUP);
@@ -89,6 +117,8 @@ void setup() {
   unlockManager.begin(&sleepManager);
   // 初始化指纹消息管理器 
   fingerprintManager.begin(&sleepManager, &unlockManager);
+  // 启动指纹注册状态机
+  enrollManager.begin(&sleepManager);
 
   // 立即检查电池电量
   batteryManager.CheckBatteryLow();
@@ -103,5 +133,11 @@ void loop() {
   // 休眠管理
   sleepManager.loop();
 
+  // 定时检查电池电量
+  batteryManager.loop();
+
+  // 调试串口命令
+  handleSerialInput();
+
   delay(50);
 }
@@ -4,18 +4,19 @@
  * All rights reserved
  */
 #include "UnlockManager.h"
+#include "Log.h"
 
 extern BluetoothManager bluetoothManager;
 extern BleKeyboard bleKeyboard;
 extern EventGroupHandle_t event_group;
 
 UnlockManager::UnlockManager() 
-    : _taskHandle(nullptr), _requestQueue(nullptr), _sleepManager(nullptr), _isBusy(false) {
+    : _taskHandle(nullptr), _requestQueue(nullptr), _sleepManager(nullptr), _state(UNLOCK_IDLE) {
 }
 
 void UnlockManager::begin(SleepManager* sleepManager) {
     _sleepManager = sleepManager;
-    _requestQueue = xQueueCreate(1, sizeof(uint8_t)); // 队列长度1，只需要一个触发信号
+    _requestQueue = xQueueCreate(1, sizeof(FingerprintMatchResult)); // 队列长度1，携带本次比对结果
     
     // 创建任务
     xTaskCreate(
@@ -28,47 +29,66 @@ void UnlockManager::begin(SleepManager* sleepManager) {
     );
 }
 
-bool UnlockManager::requestUnlock() {
-    if (_isBusy) {
-        Serial.println("[Unlock] 正在执行解锁任务，忽略新的请求");
+bool UnlockManager::requestUnlock(const FingerprintMatchResult& result) {
+    if (isBusy()) {
+        LOGI("[Unlock] 正在执行解锁任务，忽略新的请求");
         return false;
     }
     
-    uint8_t dummy = 1;
     // 发送请求到队列，非阻塞
-    if (xQueueSend(_requestQueue, &dummy, 0) == pdTRUE) {
+    _state = UNLOCK_PENDING;
+    if (xQueueSend(_requestQueue, &result, 0) == pdTRUE) {
         return true;
     }
+    setIdle();
     return false;
 }
 
 bool UnlockManager::isBusy() {
-    return _isBusy;
+    return _state == UNLOCK_PENDING || _state == UNLOCK_RUNNING;
+}
+
+void UnlockManager::beginMatch() {
+    if (_state == UNLOCK_IDLE) {
+        _state = UNLOCK_MATCHING;
+    }
+}
+
+void UnlockManager::endMatch() {
+    if (_state == UNLOCK_MATCHING) {
+        setIdle();
+    }
+}
+
+void UnlockManager::setIdle() {
+    _state = UNLOCK_IDLE;
+    // 解锁流程结束，清除流程中可能残留的连接/订阅事件，避免下次直接通过等待
+    xEventGroupClearBits(event_group, EVENT_BIT_BLE_CONNECTED | EVENT_BIT_BLE_NOTIFY);
 }
 
 void UnlockManager::taskFunction(void* param) {
     UnlockManager* manager = static_cast<UnlockManager*>(param);
-    uint8_t dummy;
+    FingerprintMatchResult result;
     
     while (true) {
         // 等待请求
-        if (xQueueReceive(manager->_requestQueue, &dummy, portMAX_DELAY) == pdTRUE) {
-            manager->_isBusy = true;
-            manager->executeUnlockSequence();
-            manager->_isBusy = false;
+        if (xQueueReceive(manager->_requestQueue, &result, portMAX_DELAY) == pdTRUE) {
+            manager->_state = UNLOCK_RUNNING;
+            manager->executeUnlockSequence(result);
+            manager->setIdle();
         }
     }
 }
 
-void UnlockManager::executeUnlockSequence() {
-    Serial.println("[Unlock] 开始执行解锁序列");
+void UnlockManager::executeUnlockSequence(const FingerprintMatchResult& result) {
+    LOGI("[Unlock] 开始执行解锁序列");
     
     // 防止过程中休眠
     if (_sleepManager) _sleepManager->resetActivity();
 
     // 1. 检查蓝牙连接
     if (!bluetoothManager.isConnected()) {
-        Serial.println("[Unlock] 蓝牙未连接，等待连接...");
+        LOGI("[Unlock] 蓝牙未连接，等待连接...");
         // 等待蓝牙连接，最多等待10秒
         EventBits_t uxBits = xEventGroupWaitBits(
             event_group,
@@ -79,20 +99,23 @@ void UnlockManager::executeUnlockSequence() {
         );
         
         if (uxBits & EVENT_BIT_BLE_CONNECTED) {
-            Serial.println("[Unlock] 蓝牙连接成功");
+            LOGI("[Unlock] 蓝牙连接成功");
         } else {
-            Serial.println("[Unlock] 蓝牙连接超时");
+            LOGW("[Unlock] 蓝牙连接超时");
             return; // 退出序列
         }
     }
 
+    // 解锁握手期间使用快速连接参数
+    bluetoothManager.requestFastConnection(BluetoothManager::CONN_CONNECT_HOLD_MS);
+
     // 2. 发送唤醒按键 (Left Ctrl)
-    Serial.println("[Unlock] 发送唤醒按键");
+    LOGI("[Unlock] 发送唤醒按键");
     bleKeyboard.write(KEY_LEFT_CTRL);
 
     // 3. 检查通知订阅状态
     if (!bluetoothManager.isNotificationEnabled()) {
-        Serial.println("[Unlock] 蓝牙未订阅，等待订阅");
+        LOGI("[Unlock] 蓝牙未订阅，等待订阅");
         EventBits_t notifyBits = xEventGroupWaitBits(
             event_group,
             EVENT_BIT_BLE_NOTIFY,
@@ -102,15 +125,15 @@ void UnlockManager::executeUnlockSequence() {
         );
         
         if (!(notifyBits & EVENT_BIT_BLE_NOTIFY)) {
-            Serial.println("[Unlock] 订阅消息通道未返回，无法发送指纹识别消息");
+            LOGW("[Unlock] 订阅消息通道未返回，无法发送指纹识别消息");
             return;
         }
-        Serial.println("[Unlock] 收到了订阅成功消息");
+        LOGI("[Unlock] 收到了订阅成功消息");
     } else {
         // 尝试查询锁屏状态
-        Serial.println("[Unlock] 蓝牙已连接，发送消息查询电脑是否在锁屏状态");
-        uint8_t result = 1;
-        bluetoothManager.sendMessage(MSG_LOCKSCREEN_STATUS, &result, 1);
+        LOGI("[Unlock] 蓝牙已连接，发送消息查询电脑是否在锁屏状态");
+        uint8_t query = 1;
+        bluetoothManager.sendMessage(MSG_LOCKSCREEN_STATUS, &query, 1);
 
         EventBits_t uxBits = xEventGroupWaitBits(
             event_group,
@@ -121,19 +144,28 @@ void UnlockManager::executeUnlockSequence() {
         );
         
         if (!(uxBits & EVENT_BIT_SCREENLOCK)) {
-            Serial.println("[Unlock] 等待电脑响应超时，可能休眠了，尝试再次发送按键唤醒电脑");
+            LOGW("[Unlock] 等待电脑响应超时，可能休眠了，尝试再次发送按键唤醒电脑");
             bleKeyboard.write(KEY_LEFT_CTRL);
             delay(1000);
         }
     }
 
-    // 4. 发送解锁命令
-    Serial.println("[Unlock] 发送指纹解锁屏幕命令");
-    uint8_t result = 1;
-    bluetoothManager.sendMessage(MSG_FINGERPRINT_SEARCH, &result, 1);
+    // 4. 发送解锁命令，附带比对结果
+    LOGI("[Unlock] 发送指纹解锁屏幕命令");
+    MsgMatchResult match;
+    match.result = 1;
+    match.templateId = result.templateId;
+    match.score = result.score;
+    match.attempts = result.attempts;
+    match.matchMode = result.matchMode;
+    match.captureMs = result.captureMs;
+    match.extractMs = result.extractMs;
+    match.searchMs = result.searchMs;
+    match.totalMs = result.totalMs;
+    bluetoothManager.sendMessage(MSG_FINGERPRINT_SEARCH, (uint8_t*)&match, sizeof(match));
 
     // 5. 解锁完成后，允许休眠
     if (_sleepManager) _sleepManager->preventSleep(false);
 
-    Serial.println("[Unlock] 解锁序列完成");
+    LOGI("[Unlock] 解锁序列完成");
 }
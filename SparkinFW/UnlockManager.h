@@ -11,6 +11,7 @@
 #include "BleKeyboard.h"
 #include "Common.h"
 #include "SleepManager.h"
+#include "Fingerprint.h"
 
 class UnlockManager {
 public:
@@ -18,19 +19,34 @@ public:
     void begin(SleepManager* sleepManager);
     
     // 请求解锁，如果正在解锁中则返回false
-    bool requestUnlock();
+    bool requestUnlock(const FingerprintMatchResult& result);
     
     // 是否正在忙于解锁
     bool isBusy();
 
+    // 触摸后开始比对指纹，进入解锁流程
+    void beginMatch();
+    // 比对未通过，退出解锁流程
+    void endMatch();
+    // 从触摸比对到解锁消息发出的整个过程中返回true，用于决定是否需要通知解锁任务
+    bool isUnlockInProgress() const { return _state != UNLOCK_IDLE; }
+
 private:
+    enum UnlockState {
+        UNLOCK_IDLE = 0,
+        UNLOCK_MATCHING,  // 正在比对指纹
+        UNLOCK_PENDING,   // 比对成功，等待解锁任务处理
+        UNLOCK_RUNNING,   // 正在执行解锁序列
+    };
+
     static void taskFunction(void* param);
-    void executeUnlockSequence();
+    void setIdle();
+    void executeUnlockSequence(const FingerprintMatchResult& result);
 
     TaskHandle_t _taskHandle;
     QueueHandle_t _requestQueue;
     SleepManager* _sleepManager;
-    bool _isBusy;
+    volatile UnlockState _state;
 };
 
 #endif
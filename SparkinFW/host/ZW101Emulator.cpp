@@ -0,0 +1,649 @@
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+#include "ZW101Emulator.h"
+
+// 指令码，与 Fingerprint.h 中的定义一致
+static const uint8_t CMD_GET_IMAGE = 0x01;
+static const uint8_t CMD_GEN_CHAR = 0x02;
+static const uint8_t CMD_MATCH = 0x03;
+static const uint8_t CMD_SEARCH = 0x04;
+static const uint8_t CMD_REG_MODEL = 0x05;
+static const uint8_t CMD_STORE_CHAR = 0x06;
+static const uint8_t CMD_LOAD_CHAR = 0x07;
+static const uint8_t CMD_UP_CHAR = 0x08;
+static const uint8_t CMD_DOWN_CHAR = 0x09;
+static const uint8_t CMD_UP_IMAGE = 0x0A;
+static const uint8_t CMD_DELETE_CHAR = 0x0C;
+static const uint8_t CMD_CLEAR_LIB = 0x0D;
+static const uint8_t CMD_WRITE_REG = 0x0E;
+static const uint8_t CMD_READ_SYSPARA = 0x0F;
+static const uint8_t CMD_VALID_TEMPLATE_NUM = 0x1D;
+static const uint8_t CMD_READ_INDEX = 0x1F;
+static const uint8_t CMD_AUTO_IDENTIFY = 0x32;
+static const uint8_t CMD_SLEEP = 0x33;
+static const uint8_t CMD_LED_CM = 0x3C;
+static const uint8_t CMD_LED_AUTO_MANUAL = 0x60;
+
+static const uint8_t REG_BAUD_RATE = 4;
+static const uint8_t REG_PACKET_SIZE = 6;
+
+static const uint8_t CONFIRM_READ_TEMPLATE_FAIL = 0x0C; // 从指纹库读模板出错或模板无效
+static const uint8_t CONFIRM_UPLOAD_FAIL = 0x0D;        // 上传特征失败
+static const uint8_t CONFIRM_UPLOAD_IMAGE_FAIL = 0x0F;  // 不能上传图像
+
+static const uint8_t START_SIGNAL = 0x55;
+static const uint8_t AUTO_STAGE_CHECK = 0x00;
+static const uint8_t AUTO_STAGE_IMAGE = 0x01;
+static const uint8_t AUTO_STAGE_SEARCH = 0x05;
+static const uint32_t DEFAULT_LATENCY_US = 2000;
+
+ZW101Emulator::ZW101Emulator()
+{
+    _hostBaud = 57600;
+    _moduleBaud = 57600;
+    _txFreeUs = 0;
+    _hostTxFreeUs = 0;
+    _powered = false;
+    _sleeping = false;
+    _readyUs = 0;
+    _bootUs = 200000;
+    _packetCode = 2; // 出厂128字节
+    _matchScore = 120;
+    _finger = NO_FINGER;
+    _image = NO_FINGER;
+    _downloadBuffer = 0;
+
+    // 默认处理耗时，按模组手册的典型值估计，测试场景可以用 setLatency 覆盖
+    _latencyUs[CMD_GET_IMAGE] = 60000;
+    _latencyUs[CMD_GEN_CHAR] = 80000;
+    _latencyUs[CMD_MATCH] = 10000;
+    _latencyUs[CMD_SEARCH] = 30000;
+    _latencyUs[CMD_REG_MODEL] = 40000;
+    _latencyUs[CMD_STORE_CHAR] = 30000;
+    _latencyUs[CMD_LOAD_CHAR] = 10000;
+    _latencyUs[CMD_DELETE_CHAR] = 20000;
+    _latencyUs[CMD_CLEAR_LIB] = 100000;
+    _latencyUs[CMD_WRITE_REG] = 5000;
+}
+
+uint32_t ZW101Emulator::latency(uint8_t cmd) const
+{
+    auto it = _latencyUs.find(cmd);
+    return it != _latencyUs.end() ? it->second : DEFAULT_LATENCY_US;
+}
+
+uint32_t ZW101Emulator::commandCount(uint8_t cmd) const
+{
+    auto it = _commandCount.find(cmd);
+    return it != _commandCount.end() ? it->second : 0;
+}
+
+void ZW101Emulator::queueCaptureResults(std::initializer_list<uint8_t> codes)
+{
+    _captureScript.insert(_captureScript.end(), codes.begin(), codes.end());
+}
+
+void ZW101Emulator::queueFeatureResults(std::initializer_list<uint8_t> codes)
+{
+    _featureScript.insert(_featureScript.end(), codes.begin(), codes.end());
+}
+
+void ZW101Emulator::storeFinger(uint16_t id, uint16_t finger)
+{
+    if (id < LIBRARY_SIZE)
+        _library[id] = makeTemplate(finger);
+}
+
+// ---- FingerprintTransport ----
+
+void ZW101Emulator::begin(uint32_t baudRate)
+{
+    _hostBaud = baudRate;
+    hostSetEventSource(this);
+}
+
+void ZW101Emulator::setBaudRate(uint32_t baudRate)
+{
+    // 与 HardwareSerial 一样先等待已写入的数据发送完
+    uint64_t flushed = _hostTxFreeUs;
+    hostWaitUntil(flushed, [this, flushed]() { return hostNowUs() >= flushed; });
+    _hostBaud = baudRate;
+}
+
+size_t ZW101Emulator::write(const uint8_t *data, size_t len)
+{
+    uint64_t t = max(hostNowUs(), _hostTxFreeUs);
+    uint32_t byteTime = byteTimeUs(_hostBaud);
+    // 波特率不一致时模组收到的是乱码，这里直接丢弃
+    bool received = _powered && hostNowUs() >= _readyUs && _hostBaud == _moduleBaud;
+    for (size_t i = 0; i < len; i++)
+    {
+        t += byteTime;
+        if (received && _parser.feed(data[i]) == FingerprintFrameParser::FRAME_READY)
+        {
+            // 解析器的缓冲区在下一次 feed 时会被覆盖，先拷贝
+            const FingerprintResponse &frame = _parser.frame();
+            uint8_t pid = frame.pid;
+            std::vector<uint8_t> payload(frame.payload, frame.payload + frame.payloadLength);
+            schedule(t, [this, t, pid, payload]() { handleFrame(t, pid, payload); });
+        }
+    }
+    _hostTxFreeUs = t;
+    return len;
+}
+
+int ZW101Emulator::available()
+{
+    return _rx.size();
+}
+
+int ZW101Emulator::read()
+{
+    if (_rx.empty())
+        return -1;
+    uint8_t b = _rx.front();
+    _rx.pop_front();
+    return b;
+}
+
+void ZW101Emulator::onReceive(const std::function<void()> &callback)
+{
+    _onReceive = callback;
+}
+
+void ZW101Emulator::setPower(bool on)
+{
+    if (on == _powered)
+        return;
+    _powered = on;
+    _events.clear(); // 断电时丢弃正在处理的指令和正在发送的数据
+    reset();
+    if (on)
+    {
+        // 启动完成后以当前波特率发送启动信号
+        _readyUs = hostNowUs() + _bootUs;
+        schedule(_readyUs, [this]() {
+            sendRaw(_readyUs, &START_SIGNAL, 1);
+        });
+    }
+}
+
+// 上电或断电后易失的状态，指纹库和系统寄存器保存在模组 FLASH 中不受影响
+void ZW101Emulator::reset()
+{
+    _sleeping = false;
+    _parser.reset();
+    _image = NO_FINGER;
+    for (Template &buffer : _buffers)
+        buffer.clear();
+    _download.clear();
+    _downloadBuffer = 0;
+    _txFreeUs = hostNowUs();
+}
+
+// ---- HostEventSource ----
+
+uint64_t ZW101Emulator::nextEventUs()
+{
+    return _events.empty() ? UINT64_MAX : _events.begin()->first;
+}
+
+void ZW101Emulator::runEvents(uint64_t nowUs)
+{
+    // 事件可能再安排新的事件，每次只取最早的一个
+    while (!_events.empty() && _events.begin()->first <= nowUs)
+    {
+        std::function<void()> action = _events.begin()->second;
+        _events.erase(_events.begin());
+        action();
+    }
+}
+
+void ZW101Emulator::schedule(uint64_t atUs, const std::function<void()> &action)
+{
+    _events.insert(std::make_pair(atUs, action));
+}
+
+// ---- 模组发送 ----
+
+uint64_t ZW101Emulator::sendRaw(uint64_t atUs, const uint8_t *data, size_t len)
+{
+    uint64_t t = max(atUs, _txFreeUs);
+    uint32_t baudRate = _moduleBaud;
+    uint32_t byteTime = byteTimeUs(baudRate);
+    for (size_t i = 0; i < len; i++)
+    {
+        t += byteTime;
+        uint8_t b = data[i];
+        schedule(t, [this, b, baudRate]() {
+            if (_hostBaud != baudRate)
+                return; // 驱动端波特率不一致，收到的是乱码
+            _rx.push_back(b);
+            if (_onReceive)
+                _onReceive();
+        });
+    }
+    _txFreeUs = t;
+    return t;
+}
+
+uint64_t ZW101Emulator::sendFrame(uint64_t atUs, uint8_t pid, const uint8_t *payload, size_t len)
+{
+    uint8_t packet[FingerprintFrame::MAX_FRAME_LENGTH];
+    size_t packetLength = FingerprintFrame::encodeData(false, payload, len, packet);
+    // encodeData 只生成数据包，换成需要的包标识后重新计算校验和
+    packet[6] = pid;
+    uint16_t sum = FingerprintFrame::checksum(&packet[6], packetLength - 6 - FingerprintFrame::CHECKSUM_LENGTH);
+    packet[packetLength - 2] = FingerprintFrame::hi(sum);
+    packet[packetLength - 1] = FingerprintFrame::lo(sum);
+    return sendRaw(atUs, packet, packetLength);
+}
+
+uint64_t ZW101Emulator::sendAck(uint64_t atUs, const std::vector<uint8_t> &payload)
+{
+    return sendFrame(atUs, FingerprintFrame::PID_ACK, payload.data(), payload.size());
+}
+
+// ---- 指令处理 ----
+
+void ZW101Emulator::handleFrame(uint64_t atUs, uint8_t pid, const std::vector<uint8_t> &payload)
+{
+    if (pid == FingerprintFrame::PID_DATA || pid == FingerprintFrame::PID_DATA_END)
+    {
+        // 下载模板的数据包，没有应答
+        if (_downloadBuffer == 0)
+            return;
+        _download.insert(_download.end(), payload.begin(), payload.end());
+        if (pid == FingerprintFrame::PID_DATA_END)
+        {
+            _buffers[_downloadBuffer] = _download;
+            _download.clear();
+            _downloadBuffer = 0;
+        }
+        return;
+    }
+    if (pid != FingerprintFrame::PID_COMMAND || payload.empty())
+        return;
+
+    // 收到指令即唤醒
+    _sleeping = false;
+    uint8_t cmd = payload[0];
+    _commandCount[cmd]++;
+    handleCommand(atUs + latency(cmd), cmd, payload.data() + 1, payload.size() - 1);
+}
+
+void ZW101Emulator::handleCommand(uint64_t atUs, uint8_t cmd, const uint8_t *params, size_t len)
+{
+    auto param = [&](size_t i) -> uint8_t { return i < len ? params[i] : 0; };
+    auto validBuffer = [](uint8_t buffer) { return buffer >= 1 && buffer <= BUFFER_COUNT; };
+
+    switch (cmd)
+    {
+    case CMD_GET_IMAGE:
+        sendAck(atUs, {captureImage()});
+        break;
+
+    case CMD_GEN_CHAR:
+        sendAck(atUs, {validBuffer(param(0)) ? generateFeature(param(0)) : (uint8_t)CONFIRM_PACKET_ERROR});
+        break;
+
+    case CMD_MATCH:
+    {
+        bool matched = !_buffers[1].empty() && !_buffers[2].empty() && fingerOf(_buffers[1]) == fingerOf(_buffers[2]);
+        uint16_t score = matched ? _matchScore : 0;
+        sendAck(atUs, {matched ? (uint8_t)CONFIRM_OK : (uint8_t)CONFIRM_NOT_MATCH,
+                       FingerprintFrame::hi(score), FingerprintFrame::lo(score)});
+        break;
+    }
+
+    case CMD_SEARCH:
+    {
+        uint8_t buffer = param(0);
+        if (!validBuffer(buffer) || _buffers[buffer].empty())
+        {
+            sendAck(atUs, {CONFIRM_NO_VALID_IMAGE, 0, 0, 0, 0});
+            break;
+        }
+        int id = searchLibrary(_buffers[buffer], word(params + 1), word(params + 3));
+        if (id < 0)
+        {
+            sendAck(atUs, {CONFIRM_NOT_FOUND, 0, 0, 0, 0});
+            break;
+        }
+        sendAck(atUs, {CONFIRM_OK, FingerprintFrame::hi(id), FingerprintFrame::lo(id),
+                       FingerprintFrame::hi(_matchScore), FingerprintFrame::lo(_matchScore)});
+        break;
+    }
+
+    case CMD_REG_MODEL:
+    {
+        // 所有有效缓冲区来自同一个手指且至少两个时合并成功，模板放在缓冲区1
+        uint16_t finger = NO_FINGER;
+        int count = 0;
+        bool same = true;
+        for (uint8_t i = 1; i <= BUFFER_COUNT; i++)
+        {
+            if (_buffers[i].empty())
+                continue;
+            if (count++ == 0)
+                finger = fingerOf(_buffers[i]);
+            same &= fingerOf(_buffers[i]) == finger;
+        }
+        if (count < 2 || !same)
+        {
+            sendAck(atUs, {CONFIRM_MERGE_FAIL});
+            break;
+        }
+        _buffers[1] = makeTemplate(finger);
+        sendAck(atUs, {CONFIRM_OK});
+        break;
+    }
+
+    case CMD_STORE_CHAR:
+    {
+        uint8_t buffer = param(0);
+        uint16_t id = word(params + 1);
+        if (id >= LIBRARY_SIZE)
+            sendAck(atUs, {CONFIRM_BAD_ADDRESS});
+        else if (!validBuffer(buffer) || _buffers[buffer].empty())
+            sendAck(atUs, {CONFIRM_PACKET_ERROR});
+        else
+        {
+            _library[id] = _buffers[buffer];
+            sendAck(atUs, {CONFIRM_OK});
+        }
+        break;
+    }
+
+    case CMD_LOAD_CHAR:
+    {
+        uint8_t buffer = param(0);
+        uint16_t id = word(params + 1);
+        if (id >= LIBRARY_SIZE)
+            sendAck(atUs, {CONFIRM_BAD_ADDRESS});
+        else if (!validBuffer(buffer) || !_library.count(id))
+            sendAck(atUs, {CONFIRM_READ_TEMPLATE_FAIL});
+        else
+        {
+            _buffers[buffer] = _library[id];
+            sendAck(atUs, {CONFIRM_OK});
+        }
+        break;
+    }
+
+    case CMD_UP_CHAR:
+    {
+        uint8_t buffer = param(0);
+        if (!validBuffer(buffer) || _buffers[buffer].empty())
+        {
+            sendAck(atUs, {CONFIRM_UPLOAD_FAIL});
+            break;
+        }
+        // 应答之后按数据包长度连续发送
+        uint64_t t = sendAck(atUs, {CONFIRM_OK});
+        const Template &data = _buffers[buffer];
+        size_t packetLength = packetSize();
+        for (size_t offset = 0; offset < data.size(); offset += packetLength)
+        {
+            size_t n = min(packetLength, data.size() - offset);
+            bool last = offset + n >= data.size();
+            t = sendFrame(t, last ? FingerprintFrame::PID_DATA_END : FingerprintFrame::PID_DATA, &data[offset], n);
+        }
+        break;
+    }
+
+    case CMD_UP_IMAGE:
+    {
+        if (_image == NO_FINGER)
+        {
+            sendAck(atUs, {CONFIRM_UPLOAD_IMAGE_FAIL});
+            break;
+        }
+        uint64_t t = sendAck(atUs, {CONFIRM_OK});
+        std::vector<uint8_t> image = makeImage(_image);
+        size_t packetLength = packetSize();
+        for (size_t offset = 0; offset < image.size(); offset += packetLength)
+        {
+            size_t n = min(packetLength, image.size() - offset);
+            bool last = offset + n >= image.size();
+            t = sendFrame(t, last ? FingerprintFrame::PID_DATA_END : FingerprintFrame::PID_DATA, &image[offset], n);
+        }
+        break;
+    }
+
+    case CMD_DOWN_CHAR:
+        if (!validBuffer(param(0)))
+        {
+            sendAck(atUs, {CONFIRM_PACKET_ERROR});
+            break;
+        }
+        _download.clear();
+        _downloadBuffer = param(0);
+        sendAck(atUs, {CONFIRM_OK});
+        break;
+
+    case CMD_DELETE_CHAR:
+    {
+        uint16_t id = word(params);
+        uint16_t count = word(params + 2);
+        if (id >= LIBRARY_SIZE || count == 0 || id + count > LIBRARY_SIZE)
+        {
+            sendAck(atUs, {CONFIRM_BAD_ADDRESS});
+            break;
+        }
+        for (uint16_t i = id; i < id + count; i++)
+            _library.erase(i);
+        sendAck(atUs, {CONFIRM_OK});
+        break;
+    }
+
+    case CMD_CLEAR_LIB:
+        _library.clear();
+        sendAck(atUs, {CONFIRM_OK});
+        break;
+
+    case CMD_WRITE_REG:
+    {
+        uint8_t reg = param(0);
+        uint8_t value = param(1);
+        if (reg == REG_BAUD_RATE)
+        {
+            if (value < 1 || value > 12)
+            {
+                sendAck(atUs, {CONFIRM_PACKET_ERROR});
+                break;
+            }
+            // 应答以旧波特率发出，发送完成后切换
+            uint64_t t = sendAck(atUs, {CONFIRM_OK});
+            schedule(t, [this, value]() { _moduleBaud = (uint32_t)value * 9600; });
+        }
+        else if (reg == REG_PACKET_SIZE)
+        {
+            if (value > 3)
+            {
+                sendAck(atUs, {CONFIRM_PACKET_ERROR});
+                break;
+            }
+            _packetCode = value;
+            sendAck(atUs, {CONFIRM_OK});
+        }
+        else
+        {
+            sendAck(atUs, {CONFIRM_OK}); // 其他寄存器（安全等级等）不影响模拟
+        }
+        break;
+    }
+
+    case CMD_READ_SYSPARA:
+    {
+        uint16_t baudCode = _moduleBaud / 9600;
+        sendAck(atUs, {CONFIRM_OK,
+                       0x00, 0x04,                                                    // 注册次数
+                       FingerprintFrame::hi(TEMPLATE_SIZE), FingerprintFrame::lo(TEMPLATE_SIZE),
+                       FingerprintFrame::hi(LIBRARY_SIZE), FingerprintFrame::lo(LIBRARY_SIZE),
+                       0x00, 0x03,                                                    // 安全等级
+                       0xFF, 0xFF, 0xFF, 0xFF,                                        // 设备地址
+                       0x00, _packetCode,
+                       FingerprintFrame::hi(baudCode), FingerprintFrame::lo(baudCode)});
+        break;
+    }
+
+    case CMD_VALID_TEMPLATE_NUM:
+    {
+        uint16_t count = _library.size();
+        sendAck(atUs, {CONFIRM_OK, FingerprintFrame::hi(count), FingerprintFrame::lo(count)});
+        break;
+    }
+
+    case CMD_READ_INDEX:
+    {
+        // 每页32字节，对应256个模板
+        std::vector<uint8_t> reply(33, 0);
+        uint16_t base = param(0) * 256;
+        for (const auto &entry : _library)
+        {
+            if (entry.first >= base && entry.first < base + 256)
+                reply[1 + (entry.first - base) / 8] |= 1 << ((entry.first - base) % 8);
+        }
+        sendAck(atUs, reply);
+        break;
+    }
+
+    case CMD_AUTO_IDENTIFY:
+        autoIdentify(atUs);
+        break;
+
+    case CMD_SLEEP:
+    {
+        uint64_t t = sendAck(atUs, {CONFIRM_OK});
+        schedule(t, [this]() { _sleeping = true; });
+        break;
+    }
+
+    case CMD_LED_CM:
+    case CMD_LED_AUTO_MANUAL:
+        _lastLed.assign(params - 1, params + len);
+        sendAck(atUs, {CONFIRM_OK});
+        break;
+
+    default:
+        sendAck(atUs, {CONFIRM_PACKET_ERROR});
+        break;
+    }
+}
+
+// 自动验证：指令检测、采图、搜索三个阶段依次应答，任一阶段失败即结束
+void ZW101Emulator::autoIdentify(uint64_t atUs)
+{
+    uint64_t t = sendAck(atUs, {CONFIRM_OK, AUTO_STAGE_CHECK});
+
+    t += latency(CMD_GET_IMAGE);
+    uint8_t code = captureImage();
+    if (code == CONFIRM_OK)
+    {
+        t += latency(CMD_GEN_CHAR);
+        code = generateFeature(1);
+    }
+    t = sendAck(t, {code, AUTO_STAGE_IMAGE});
+    if (code != CONFIRM_OK)
+        return;
+
+    t += latency(CMD_SEARCH);
+    int id = searchLibrary(_buffers[1], 0, LIBRARY_SIZE);
+    if (id < 0)
+    {
+        sendAck(t, {CONFIRM_NOT_FOUND, AUTO_STAGE_SEARCH, 0, 0, 0, 0});
+        return;
+    }
+    sendAck(t, {CONFIRM_OK, AUTO_STAGE_SEARCH, FingerprintFrame::hi(id), FingerprintFrame::lo(id),
+                FingerprintFrame::hi(_matchScore), FingerprintFrame::lo(_matchScore)});
+}
+
+// 采图：优先使用预设的确认码，否则按手指是否在传感器上
+uint8_t ZW101Emulator::captureImage()
+{
+    uint8_t code;
+    if (!_captureScript.empty())
+    {
+        code = _captureScript.front();
+        _captureScript.pop_front();
+    }
+    else
+    {
+        code = _finger != NO_FINGER ? CONFIRM_OK : CONFIRM_NO_FINGER;
+    }
+    _image = code == CONFIRM_OK ? _finger : NO_FINGER;
+    return code;
+}
+
+uint8_t ZW101Emulator::generateFeature(uint8_t buffer)
+{
+    if (!_featureScript.empty())
+    {
+        uint8_t code = _featureScript.front();
+        _featureScript.pop_front();
+        if (code != CONFIRM_OK)
+            return code;
+    }
+    if (_image == NO_FINGER)
+        return CONFIRM_NO_VALID_IMAGE;
+    _buffers[buffer] = makeTemplate(_image);
+    return CONFIRM_OK;
+}
+
+int ZW101Emulator::searchLibrary(const Template &feature, uint16_t start, uint16_t count) const
+{
+    uint16_t finger = fingerOf(feature);
+    for (const auto &entry : _library)
+    {
+        if (entry.first >= start && entry.first < start + count && fingerOf(entry.second) == finger)
+            return entry.first;
+    }
+    return -1;
+}
+
+// 模板前两个字节是手指编号，其余内容由手指编号生成，便于检查上传下载是否完整
+ZW101Emulator::Template ZW101Emulator::makeTemplate(uint16_t finger)
+{
+    Template data(TEMPLATE_SIZE);
+    data[0] = FingerprintFrame::hi(finger);
+    data[1] = FingerprintFrame::lo(finger);
+    uint32_t seed = finger * 2654435761u;
+    for (size_t i = 2; i < data.size(); i++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        data[i] = seed >> 16;
+    }
+    return data;
+}
+
+std::vector<uint8_t> ZW101Emulator::makeImage(uint16_t finger)
+{
+    std::vector<uint8_t> image(IMAGE_SIZE, 0xFF);
+    int cx = IMAGE_WIDTH / 2, cy = IMAGE_HEIGHT / 2;
+    int rx = IMAGE_WIDTH * 3 / 8, ry = IMAGE_HEIGHT * 7 / 16;
+    int period = 6 + finger % 5;
+    for (int y = 0; y < IMAGE_HEIGHT; y++)
+    {
+        for (int x = 0; x < IMAGE_WIDTH; x++)
+        {
+            int dx = x - cx, dy = y - cy;
+            if (dx * dx * ry * ry + dy * dy * rx * rx > rx * rx * ry * ry)
+                continue;
+            // 以手指中心为圆心的同心纹线
+            int ring = (dx * dx + dy * dy * 2) / (period * 16) + finger;
+            uint8_t pixel = ring % 2 ? 0x2 : 0xC;
+            uint8_t &byte = image[(y * IMAGE_WIDTH + x) / 2];
+            byte = x % 2 ? (byte & 0xF0) | pixel : (byte & 0x0F) | (pixel << 4);
+        }
+    }
+    return image;
+}
+
+uint16_t ZW101Emulator::fingerOf(const Template &data)
+{
+    return data.size() >= 2 ? word(data.data()) : NO_FINGER;
+}
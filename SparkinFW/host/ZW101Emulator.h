@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+#ifndef ZW101_EMULATOR_H
+#define ZW101_EMULATOR_H
+
+#include <Arduino.h>
+#include <deque>
+#include <map>
+#include <vector>
+#include "FingerprintTransport.h"
+#include "FingerprintFrame.h"
+
+// ZW101 指纹模组模拟器，在主机上代替 FingerprintUart 与驱动对接
+// 模拟指纹库和索引表、采图成功/失败、特征缓冲区、比对和搜索、图像上传、呼吸灯、系统寄存器、
+// 上电启动信号 0x55、休眠，以及按指令配置的处理耗时和按波特率计算的串口传输时间
+// 手指用一个整数表示，同一个手指生成的特征和模板可以互相匹配
+class ZW101Emulator : public FingerprintTransport, public HostEventSource
+{
+public:
+    static const uint16_t LIBRARY_SIZE = 50;     // 指纹库容量
+    static const uint16_t TEMPLATE_SIZE = 1536;  // 模板长度（字节）
+    static const uint8_t BUFFER_COUNT = 6;       // 特征缓冲区 1~6
+    static const uint16_t NO_FINGER = 0xFFFF;
+    static const uint16_t IMAGE_WIDTH = 192;     // 上传图像的宽高，每像素4位，一个字节两个像素
+    static const uint16_t IMAGE_HEIGHT = 192;
+    static const uint32_t IMAGE_SIZE = IMAGE_WIDTH * IMAGE_HEIGHT / 2;
+
+    ZW101Emulator();
+
+    // FingerprintTransport
+    void begin(uint32_t baudRate) override;
+    void setBaudRate(uint32_t baudRate) override;
+    size_t write(const uint8_t *data, size_t len) override;
+    int available() override;
+    int read() override;
+    void onReceive(const std::function<void()> &callback) override;
+    void setPower(bool on) override;
+    bool isTouched() override { return _finger != NO_FINGER; }
+
+    // HostEventSource
+    uint64_t nextEventUs() override;
+    void runEvents(uint64_t nowUs) override;
+
+    // 手指
+    void placeFinger(uint16_t finger) { _finger = finger; }
+    void liftFinger() { _finger = NO_FINGER; }
+    // 之后的采图（GET_IMAGE 和自动验证的采图阶段）依次返回这些确认码，用完后按手指状态返回
+    void queueCaptureResults(std::initializer_list<uint8_t> codes);
+    // 之后的生成特征依次返回这些确认码
+    void queueFeatureResults(std::initializer_list<uint8_t> codes);
+
+    // 指令处理耗时（微秒），从收到指令最后一个字节到发出应答第一个字节
+    void setLatency(uint8_t cmd, uint32_t us) { _latencyUs[cmd] = us; }
+    uint32_t latency(uint8_t cmd) const;
+    void setBootTime(uint32_t us) { _bootUs = us; }   // 上电到发出启动信号
+    void setMatchScore(uint16_t score) { _matchScore = score; }
+    void setModuleBaudRate(uint32_t baudRate) { _moduleBaud = baudRate; } // 模组当前（掉电保存的）波特率
+
+    // 直接操作指纹库，用于准备测试场景
+    void storeFinger(uint16_t id, uint16_t finger);
+    bool hasTemplate(uint16_t id) const { return _library.count(id) > 0; }
+    uint16_t templateCount() const { return _library.size(); }
+
+    // 手指对应的上传图像：手指区域内是按手指编号生成的纹线，区域外是白色背景
+    static std::vector<uint8_t> makeImage(uint16_t finger);
+
+    // 状态
+    uint32_t moduleBaudRate() const { return _moduleBaud; }
+    uint16_t packetSize() const { return 32 << _packetCode; }
+    bool isSleeping() const { return _sleeping; }
+    const std::vector<uint8_t> &lastLedCommand() const { return _lastLed; }
+    uint32_t commandCount(uint8_t cmd) const;
+
+private:
+    typedef std::vector<uint8_t> Template;
+
+    void schedule(uint64_t atUs, const std::function<void()> &action);
+    uint32_t byteTimeUs(uint32_t baudRate) const { return 10000000 / baudRate; } // 8N1 每字节10位
+    // 从 atUs 起按模组波特率逐字节发送，返回最后一个字节到达的时间
+    uint64_t sendRaw(uint64_t atUs, const uint8_t *data, size_t len);
+    uint64_t sendFrame(uint64_t atUs, uint8_t pid, const uint8_t *payload, size_t len);
+    uint64_t sendAck(uint64_t atUs, const std::vector<uint8_t> &payload);
+    void handleFrame(uint64_t atUs, uint8_t pid, const std::vector<uint8_t> &payload);
+    void handleCommand(uint64_t atUs, uint8_t cmd, const uint8_t *params, size_t len);
+    void autoIdentify(uint64_t atUs);
+    void reset();
+    uint8_t captureImage();
+    uint8_t generateFeature(uint8_t buffer);
+    int searchLibrary(const Template &feature, uint16_t start, uint16_t count) const;
+    static Template makeTemplate(uint16_t finger);
+    static uint16_t fingerOf(const Template &data);
+    static uint16_t word(const uint8_t *p) { return (uint16_t)(p[0] << 8) | p[1]; }
+
+    // 串口
+    uint32_t _hostBaud;         // 驱动端串口波特率
+    uint32_t _moduleBaud;       // 模组波特率，两者不一致时双方都收不到正确数据
+    uint64_t _txFreeUs;         // 模组串口发送空闲的时间
+    uint64_t _hostTxFreeUs;     // 驱动端串口发送空闲的时间
+    std::deque<uint8_t> _rx;    // 驱动端已收到的数据
+    std::function<void()> _onReceive;
+    FingerprintFrameParser _parser; // 解析驱动发来的指令包和数据包
+    std::multimap<uint64_t, std::function<void()>> _events;
+
+    // 模组状态
+    bool _powered;
+    bool _sleeping;
+    uint64_t _readyUs;          // 上电后开始接收指令的时间
+    uint32_t _bootUs;
+    uint8_t _packetCode;        // 数据包长度寄存器
+    std::map<uint8_t, uint32_t> _latencyUs;
+    std::map<uint8_t, uint32_t> _commandCount;
+    uint16_t _matchScore;
+
+    // 指纹
+    uint16_t _finger;           // 传感器上的手指
+    uint16_t _image;            // 图像缓冲区中的手指
+    Template _buffers[BUFFER_COUNT + 1];
+    std::map<uint16_t, Template> _library;
+    std::deque<uint8_t> _captureScript;
+    std::deque<uint8_t> _featureScript;
+    Template _download;         // 正在下载的模板
+    uint8_t _downloadBuffer;    // 下载目标缓冲区，0表示没有在下载
+    std::vector<uint8_t> _lastLed;
+};
+
+#endif // ZW101_EMULATOR_H
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+// 指纹驱动主机测试：Fingerprint 通过 ZW101Emulator 运行启动、注册、比对、模板备份恢复等场景，
+// 打印每个场景的结果和虚拟时钟耗时，最后打印指令耗时追踪统计
+// 用法：./fingerprint_bench [-v]，-v 同时打印驱动的串口日志
+
+#include <Arduino.h>
+#include <vector>
+#include "Fingerprint.h"
+#include "ZW101Emulator.h"
+
+static ZW101Emulator emulator;
+static Fingerprint fingerprint(emulator);
+static int failures = 0;
+
+// 记录一个场景的结果，expected 为预期的返回值
+static void report(const char *name, bool result, bool expected, uint32_t startMs, const char *detail = "")
+{
+    uint32_t elapsed = millis() - startMs;
+    bool pass = result == expected;
+    if (!pass)
+        failures++;
+    ::printf("%-36s %-4s %6u ms  %s\n", name, pass ? "ok" : "FAIL", elapsed, detail);
+}
+
+static void matchScenario(const char *name, uint16_t finger, bool expected, std::initializer_list<uint8_t> captureCodes)
+{
+    char detail[64];
+    emulator.queueCaptureResults(captureCodes);
+    emulator.placeFinger(finger);
+    uint32_t start = millis();
+    FingerprintMatchResult result;
+    bool matched = fingerprint.matchFingerprint(result);
+    emulator.liftFinger();
+    snprintf(detail, sizeof(detail), "id %u, score %u, attempts %u", result.templateId, result.score, result.attempts);
+    report(name, matched, expected, start, detail);
+}
+
+int main(int argc, char **argv)
+{
+    bool verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+    Serial.setEnabled(verbose);
+    ::printf("%-36s %-4s %9s  %s\n", "scenario", "", "virtual", "detail");
+
+    // 启动：上电、启动信号、协商波特率和数据包长度、读索引表
+    uint32_t start = millis();
+    fingerprint.begin();
+    fingerprint.setPower(true);
+    report("power on + start signal", fingerprint.waitStartSignal(), true, start);
+    start = millis();
+    report("negotiate link", fingerprint.negotiateLink(), true, start);
+    char detail[64];
+    snprintf(detail, sizeof(detail), "%u baud, packet %u", emulator.moduleBaudRate(), emulator.packetSize());
+    report("link parameters", emulator.moduleBaudRate() == Fingerprint::LINK_BAUD_FAST &&
+                                  emulator.packetSize() == Fingerprint::LINK_PACKET_SIZE_MAX,
+           true, millis(), detail);
+    start = millis();
+    report("read info + index table", fingerprint.readInfo() && fingerprint.loadIndexTable(), true, start);
+
+    // 注册：每个手指采图三次后合并，再采一次与模板比对，得分足够时存储（EnrollManager 的提前结束流程）
+    const uint16_t fingers[] = {101, 102, 103};
+    for (uint16_t id = 0; id < 3; id++)
+    {
+        start = millis();
+        emulator.placeFinger(fingers[id]);
+        bool ok = true;
+        for (uint8_t buffer = 1; buffer <= 3 && ok; buffer++)
+            ok = fingerprint.captureFeature(buffer);
+        uint16_t score = 0;
+        ok = ok && fingerprint.mergeFeatures() && fingerprint.captureFeature(2) && fingerprint.matchFeatures(score) &&
+             fingerprint.storeTemplate(id);
+        emulator.liftFinger();
+        snprintf(detail, sizeof(detail), "template %u, verify score %u", id, score);
+        report("enroll", ok && emulator.hasTemplate(id), true, start, detail);
+    }
+
+    // 提前合并的模板与另一个手指的特征比对：不匹配，得分为0
+    {
+        start = millis();
+        emulator.placeFinger(fingers[0]);
+        bool ok = fingerprint.captureFeature(1) && fingerprint.captureFeature(2) && fingerprint.captureFeature(3) &&
+                  fingerprint.mergeFeatures();
+        emulator.liftFinger();
+        emulator.placeFinger(fingers[1]);
+        uint16_t score = 0;
+        ok = ok && fingerprint.captureFeature(2) && !fingerprint.matchFeatures(score) && score == 0;
+        emulator.liftFinger();
+        report("enroll verify mismatch", ok, true, start);
+    }
+    report("template count", fingerprint.readValidTempleteNum() == 3, true, millis(), "from index cache");
+
+    // 比对：两种方式分别测试正常、先无手指、先图像太湿、未注册的手指
+    const uint8_t modes[] = {Fingerprint::MATCH_MODE_SEARCH, Fingerprint::MATCH_MODE_AUTO_IDENTIFY};
+    for (uint8_t mode : modes)
+    {
+        fingerprint.setMatchMode(mode);
+        bool autoMode = mode == Fingerprint::MATCH_MODE_AUTO_IDENTIFY;
+        matchScenario(autoMode ? "auto identify: clean" : "search: clean", 102, true, {});
+        matchScenario(autoMode ? "auto identify: no finger x2 first" : "search: no finger x2 first", 102, true,
+                      {CONFIRM_NO_FINGER, CONFIRM_NO_FINGER});
+        matchScenario(autoMode ? "auto identify: wet image first" : "search: wet image first", 103, true,
+                      {CONFIRM_IMAGE_WET});
+        matchScenario(autoMode ? "auto identify: unknown finger" : "search: unknown finger", 999, false, {});
+    }
+    FingerprintOutcomeCounts counts;
+    fingerprint.getOutcomeCounts(counts);
+    snprintf(detail, sizeof(detail), "ok %u, no finger %u, poor %u, no match %u",
+             counts.ok, counts.noFinger, counts.poorImage, counts.noMatch);
+    report("outcome counts", counts.ok == 8 && counts.noFinger == 4 && counts.poorImage == 2 && counts.noMatch == 2,
+           true, millis(), detail);
+
+    // 模板备份恢复：上传模板0，下载到模板10，再用同一个手指搜索
+    start = millis();
+    std::vector<uint8_t> backup;
+    bool uploaded = fingerprint.uploadTemplate(0, [&](const uint8_t *data, uint16_t length, bool) {
+        backup.insert(backup.end(), data, data + length);
+        return true;
+    });
+    snprintf(detail, sizeof(detail), "%u bytes", (unsigned)backup.size());
+    report("upload template", uploaded && backup.size() == ZW101Emulator::TEMPLATE_SIZE, true, start, detail);
+    start = millis();
+    report("download template", fingerprint.downloadTemplate(10, backup.data(), backup.size()) &&
+                                    emulator.hasTemplate(10), true, start);
+    start = millis();
+    report("delete template", fingerprint.deleteFingerprint(0) && !emulator.hasTemplate(0), true, start);
+    fingerprint.setMatchMode(Fingerprint::MATCH_MODE_SEARCH);
+    matchScenario("search: restored template", 101, true, {});
+
+    // 诊断图像上传：逐包收到的数据拼接后与模拟器生成的图像一致；没有手指时等待超时
+    emulator.placeFinger(102);
+    start = millis();
+    std::vector<uint8_t> image;
+    FingerprintImageResult imageResult;
+    bool imaged = fingerprint.uploadImage(1000, imageResult, [&](const uint8_t *data, uint16_t length, bool) {
+        image.insert(image.end(), data, data + length);
+        return true;
+    });
+    emulator.liftFinger();
+    snprintf(detail, sizeof(detail), "%u bytes, capture %u ms, upload %u ms", (unsigned)image.size(),
+             imageResult.captureMs, imageResult.uploadMs);
+    report("upload image", imaged && image == ZW101Emulator::makeImage(102), true, start, detail);
+    start = millis();
+    imaged = fingerprint.uploadImage(200, imageResult, [](const uint8_t *, uint16_t, bool) { return true; });
+    snprintf(detail, sizeof(detail), "capture code %02X", imageResult.captureCode);
+    report("upload image: no finger", imaged || imageResult.captureCode != CONFIRM_NO_FINGER, false, start, detail);
+
+    // 休眠和恢复
+    start = millis();
+    report("sleep", fingerprint.sleepFingerprint() && emulator.isSleeping(), true, start);
+    start = millis();
+    report("resume from sleep", fingerprint.resumeFromSleep(), true, start);
+
+    // 断电后重新上电，模组保持协商后的波特率
+    fingerprint.setPower(false);
+    start = millis();
+    fingerprint.setPower(true);
+    report("power cycle + start signal", fingerprint.waitStartSignal(), true, start);
+    start = millis();
+    report("renegotiate link", fingerprint.negotiateLink(), true, start);
+
+    // 读参数指令记录够次数后，超时按实测最大耗时设定：比手册值短，但不短于实测最大耗时
+    start = millis();
+    for (uint32_t i = 0; i < Fingerprint::TIMEOUT_MIN_SAMPLES; i++)
+        fingerprint.resumeFromSleep();
+    FingerprintTraceHistogram readStats = {};
+    fingerprint.trace().histogramOf(0x0F, readStats);
+    uint32_t readTimeout = fingerprint.commandTimeout(0x0F);
+    snprintf(detail, sizeof(detail), "max %u ms, timeout %u ms", readStats.maxMs, readTimeout);
+    report("timeout from measured latency", readTimeout < 200 && readTimeout > readStats.maxMs, true, start, detail);
+
+    // 事务结束时最后一条指令就计入统计，不等下一条指令发送
+    start = millis();
+    fingerprint.sleepFingerprint();
+    FingerprintTraceRecord records[FingerprintTrace::RING_SIZE];
+    int recordCount = fingerprint.trace().records(records, FingerprintTrace::RING_SIZE);
+    report("trace commits last command", recordCount > 0 && records[recordCount - 1].cmd == 0x33, true, start);
+
+    ::printf("\n%d failure(s), virtual time %u ms\n\n", failures, millis());
+
+    Serial.setEnabled(true);
+    fingerprint.trace().dump();
+    return failures == 0 ? 0 : 1;
+}
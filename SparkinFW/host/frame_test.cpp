@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+// 指纹包编解码主机测试：编码结果与原 sendCmdNN 函数生成的包逐字节比对，
+// 并测试增量解析器对分段输入、前导垃圾字节和校验错误的处理
+// 用法：./frame_test，有失败项时返回非0
+
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+#include "FingerprintFrame.h"
+
+static int failures = 0;
+
+static void report(const char *name, bool pass, const char *detail = "")
+{
+    if (!pass)
+        failures++;
+    ::printf("%-36s %-4s %s\n", name, pass ? "ok" : "FAIL", detail);
+}
+
+template <size_t N>
+static void expectFrame(const char *name, const FingerprintCommand<N> &frame, std::initializer_list<uint8_t> golden)
+{
+    report(name, golden.size() == N && memcmp(frame.bytes, golden.begin(), N) == 0);
+}
+
+static void expectBytes(const char *name, const uint8_t *bytes, size_t len, std::initializer_list<uint8_t> golden)
+{
+    report(name, golden.size() == len && memcmp(bytes, golden.begin(), len) == 0);
+}
+
+// 逐字节喂入解析器，返回收到的完整包（拷贝内容），与 Fingerprint::receiveFrame 一样先处理重新扫描剩下的字节
+struct ParsedFrame
+{
+    uint8_t pid;
+    std::vector<uint8_t> payload;
+};
+
+static std::vector<ParsedFrame> feedAll(FingerprintFrameParser &parser, const std::vector<uint8_t> &bytes)
+{
+    std::vector<ParsedFrame> frames;
+    auto collect = [&]() {
+        const FingerprintResponse &frame = parser.frame();
+        frames.push_back({frame.pid, std::vector<uint8_t>(frame.payload, frame.payload + frame.payloadLength)});
+    };
+    for (uint8_t b : bytes)
+    {
+        if (parser.feed(b) == FingerprintFrameParser::FRAME_READY)
+            collect();
+        while (parser.hasPending())
+        {
+            if (parser.poll() == FingerprintFrameParser::FRAME_READY)
+                collect();
+        }
+    }
+    return frames;
+}
+
+static std::vector<uint8_t> concat(std::initializer_list<std::vector<uint8_t>> parts)
+{
+    std::vector<uint8_t> out;
+    for (const auto &part : parts)
+        out.insert(out.end(), part.begin(), part.end());
+    return out;
+}
+
+// 原 sendCmdNN 函数生成的指令包（包长度和校验和按原实现计算）
+static void encoderTests()
+{
+    // sendCmd12(CMD_GET_IMAGE)
+    expectFrame("encode GET_IMAGE", FingerprintFrame::encode(0x01),
+                {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x03, 0x01, 0x00, 0x05});
+    // sendCmd13(CMD_GEN_CHAR, 1) / sendCmd13(CMD_GEN_CHAR, 2)
+    expectFrame("encode GEN_CHAR 1", FingerprintFrame::encode(0x02, 1),
+                {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x04, 0x02, 0x01, 0x00, 0x08});
+    expectFrame("encode GEN_CHAR 2", FingerprintFrame::encode(0x02, 2),
+                {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x04, 0x02, 0x02, 0x00, 0x09});
+    // sendCmd17(CMD_SEARCH, 1, 1, 1)
+    expectFrame("encode SEARCH 1/1/1", FingerprintFrame::encode(0x04, 1, 0x00, 0x01, 0x00, 0x01),
+                {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x08, 0x04, 0x01, 0x00, 0x01, 0x00, 0x01, 0x00, 0x10});
+    // sendCmd17(CMD_SEARCH, 1, 0, 300)，用 hi()/lo() 拆分16位参数
+    expectFrame("encode SEARCH 1/0/300",
+                FingerprintFrame::encode(0x04, 1, FingerprintFrame::hi(0), FingerprintFrame::lo(0),
+                                         FingerprintFrame::hi(300), FingerprintFrame::lo(300)),
+                {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x08, 0x04, 0x01, 0x00, 0x00, 0x01, 0x2C, 0x00, 0x3B});
+    // sendCmd13(CMD_READ_INDEX, 0)
+    expectFrame("encode READ_INDEX", FingerprintFrame::encode(0x1F, 0),
+                {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x04, 0x1F, 0x00, 0x00, 0x24});
+    // sendCmd17(CMD_AUTO_IDENTIFY, 0, 0xFFFF, 0)
+    expectFrame("encode AUTO_IDENTIFY", FingerprintFrame::encode(0x32, 0, 0xFF, 0xFF, 0x00, 0x00),
+                {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x08, 0x32, 0x00, 0xFF, 0xFF, 0x00, 0x00, 0x02, 0x39});
+    // sendCmd15(CMD_STORE_CHAR, 1, 7)
+    expectFrame("encode STORE_CHAR", FingerprintFrame::encode(0x06, 1, 0x00, 0x07),
+                {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x06, 0x06, 0x01, 0x00, 0x07, 0x00, 0x15});
+    // sendCmd16(CMD_DELETE_CHAR, 7, 1)
+    expectFrame("encode DELETE_CHAR", FingerprintFrame::encode(0x0C, 0x00, 0x07, 0x00, 0x01),
+                {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x07, 0x0C, 0x00, 0x07, 0x00, 0x01, 0x00, 0x1C});
+    // sendCmd16(CMD_LED_CM, LED_CODE_BREATH, LED_RED_ON, LED_RED_ON, 0)
+    expectFrame("encode LED_CM", FingerprintFrame::encode(0x3C, 0x01, 0x04, 0x04, 0x00),
+                {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x07, 0x3C, 0x01, 0x04, 0x04, 0x00, 0x00, 0x4D});
+    // 写系统寄存器没有对应的 sendCmdNN，按同样的包格式：寄存器号 + 值
+    expectFrame("encode WRITE_REG baud", FingerprintFrame::encode(0x0E, 4, 12),
+                {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x05, 0x0E, 0x04, 0x0C, 0x00, 0x24});
+    expectFrame("encode WRITE_REG packet", FingerprintFrame::encode(0x0E, 6, 3),
+                {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x05, 0x0E, 0x06, 0x03, 0x00, 0x1D});
+
+    // 编码结果在编译期确定
+    static_assert(FingerprintFrame::encode(0x01).bytes[11] == 0x05, "GET_IMAGE checksum");
+    static_assert(FingerprintFrame::encode(0x32, 0, 0xFF, 0xFF, 0x00, 0x00).bytes[15] == 0x02, "AUTO_IDENTIFY checksum");
+
+    // 数据包：包标识 0x02 表示后续还有数据包，0x08 表示最后一个
+    const uint8_t data[] = {0x11, 0x22, 0x33, 0x44};
+    uint8_t packet[FingerprintFrame::MAX_FRAME_LENGTH];
+    size_t len = FingerprintFrame::encodeData(false, data, sizeof(data), packet);
+    expectBytes("encode DATA", packet, len,
+                {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x02, 0x00, 0x06, 0x11, 0x22, 0x33, 0x44, 0x00, 0xB2});
+    len = FingerprintFrame::encodeData(true, data, sizeof(data), packet);
+    expectBytes("encode DATA_END", packet, len,
+                {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x08, 0x00, 0x06, 0x11, 0x22, 0x33, 0x44, 0x00, 0xB8});
+
+    // 最大数据包：256字节内容，校验和进位到高字节
+    uint8_t full[FingerprintFrame::MAX_PAYLOAD_LENGTH];
+    memset(full, 0xFF, sizeof(full));
+    len = FingerprintFrame::encodeData(true, full, sizeof(full), packet);
+    uint16_t sum = 0x08 + 0x01 + 0x02 + 0xFF * 256;
+    report("encode DATA_END 256 bytes", len == FingerprintFrame::MAX_FRAME_LENGTH && packet[7] == 0x01 && packet[8] == 0x02 &&
+                                             packet[len - 2] == (sum >> 8) && packet[len - 1] == (sum & 0xFF));
+}
+
+// 模组应答包：确认码 + 页码 + 得分
+static const std::vector<uint8_t> ACK_OK = {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x07, 0x00, 0x03, 0x00, 0x00, 0x0A};
+static const std::vector<uint8_t> ACK_SEARCH = {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x07, 0x00, 0x07,
+                                                0x00, 0x00, 0x05, 0x00, 0x64, 0x00, 0x77};
+
+static bool isSearchAck(const ParsedFrame &frame)
+{
+    return frame.pid == FingerprintFrame::PID_ACK && frame.payload == std::vector<uint8_t>({0x00, 0x00, 0x05, 0x00, 0x64});
+}
+
+static void parserTests()
+{
+    char detail[64];
+
+    // 解码整包
+    {
+        FingerprintResponse response;
+        bool pass = FingerprintFrame::decode(ACK_SEARCH.data(), ACK_SEARCH.size(), response) == FingerprintFrame::DECODE_OK &&
+                    response.confirm() == 0x00 && response.word(1) == 5 && response.word(3) == 100;
+        report("decode search ack", pass);
+        pass = FingerprintFrame::decode(ACK_SEARCH.data(), ACK_SEARCH.size() - 1, response) == FingerprintFrame::DECODE_INCOMPLETE;
+        report("decode incomplete", pass);
+    }
+
+    // 分段输入：每次只到达几个字节，包在最后一个字节时完成
+    {
+        FingerprintFrameParser parser;
+        std::vector<ParsedFrame> frames;
+        size_t readyAt = 0;
+        for (size_t i = 0; i < ACK_SEARCH.size(); i += 3)
+        {
+            std::vector<uint8_t> chunk(ACK_SEARCH.begin() + i, ACK_SEARCH.begin() + std::min(i + 3, ACK_SEARCH.size()));
+            std::vector<ParsedFrame> got = feedAll(parser, chunk);
+            if (!got.empty())
+                readyAt = std::min(i + 3, ACK_SEARCH.size());
+            frames.insert(frames.end(), got.begin(), got.end());
+        }
+        report("parser split input", frames.size() == 1 && isSearchAck(frames[0]) && readyAt == ACK_SEARCH.size() &&
+                                         parser.resyncBytes() == 0);
+    }
+
+    // 连续两个包
+    {
+        FingerprintFrameParser parser;
+        std::vector<ParsedFrame> frames = feedAll(parser, concat({ACK_OK, ACK_SEARCH}));
+        report("parser back-to-back", frames.size() == 2 && frames[0].payload == std::vector<uint8_t>({0x00}) &&
+                                          isSearchAck(frames[1]));
+    }
+
+    // 前导垃圾字节，包括单独的 0xEF 和不完整的包头
+    {
+        FingerprintFrameParser parser;
+        std::vector<uint8_t> garbage = {0x00, 0x55, 0xEF, 0x02, 0xEF, 0x01, 0xFF, 0x13, 0xEF};
+        std::vector<ParsedFrame> frames = feedAll(parser, concat({garbage, ACK_SEARCH}));
+        snprintf(detail, sizeof(detail), "resync %u bytes", parser.resyncBytes());
+        report("parser leading garbage", frames.size() == 1 && isSearchAck(frames[0]) &&
+                                             parser.resyncBytes() == garbage.size(), detail);
+    }
+
+    // 长度字段非法的包被丢弃，后面的包正常解析
+    {
+        FingerprintFrameParser parser;
+        std::vector<uint8_t> badLength = {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x07, 0x01, 0x03};
+        std::vector<ParsedFrame> frames = feedAll(parser, concat({badLength, ACK_OK}));
+        report("parser bad length", frames.size() == 1 && frames[0].pid == FingerprintFrame::PID_ACK);
+    }
+
+    // 校验和错误的包被丢弃并计数，后面的包正常解析
+    {
+        FingerprintFrameParser parser;
+        std::vector<uint8_t> corrupt = ACK_SEARCH;
+        corrupt[13] ^= 0x01;
+        std::vector<ParsedFrame> frames = feedAll(parser, concat({corrupt, ACK_OK}));
+        snprintf(detail, sizeof(detail), "checksum errors %u", parser.checksumErrors());
+        report("parser bad checksum", frames.size() == 1 && frames[0].payload == std::vector<uint8_t>({0x00}) &&
+                                          parser.checksumErrors() == 1, detail);
+    }
+
+    // 坏包内部嵌着真实的包头：从坏包头的下一个字节重新扫描，找回其中的包
+    {
+        FingerprintFrameParser parser;
+        std::vector<uint8_t> fakeHead = {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x07, 0x00, 0x10};
+        std::vector<ParsedFrame> frames = feedAll(parser, concat({fakeHead, ACK_SEARCH, ACK_OK}));
+        snprintf(detail, sizeof(detail), "resync %u bytes", parser.resyncBytes());
+        report("parser header inside bad frame", frames.size() == 2 && isSearchAck(frames[0]) &&
+                                                     frames[1].payload == std::vector<uint8_t>({0x00}) &&
+                                                     parser.checksumErrors() == 1 && parser.resyncBytes() == fakeHead.size(),
+               detail);
+    }
+
+    // 坏包吞下了两个完整的包，第二个包不等新数据到达就能取出
+    {
+        FingerprintFrameParser parser;
+        std::vector<uint8_t> fakeHead = {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x07, 0x00, 0x1C};
+        std::vector<uint8_t> bytes = concat({fakeHead, ACK_SEARCH, ACK_OK});
+        size_t ready = 0;
+        for (uint8_t b : bytes)
+        {
+            if (parser.feed(b) == FingerprintFrameParser::FRAME_READY)
+                ready++;
+        }
+        bool pending = parser.hasPending();
+        while (parser.hasPending())
+        {
+            if (parser.poll() == FingerprintFrameParser::FRAME_READY)
+                ready++;
+        }
+        report("parser pending after rescan", ready == 2 && pending);
+    }
+
+    // reset() 丢弃半个包
+    {
+        FingerprintFrameParser parser;
+        feedAll(parser, std::vector<uint8_t>(ACK_SEARCH.begin(), ACK_SEARCH.begin() + 10));
+        parser.reset();
+        std::vector<ParsedFrame> frames = feedAll(parser, ACK_OK);
+        report("parser reset", frames.size() == 1 && frames[0].payload == std::vector<uint8_t>({0x00}));
+    }
+}
+
+int main()
+{
+    encoderTests();
+    parserTests();
+    ::printf("%s: %d failure(s)\n", failures == 0 ? "PASS" : "FAIL", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+# 延迟日志解码：固件以 LOG_OUTPUT_BINARY=1 编译时，串口输出二进制日志帧，按固件 ELF 中的格式串还原文本
+# 帧格式：A5 5A 长度 | 时间戳(4) 格式串地址(4) 级别(1) 参数个数(1) 参数(4*n) | 累加和，多字节均为小端
+# 帧之外的字节（Serial.print 直接输出的文本）原样输出
+# 用法：python3 logdecode.py SparkinFW.ino.elf [串口设备或日志文件，默认标准输入]
+#      串口设备需要先设置波特率，例如 stty -F /dev/ttyACM0 115200 raw
+
+import re
+import struct
+import sys
+
+LEVELS = "?EWID"
+SPEC = re.compile(r"%([-+ #0]*)(\d*)(?:\.(\d+))?(?:hh|h|ll|l|L|q|j|z|t)?([diouxXeEfFgGaAcsp%])")
+
+
+class Elf:
+    """只读取 ELF32 小端文件中占用内存的段，用于按地址读取格式串和字符串字面量"""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF" or self.data[4] != 1 or self.data[5] != 1:
+            raise ValueError("%s is not a little-endian ELF32 file" % path)
+        shoff, = struct.unpack_from("<I", self.data, 0x20)
+        shentsize, shnum = struct.unpack_from("<HH", self.data, 0x2E)
+        self.sections = []
+        for i in range(shnum):
+            _, sh_type, flags, addr, offset, size = struct.unpack_from("<IIIIII", self.data, shoff + i * shentsize)
+            # SHF_ALLOC，并且不是 NOBITS（.bss）
+            if flags & 0x2 and sh_type != 8 and addr:
+                self.sections.append((addr, size, offset))
+
+    def string(self, address):
+        for addr, size, offset in self.sections:
+            if addr <= address < addr + size:
+                start = offset + address - addr
+                end = self.data.index(b"\0", start, offset + size)
+                return self.data[start:end].decode("utf-8", "replace")
+        return None
+
+
+def format_record(elf, format_address, args):
+    fmt = elf.string(format_address)
+    if fmt is None:
+        return "<unknown format 0x%08X> %s" % (format_address, " ".join("%08X" % a for a in args))
+    values = iter(args)
+
+    def convert(match):
+        flags, width, precision, conversion = match.groups()
+        if conversion == "%":
+            return "%"
+        value = next(values, 0)
+        spec = "%" + flags + width + ("." + precision if precision is not None else "")
+        if conversion in "di":
+            return (spec + "d") % (value - (1 << 32) if value & 0x80000000 else value)
+        if conversion in "uoxX":
+            return (spec + ("d" if conversion == "u" else conversion)) % value
+        if conversion in "eEfFgGaA":
+            number, = struct.unpack("<f", struct.pack("<I", value))
+            return (spec + (conversion if conversion not in "aA" else "e")) % number
+        if conversion == "c":
+            return (spec + "c") % chr(value & 0xFF)
+        if conversion == "s":
+            text = elf.string(value)
+            return (spec + "s") % (text if text is not None else "<?>")
+        return "0x%08x" % value  # %p
+
+    return SPEC.sub(convert, fmt)
+
+
+def decode(elf, stream, out):
+    buffer = bytearray()
+    while True:
+        chunk = stream.read1(4096) if hasattr(stream, "read1") else stream.read(4096)
+        if not chunk:
+            break
+        buffer += chunk
+        while buffer:
+            start = buffer.find(b"\xA5\x5A")
+            if start < 0:
+                # 保留末尾可能是帧头的一个字节
+                keep = 1 if buffer[-1] == 0xA5 else 0
+                out.write(buffer[:len(buffer) - keep].decode("utf-8", "replace"))
+                del buffer[:len(buffer) - keep]
+                break
+            if start:
+                out.write(buffer[:start].decode("utf-8", "replace"))
+                del buffer[:start]
+            if len(buffer) < 3 or len(buffer) < 3 + buffer[2] + 1:
+                break
+            length = buffer[2]
+            payload = bytes(buffer[3:3 + length])
+            if length < 10 or sum(payload) & 0xFF != buffer[3 + length] or (length - 10) != payload[9] * 4:
+                # 不是有效的帧，帧头按文本输出后重新同步
+                out.write(buffer[:1].decode("utf-8", "replace"))
+                del buffer[:1]
+                continue
+            timestamp, format_address, level, argc = struct.unpack_from("<IIBB", payload)
+            args = struct.unpack_from("<%dI" % argc, payload, 10)
+            out.write("%s (%u) %s\n" % (LEVELS[level] if level < len(LEVELS) else "?", timestamp // 1000,
+                                        format_record(elf, format_address, args)))
+            del buffer[:3 + length + 1]
+        out.flush()
+    if buffer:
+        out.write(buffer.decode("utf-8", "replace"))
+
+
+def main():
+    if len(sys.argv) < 2:
+        print("usage: %s firmware.elf [port-or-file]" % sys.argv[0], file=sys.stderr)
+        return 2
+    elf = Elf(sys.argv[1])
+    if len(sys.argv) > 2:
+        with open(sys.argv[2], "rb", buffering=0) as stream:
+            decode(elf, stream, sys.stdout)
+    else:
+        decode(elf, sys.stdin.buffer, sys.stdout)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
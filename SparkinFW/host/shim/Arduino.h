@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// 主机构建用的 Arduino 最小实现，只覆盖指纹驱动用到的部分
+// 时间由虚拟时钟推进：只有等待（delay、信号量超时）才会让时间前进，结果与主机性能无关
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <functional>
+#include "freertos/FreeRTOS.h"
+
+using std::max;
+using std::min;
+
+#define IRAM_ATTR
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define DEC 10
+#define HEX 16
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+
+inline void pinMode(int, int) {}
+inline void digitalWrite(int, int) {}
+inline int digitalRead(int) { return LOW; }
+
+// 串口输出到标准输出，可以关闭以便只看测试结果
+class HostSerial
+{
+public:
+    void setEnabled(bool enabled) { _enabled = enabled; }
+
+    void print(const char *text);
+    void print(char c);
+    void print(int value, int base = DEC);
+    void print(unsigned int value, int base = DEC);
+    void print(long value, int base = DEC);
+    void print(unsigned long value, int base = DEC);
+    void println();
+    template <typename T>
+    void println(T value)
+    {
+        print(value);
+        println();
+    }
+    template <typename T>
+    void println(T value, int base)
+    {
+        print(value, base);
+        println();
+    }
+    void printf(const char *format, ...);
+    void flush() {}
+
+private:
+    bool _enabled = true;
+};
+
+extern HostSerial Serial;
+
+// 虚拟时钟的事件源（模组模拟器），在等待时按时间顺序执行到期事件
+class HostEventSource
+{
+public:
+    virtual ~HostEventSource() {}
+    // 下一个事件的时间，没有事件时返回 UINT64_MAX
+    virtual uint64_t nextEventUs() = 0;
+    // 执行所有不晚于 nowUs 的事件
+    virtual void runEvents(uint64_t nowUs) = 0;
+};
+
+void hostSetEventSource(HostEventSource *source);
+uint64_t hostNowUs();
+// 推进虚拟时钟直到 ready() 为真或到达 deadlineUs，返回 ready() 的结果
+bool hostWaitUntil(uint64_t deadlineUs, const std::function<bool()> &ready);
+
+#endif // HOST_ARDUINO_H
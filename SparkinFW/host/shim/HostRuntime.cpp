@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <stdarg.h>
+
+HostSerial Serial;
+
+static uint64_t nowUs = 0;
+static HostEventSource *eventSource = nullptr;
+
+struct HostSemaphore
+{
+    int count;
+};
+
+void hostSetEventSource(HostEventSource *source)
+{
+    eventSource = source;
+}
+
+uint64_t hostNowUs()
+{
+    return nowUs;
+}
+
+bool hostWaitUntil(uint64_t deadlineUs, const std::function<bool()> &ready)
+{
+    while (!ready())
+    {
+        uint64_t next = eventSource ? eventSource->nextEventUs() : UINT64_MAX;
+        if (next > deadlineUs)
+        {
+            if (deadlineUs == UINT64_MAX)
+            {
+                fprintf(stderr, "[Host] Waiting forever with no pending events\n");
+                return false;
+            }
+            nowUs = max(nowUs, deadlineUs);
+            return ready();
+        }
+        nowUs = max(nowUs, next);
+        eventSource->runEvents(nowUs);
+    }
+    return true;
+}
+
+uint32_t millis()
+{
+    return (uint32_t)(nowUs / 1000);
+}
+
+uint32_t micros()
+{
+    return (uint32_t)nowUs;
+}
+
+int64_t esp_timer_get_time()
+{
+    return (int64_t)nowUs;
+}
+
+void delay(uint32_t ms)
+{
+    hostWaitUntil(nowUs + (uint64_t)ms * 1000, []() { return false; });
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    delay(ticks * portTICK_PERIOD_MS);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    return new HostSemaphore{1};
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+    return new HostSemaphore{0};
+}
+
+// 主机上的信号量只有计数，静态分配的缓冲区不需要使用
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *)
+{
+    return new HostSemaphore{0};
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore)
+{
+    delete semaphore;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks)
+{
+    if (semaphore->count == 0 && ticks > 0)
+    {
+        uint64_t deadline = ticks == portMAX_DELAY ? UINT64_MAX : nowUs + (uint64_t)ticks * portTICK_PERIOD_MS * 1000;
+        hostWaitUntil(deadline, [semaphore]() { return semaphore->count > 0; });
+    }
+    if (semaphore->count == 0)
+    {
+        return pdFALSE;
+    }
+    semaphore->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    semaphore->count = 1;
+    return pdTRUE;
+}
+
+void HostSerial::print(const char *text)
+{
+    if (_enabled)
+        fputs(text, stdout);
+}
+
+void HostSerial::print(char c)
+{
+    if (_enabled)
+        fputc(c, stdout);
+}
+
+void HostSerial::print(int value, int base)
+{
+    print((long)value, base);
+}
+
+void HostSerial::print(unsigned int value, int base)
+{
+    print((unsigned long)value, base);
+}
+
+void HostSerial::print(long value, int base)
+{
+    if (value < 0 && base == DEC)
+    {
+        print('-');
+        print((unsigned long)-value, base);
+        return;
+    }
+    print((unsigned long)value, base);
+}
+
+void HostSerial::print(unsigned long value, int base)
+{
+    if (_enabled)
+        ::printf(base == HEX ? "%lX" : "%lu", value);
+}
+
+void HostSerial::println()
+{
+    print('\n');
+}
+
+// ESP32 上 long 是32位，固件中的 %lu/%lX 对应的参数都是32位整数，主机上去掉长度修饰符
+void HostSerial::printf(const char *format, ...)
+{
+    if (!_enabled)
+        return;
+    char converted[256];
+    size_t out = 0;
+    for (const char *p = format; *p && out < sizeof(converted) - 1; p++)
+    {
+        converted[out++] = *p;
+        if (*p != '%')
+            continue;
+        while (p[1] && strchr("-+ #0123456789.", p[1]) && out < sizeof(converted) - 1)
+            converted[out++] = *++p;
+        if (p[1] == 'l' && p[2] != 'l')
+            p++;
+    }
+    converted[out] = '\0';
+
+    va_list args;
+    va_start(args, format);
+    vprintf(converted, args);
+    va_end(args);
+}
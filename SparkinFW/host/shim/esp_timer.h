@@ -0,0 +1,14 @@
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+#include <stdint.h>
+
+// 开机后微秒，与 millis()/micros() 使用同一个虚拟时钟
+int64_t esp_timer_get_time();
+
+#endif // HOST_ESP_TIMER_H
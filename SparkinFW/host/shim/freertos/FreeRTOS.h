@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+// 主机构建用的 FreeRTOS 最小实现：单线程运行，信号量等待由虚拟时钟推进
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define portMAX_DELAY 0xFFFFFFFFu
+#define portTICK_PERIOD_MS 1
+
+struct HostSemaphore;
+typedef HostSemaphore *SemaphoreHandle_t;
+typedef void *QueueHandle_t;
+typedef void *EventGroupHandle_t;
+typedef void *TaskHandle_t;
+
+typedef struct { int count; } StaticSemaphore_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateBinary();
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buffer);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+void vSemaphoreDelete(SemaphoreHandle_t semaphore);
+void vTaskDelay(TickType_t ticks);
+
+// 主机上没有其他任务：创建任务总是失败，调用方（指令调度器）改为在当前线程直接执行，队列不会被使用
+inline BaseType_t xTaskCreate(void (*)(void *), const char *, uint32_t, void *, UBaseType_t, TaskHandle_t *handle)
+{
+    if (handle)
+        *handle = nullptr;
+    return pdFAIL;
+}
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return nullptr; }
+inline BaseType_t xTaskNotifyGive(TaskHandle_t) { return pdPASS; }
+inline uint32_t ulTaskNotifyTake(BaseType_t, TickType_t) { return 0; }
+inline QueueHandle_t xQueueCreate(UBaseType_t, UBaseType_t) { return nullptr; }
+inline BaseType_t xQueueSend(QueueHandle_t, const void *, TickType_t) { return pdFALSE; }
+inline BaseType_t xQueuePeek(QueueHandle_t, void *, TickType_t) { return pdFALSE; }
+inline BaseType_t xQueueReceive(QueueHandle_t, void *, TickType_t) { return pdFALSE; }
+
+#endif // HOST_FREERTOS_H
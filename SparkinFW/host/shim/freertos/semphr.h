@@ -0,0 +1,11 @@
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+#ifndef HOST_SEMPHR_H
+#define HOST_SEMPHR_H
+
+#include "FreeRTOS.h"
+
+#endif // HOST_SEMPHR_H
@@ -12,6 +12,7 @@ using System.IO.Compression;
 using System.IO.Pipes;
 using System.Linq;
 using System.Reflection;
+using System.Runtime.InteropServices;
 using System.Text;
 using System.Threading;
 using System.Threading.Tasks;
@@ -56,6 +57,9 @@ namespace SparkinClient
         // 可存储最大指纹数量
         private int MAX_FINGER_NUM = 10;
         private int fingerprintCount = 0;
+
+        // 固件升级每块数据长度，设备返回链路参数后按协商的 MTU 填满一次写入
+        private int firmwareChunkSize = 200;
         
         private ConfigFile configFile = null;
         
@@ -244,9 +248,10 @@ namespace SparkinClient
                                 return;
                             }
 
-                            // 每次发送200字节的数据块
+                            // 每块数据加上1字节消息类型正好是一次写入
                             int totalBytesSent = 0;
-                            int chunkSize = 200;
+                            int chunkSize = firmwareChunkSize;
+                            log.Info($"[DOWNLOAD_COMPLETED]固件数据块长度：{chunkSize}");
 
                             while (totalBytesSent < compressedData.Length)
                             {
@@ -645,6 +650,13 @@ namespace SparkinClient
                     log.Info("设备ID：" + msgInfo.deviceId);
                     log.Info("Build日期：" + msgInfo.buildDate);
                     log.Info("固件版本：" + msgInfo.firmwareVer);
+                    if (data.Length >= 3 + Marshal.SizeOf(typeof(MsgInfo)) + Marshal.SizeOf(typeof(MsgLinkInfo)))
+                    {
+                        MsgLinkInfo link = StructConverter.ByteArrayToStructure<MsgLinkInfo>(data, 3 + Marshal.SizeOf(typeof(MsgInfo)));
+                        log.Info($"链路参数：MTU={link.mtu} 最大载荷={link.maxPayload}");
+                        if (link.maxPayload > 20)
+                            firmwareChunkSize = link.maxPayload - 1;
+                    }
                     
                     // 更新UI
                     cbSleepTime.SelectionChanged -= SleepTime_SelectionChanged;
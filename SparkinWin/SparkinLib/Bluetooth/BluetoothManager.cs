@@ -23,6 +23,7 @@ namespace SparkinLib.Bluetooth
         // 服务和特征值UUID常量
         public static readonly Guid DEFAULT_SERVICE_UUID = new Guid("4fafc201-1fb5-459e-8fcc-c5c9c331914b");
         public static readonly Guid DEFAULT_CHARACTERISTIC_UUID = new Guid("beb5483e-36e1-4688-b7f5-ea07361b26a8");
+        public static readonly Guid DEFAULT_BULK_CHARACTERISTIC_UUID = new Guid("beb5483f-36e1-4688-b7f5-ea07361b26a8");
         public static readonly string BLUETOOTH_DEVICE_NAME = "Sparkin FP01";
 
         // 电量服务和特征值UUID
@@ -38,6 +39,24 @@ namespace SparkinLib.Bluetooth
         //private DeviceInformation connectedDeviceInfo = null;   //已连接的设备信息
         private GattDeviceService selectedService;  //订阅的通讯服务
         private GattCharacteristic selectedCharacteristic;
+        private readonly MessageFragmenter fragmenter = new MessageFragmenter(); // 长消息分片和重组
+        private readonly SemaphoreSlim fragmentLock = new SemaphoreSlim(1, 1);   // 保证一条消息的分片连续写入
+
+        // 批量数据通道：无响应写入，每次写入消耗一个设备授予的额度，设备处理完后归还
+        private GattCharacteristic bulkCharacteristic;   // 旧固件没有这个特征
+        private SemaphoreSlim bulkCredits;               // 打开通道后才创建
+        private int bulkWindow;                          // 打开时设备授予的额度总数
+        private TaskCompletionSource<bool> bulkOpenReply;
+
+        /// <summary>
+        /// 批量数据通道是否已打开，打开后固件数据块和模板导入走批量通道，设备不再逐块应答
+        /// </summary>
+        public bool BulkChannelOpen => bulkCredits != null;
+
+        /// <summary>
+        /// 单次写入的最大长度，设备在 MSG_GET_INFO 中返回协商的值，断开后恢复默认
+        /// </summary>
+        public int MaxWriteSize { get; set; } = CmdMessage.MAX_WRITE_SIZE;
 
         // 事件
         public event EventHandler<BluetoothDeviceInfo> DeviceConnected;
@@ -167,6 +186,10 @@ namespace SparkinLib.Bluetooth
                                 // 取消事件注册
                                 localCharacteristic.ValueChanged -= Characteristic_ValueChanged;
                                 localCharacteristic = null;
+                                fragmenter.Reset();
+                                MaxWriteSize = CmdMessage.MAX_WRITE_SIZE;
+                                bulkCharacteristic = null;
+                                bulkCredits = null;
                             }
                         }
                         catch (Exception ex)
@@ -634,6 +657,18 @@ namespace SparkinLib.Bluetooth
                         selectedCharacteristic.ValueChanged += Characteristic_ValueChanged;
                     }
 
+                    // 批量数据特征是可选的，没有时所有数据都走带响应的写入
+                    bulkCharacteristic = null;
+                    bulkCredits = null;
+                    GattCharacteristicsResult bulkResult =
+                        await selectedService.GetCharacteristicsForUuidAsync(DEFAULT_BULK_CHARACTERISTIC_UUID);
+                    if (bulkResult.Status == GattCommunicationStatus.Success && bulkResult.Characteristics.Count > 0 &&
+                        bulkResult.Characteristics[0].CharacteristicProperties.HasFlag(GattCharacteristicProperties.WriteWithoutResponse))
+                    {
+                        bulkCharacteristic = bulkResult.Characteristics[0];
+                        log.Info("[BTM_SelectChara]设备支持批量数据通道");
+                    }
+
                     log.Info($"[BTM_SelectChara]已选择服务 {serviceUuid} 和特征值 {characteristicUuid}");
                     return true;
                 }
@@ -904,7 +939,38 @@ namespace SparkinLib.Bluetooth
                 ErrorOccurred?.Invoke(this, "未选择特征值，无法发送数据");
                 return false;
             }
+            if (data.Length <= MaxWriteSize)
+            {
+                return await WriteDataAsync(data);
+            }
+            if (data.Length > CmdMessage.MAX_MESSAGE_SIZE + 1)
+            {
+                log.Info($"[BTM_SendData]数据超过最大长度，无法发送: {data.Length} 字节");
+                ErrorOccurred?.Invoke(this, "数据超过最大长度，无法发送");
+                return false;
+            }
 
+            // 超过一次写入的长度，分片依次写入，设备端重组
+            await fragmentLock.WaitAsync();
+            try
+            {
+                List<byte[]> fragments = fragmenter.Split(data, MaxWriteSize);
+                foreach (byte[] fragment in fragments)
+                {
+                    if (!await WriteDataAsync(fragment))
+                        return false;
+                }
+                log.Info($"[BTM_SendData]已分 {fragments.Count} 片发送，长度: {data.Length} 字节");
+                return true;
+            }
+            finally
+            {
+                fragmentLock.Release();
+            }
+        }
+
+        private async Task<bool> WriteDataAsync(byte[] data)
+        {
             try
             {
                 using (DataWriter dataWriter = new DataWriter())
@@ -933,6 +999,94 @@ namespace SparkinLib.Bluetooth
             }
         }
 
+        /// <summary>
+        /// 打开批量数据通道，设备在处理完之前收到的数据块后返回初始额度
+        /// </summary>
+        /// <returns>设备不支持或没有应答时返回false，调用方继续使用带响应的写入</returns>
+        public async Task<bool> OpenBulkChannelAsync()
+        {
+            if (bulkCharacteristic == null)
+                return false;
+
+            var reply = new TaskCompletionSource<bool>(TaskCreationOptions.RunContinuationsAsynchronously);
+            bulkOpenReply = reply;
+            bulkCredits = null;
+            if (!await SendDataAsync(new byte[] { CmdMessage.MSG_BULK_OPEN }))
+                return false;
+            if (await Task.WhenAny(reply.Task, Task.Delay(CmdMessage.BULK_OPEN_TIMEOUT_MS)) != reply.Task || !reply.Task.Result)
+            {
+                log.Info("[BTM_OpenBulk]设备没有打开批量数据通道");
+                return false;
+            }
+            log.Info($"[BTM_OpenBulk]批量数据通道已打开，额度: {bulkWindow}");
+            return true;
+        }
+
+        /// <summary>
+        /// 通过批量数据通道写入一条消息，没有额度时等待设备归还；通道未打开时退回带响应的写入
+        /// </summary>
+        /// <param name="data">消息类型加数据，不能超过单次写入长度</param>
+        public async Task<bool> SendBulkAsync(byte[] data)
+        {
+            var credits = bulkCredits;
+            var characteristic = bulkCharacteristic;
+            if (credits == null || characteristic == null)
+                return await SendDataAsync(data);
+            if (data.Length > MaxWriteSize)
+            {
+                log.Info($"[BTM_SendBulk]数据超过单次写入长度: {data.Length} 字节");
+                return false;
+            }
+            if (!await credits.WaitAsync(CmdMessage.BULK_CREDIT_TIMEOUT_MS))
+            {
+                log.Info("[BTM_SendBulk]等待设备归还额度超时");
+                return false;
+            }
+
+            try
+            {
+                using (DataWriter dataWriter = new DataWriter())
+                {
+                    dataWriter.WriteBytes(data);
+                    GattCommunicationStatus status = await characteristic.WriteValueAsync(
+                        dataWriter.DetachBuffer(),
+                        GattWriteOption.WriteWithoutResponse);
+                    if (status != GattCommunicationStatus.Success)
+                    {
+                        log.Info($"[BTM_SendBulk]写入失败: {status}");
+                        credits.Release(); // 设备没有收到，额度不会归还
+                        return false;
+                    }
+                }
+                return true;
+            }
+            catch (Exception ex)
+            {
+                log.Info($"[BTM_SendBulk]写入时出错: {ex.Message}");
+                credits.Release();
+                ErrorOccurred?.Invoke(this, $"批量写入时出错: {ex.Message}");
+                return false;
+            }
+        }
+
+        /// <summary>
+        /// 等待设备归还全部额度，即批量通道中的数据块都已处理完（发送结束命令之前调用）
+        /// </summary>
+        public async Task<bool> WaitBulkDrainedAsync(int timeoutMs)
+        {
+            var credits = bulkCredits;
+            if (credits == null)
+                return true;
+            DateTime deadline = DateTime.Now.AddMilliseconds(timeoutMs);
+            while (credits.CurrentCount < bulkWindow)
+            {
+                if (DateTime.Now >= deadline)
+                    return false;
+                await Task.Delay(10);
+            }
+            return true;
+        }
+
         /// <summary>
         /// 从订阅服务收到数据
         /// </summary>
@@ -953,6 +1107,37 @@ namespace SparkinLib.Bluetooth
             }
             log.Info("[BTM_CharaValue]收到蓝牙数据：" + recivedData);
 
+            // 批量通道的应答和额度在这里处理，不交给上层
+            if (data.Length >= 4 && data[0] == CmdMessage.MSG_BULK_CREDIT)
+            {
+                if (data[3] > 0)
+                    bulkCredits?.Release(data[3]);
+                return;
+            }
+            if (data.Length >= 4 && data[0] == CmdMessage.MSG_BULK_OPEN)
+            {
+                // 在事件中直接创建额度，之后到达的归还额度不会丢失
+                bool opened = data[3] == CmdMessage.MSG_CMD_SUCCESS && data.Length >= 5 && data[4] > 0;
+                if (opened)
+                {
+                    bulkWindow = data[4];
+                    bulkCredits = new SemaphoreSlim(bulkWindow);
+                }
+                bulkOpenReply?.TrySetResult(opened);
+                return;
+            }
+
+            // 分片在这里重组，完整后再交给上层
+            if (data.Length > 0 && data[0] == CmdMessage.MSG_FRAGMENT)
+            {
+                data = fragmenter.Receive(data);
+                if (fragmenter.LastError != null)
+                    log.Info($"[BTM_CharaValue]分片重组出错：{fragmenter.LastError}");
+                if (data == null)
+                    return;
+                log.Info($"[BTM_CharaValue]分片重组完成，消息0x{data[0]:X2}，长度: {data.Length} 字节");
+            }
+
             // 触发事件
             DataReceived?.Invoke(this, data);
         }
@@ -1056,6 +1241,78 @@ namespace SparkinLib.Bluetooth
             }
         }
 
+        /// <summary>
+        /// 设置指纹比对方式
+        /// </summary>
+        public async Task SendSetMatchMode(byte matchMode)
+        {
+            if (connectedDevice == null || selectedCharacteristic == null)
+            {
+                log.Info("[BTM_SetMatchModeCmd]设备未连接或未订阅");
+                return;
+            }
+
+            try
+            {
+                byte[] commandData = new byte[] { CmdMessage.MSG_SET_MATCH_MODE, matchMode };
+                await SendDataAsync(commandData);
+                log.Info("[BTM_SetMatchModeCmd]已发送设置比对方式命令");
+            }
+            catch (Exception ex)
+            {
+                log.Error($"[BTM_SetMatchModeCmd]发送设置比对方式命令时出错: {ex.Message}");
+                ErrorOccurred?.Invoke(this, $"发送设置比对方式命令时出错: {ex.Message}");
+            }
+        }
+
+        /// <summary>
+        /// 设置休眠时指纹模组供电策略
+        /// </summary>
+        public async Task SendSetSensorPower(byte policy)
+        {
+            if (connectedDevice == null || selectedCharacteristic == null)
+            {
+                log.Info("[BTM_SetSensorPowerCmd]设备未连接或未订阅");
+                return;
+            }
+
+            try
+            {
+                byte[] commandData = new byte[] { CmdMessage.MSG_SET_SENSOR_POWER, policy };
+                await SendDataAsync(commandData);
+                log.Info("[BTM_SetSensorPowerCmd]已发送设置模组供电策略命令");
+            }
+            catch (Exception ex)
+            {
+                log.Error($"[BTM_SetSensorPowerCmd]发送设置模组供电策略命令时出错: {ex.Message}");
+                ErrorOccurred?.Invoke(this, $"发送设置模组供电策略命令时出错: {ex.Message}");
+            }
+        }
+
+        /// <summary>
+        /// 设置比对结束后重新接受触摸的最小间隔（毫秒）
+        /// </summary>
+        public async Task SendSetRearmInterval(ushort intervalMs)
+        {
+            if (connectedDevice == null || selectedCharacteristic == null)
+            {
+                log.Info("[BTM_SetRearmIntervalCmd]设备未连接或未订阅");
+                return;
+            }
+
+            try
+            {
+                byte[] commandData = new byte[] { CmdMessage.MSG_SET_REARM_INTERVAL, (byte)(intervalMs >> 8), (byte)(intervalMs & 0xFF) };
+                await SendDataAsync(commandData);
+                log.Info("[BTM_SetRearmIntervalCmd]已发送设置触摸最小间隔命令");
+            }
+            catch (Exception ex)
+            {
+                log.Error($"[BTM_SetRearmIntervalCmd]发送设置触摸最小间隔命令时出错: {ex.Message}");
+                ErrorOccurred?.Invoke(this, $"发送设置触摸最小间隔命令时出错: {ex.Message}");
+            }
+        }
+
         /// <summary>
         /// 发送锁屏状态
         /// </summary>
@@ -1169,6 +1426,9 @@ namespace SparkinLib.Bluetooth
 
             try
             {
+                // 固件数据块优先走批量通道，旧固件不支持时仍逐块等待应答
+                await OpenBulkChannelAsync();
+
                 byte[] commandData = new byte[] { CmdMessage.MSG_FIRMWARE_UPDATE_START };
                 commandData = commandData.Concat(fileLength).ToArray();
                 log.Info("[BTM_SendFirmwareUpdateStart]发送固件升级开始命令");
@@ -1182,12 +1442,16 @@ namespace SparkinLib.Bluetooth
             }
         }
 
-        public async Task SendFirmwareUpdateChunkAsync(byte[] firmwareData)
+        /// <summary>
+        /// 发送一块固件数据，批量通道打开时设备不逐块应答
+        /// </summary>
+        /// <returns>是否写入成功</returns>
+        public async Task<bool> SendFirmwareUpdateChunkAsync(byte[] firmwareData)
         {
             if (connectedDevice == null || selectedCharacteristic == null)
             {
                 log.Info("[BTM_SendFirmwareUpdateChunk]设备未连接或未订阅");
-                return;
+                return false;
             }
 
             try
@@ -1195,13 +1459,14 @@ namespace SparkinLib.Bluetooth
                 byte[] commandData = new byte[] { CmdMessage.MSG_FIRMWARE_UPDATE_CHUNK };
                 commandData = commandData.Concat(firmwareData).ToArray();
                 //log.Info("[BTM_SendFirmwareUpdateChunk]开始发送固件数据");
-                await SendDataAsync(commandData);
+                return await SendBulkAsync(commandData);
                 //log.Info("[BTM_SendFirmwareUpdateChunk]已完成发送固件数据");
             }
             catch (Exception ex)
             {
                 log.Error($"[BTM_SendFirmwareUpdateChunk]发送固件数据时出错: {ex.Message}");
                 ErrorOccurred?.Invoke(this, $"发送固件数据时出错: {ex.Message}");
+                return false;
             }
         }
 
@@ -1215,6 +1480,10 @@ namespace SparkinLib.Bluetooth
 
             try
             {
+                // 结束命令走控制特征，先等批量通道中的数据块处理完
+                if (!await WaitBulkDrainedAsync(CmdMessage.BULK_CREDIT_TIMEOUT_MS))
+                    log.Info("[BTM_SendFirmwareUpdateEnd]批量通道中的数据块没有处理完");
+
                 byte[] commandData = new byte[] { CmdMessage.MSG_FIRMWARE_UPDATE_END };
                 commandData = commandData.Concat(crc32Value).ToArray();
               
@@ -1229,6 +1498,172 @@ namespace SparkinLib.Bluetooth
             }
         }
 
+        /// <summary>
+        /// 发送导出全部指纹模板命令，设备以MSG_TEMPLATE_DATA分块返回
+        /// </summary>
+        public async Task SendTemplateExportAsync()
+        {
+            if (connectedDevice == null || selectedCharacteristic == null)
+            {
+                log.Info("[BTM_SendTemplateExport]设备未连接或未订阅");
+                return;
+            }
+
+            try
+            {
+                byte[] commandData = new byte[] { CmdMessage.MSG_TEMPLATE_EXPORT };
+                await SendDataAsync(commandData);
+                log.Info("[BTM_SendTemplateExport]已发送导出指纹模板命令");
+            }
+            catch (Exception ex)
+            {
+                log.Error($"[BTM_SendTemplateExport]发送导出指纹模板命令出错: {ex.Message}");
+                ErrorOccurred?.Invoke(this, $"发送导出指纹模板命令出错: {ex.Message}");
+            }
+        }
+
+        /// <summary>
+        /// 读取设备上模组指令耗时统计，reset 为 true 时读取后清除
+        /// </summary>
+        public async Task SendTraceStatsAsync(bool reset)
+        {
+            if (connectedDevice == null || selectedCharacteristic == null)
+            {
+                log.Info("[BTM_SendTraceStats]设备未连接或未订阅");
+                return;
+            }
+
+            try
+            {
+                byte flags = reset ? CmdMessage.TRACE_FLAG_RESET : (byte)0;
+                byte[] commandData = new byte[] { CmdMessage.MSG_TRACE_STATS, flags };
+                await SendDataAsync(commandData);
+                log.Info("[BTM_SendTraceStats]已发送读取耗时统计命令");
+            }
+            catch (Exception ex)
+            {
+                log.Error($"[BTM_SendTraceStats]发送读取耗时统计命令出错: {ex.Message}");
+                ErrorOccurred?.Invoke(this, $"发送读取耗时统计命令出错: {ex.Message}");
+            }
+        }
+
+        /// <summary>
+        /// 请求设备连续发送 count 条 size 字节的测试消息，测量通知发送吞吐量
+        /// </summary>
+        public async Task SendTxBenchmarkAsync(ushort count, byte size)
+        {
+            if (connectedDevice == null || selectedCharacteristic == null)
+            {
+                log.Info("[BTM_SendTxBenchmark]设备未连接或未订阅");
+                return;
+            }
+
+            try
+            {
+                byte[] commandData = new byte[] { CmdMessage.MSG_TX_BENCHMARK, (byte)(count >> 8), (byte)(count & 0xFF), size };
+                await SendDataAsync(commandData);
+                log.Info($"[BTM_SendTxBenchmark]已发送吞吐量测试命令，数量={count} 长度={size}");
+            }
+            catch (Exception ex)
+            {
+                log.Error($"[BTM_SendTxBenchmark]发送吞吐量测试命令出错: {ex.Message}");
+                ErrorOccurred?.Invoke(this, $"发送吞吐量测试命令出错: {ex.Message}");
+            }
+        }
+
+        /// <summary>
+        /// 请求设备采图并上传原始图像，设备以MSG_IMAGE_DATA分块返回，compress 为 true 时数据按 PackBits 压缩
+        /// </summary>
+        public async Task SendImageUploadAsync(bool compress)
+        {
+            if (connectedDevice == null || selectedCharacteristic == null)
+            {
+                log.Info("[BTM_SendImageUpload]设备未连接或未订阅");
+                return;
+            }
+
+            try
+            {
+                byte flags = compress ? CmdMessage.IMAGE_FLAG_RLE : (byte)0;
+                byte[] commandData = new byte[] { CmdMessage.MSG_IMAGE_UPLOAD, flags };
+                await SendDataAsync(commandData);
+                log.Info("[BTM_SendImageUpload]已发送图像上传命令");
+            }
+            catch (Exception ex)
+            {
+                log.Error($"[BTM_SendImageUpload]发送图像上传命令出错: {ex.Message}");
+                ErrorOccurred?.Invoke(this, $"发送图像上传命令出错: {ex.Message}");
+            }
+        }
+
+        /// <summary>
+        /// 一次发送整个导入的模板，设备只在最后返回一次结果：支持批量通道时按单次写入长度分块写入，
+        /// 否则作为一条消息发送，超过单次写入长度时自动分片
+        /// </summary>
+        public async Task SendTemplateImportAsync(byte fingerIndex, byte[] templateData)
+        {
+            if (connectedDevice == null || selectedCharacteristic == null)
+            {
+                log.Info("[BTM_SendTemplateImport]设备未连接或未订阅");
+                return;
+            }
+            if (!BulkChannelOpen && !await OpenBulkChannelAsync())
+            {
+                await SendTemplateImportChunkAsync(fingerIndex, (byte)(CmdMessage.TEMPLATE_FLAG_FIRST | CmdMessage.TEMPLATE_FLAG_LAST), templateData);
+                return;
+            }
+
+            // 每块加上消息类型、模板ID和标志正好是一次写入
+            int chunkSize = MaxWriteSize - 3;
+            int offset = 0;
+            do
+            {
+                int length = Math.Min(chunkSize, templateData.Length - offset);
+                byte flags = 0;
+                if (offset == 0)
+                    flags |= CmdMessage.TEMPLATE_FLAG_FIRST;
+                if (offset + length >= templateData.Length)
+                    flags |= CmdMessage.TEMPLATE_FLAG_LAST;
+
+                byte[] commandData = new byte[3 + length];
+                commandData[0] = CmdMessage.MSG_TEMPLATE_IMPORT;
+                commandData[1] = fingerIndex;
+                commandData[2] = flags;
+                Array.Copy(templateData, offset, commandData, 3, length);
+                if (!await SendBulkAsync(commandData))
+                {
+                    log.Info($"[BTM_SendTemplateImport]模板 {fingerIndex} 写入失败");
+                    return;
+                }
+                offset += length;
+            } while (offset < templateData.Length);
+            log.Info($"[BTM_SendTemplateImport]模板 {fingerIndex} 已通过批量通道发送，长度: {templateData.Length} 字节");
+        }
+
+        /// <summary>
+        /// 发送一块导入的模板数据，调用方需等待设备返回结果后再发送下一块
+        /// </summary>
+        public async Task SendTemplateImportChunkAsync(byte fingerIndex, byte flags, byte[] templateData)
+        {
+            if (connectedDevice == null || selectedCharacteristic == null)
+            {
+                log.Info("[BTM_SendTemplateImportChunk]设备未连接或未订阅");
+                return;
+            }
+
+            try
+            {
+                byte[] commandData = new byte[] { CmdMessage.MSG_TEMPLATE_IMPORT, fingerIndex, flags };
+                commandData = commandData.Concat(templateData).ToArray();
+                await SendDataAsync(commandData);
+            }
+            catch (Exception ex)
+            {
+                log.Error($"[BTM_SendTemplateImportChunk]发送模板数据时出错: {ex.Message}");
+                ErrorOccurred?.Invoke(this, $"发送模板数据时出错: {ex.Message}");
+            }
+        }
+
         public string GetDeviceId()
         {
             // 遍历bluetoothDevices
@@ -31,6 +31,42 @@ namespace SparkinLib.Bluetooth
         public const byte MSG_FIRMWARE_UPDATE_CHUNK = 0x25; //固件升级传输
         public const byte MSG_FIRMWARE_UPDATE_END = 0x26; //固件升级结束
         public const byte MSG_CHECK_SLEEP = 0x27; // 检查可否现在进行休眠，返回UI界面是否打开的状态
+        public const byte MSG_SET_MATCH_MODE = 0x28; // 设置指纹比对方式
+        public const byte MSG_TEMPLATE_EXPORT = 0x29; // 导出全部指纹模板，结束时返回结果和模板数量
+        public const byte MSG_TEMPLATE_DATA = 0x2A; // 导出的模板数据块 [id, flags, data]
+        public const byte MSG_TEMPLATE_IMPORT = 0x2B; // 导入模板数据块 [id, flags, data]，每块返回结果
+        public const byte MSG_SET_SENSOR_POWER = 0x2C; // 设置休眠时指纹模组供电策略
+        public const byte MSG_TRACE_STATS = 0x2D; // 读取模组指令耗时统计 [flags]，结束时返回结果和指令数量
+        public const byte MSG_TRACE_DATA = 0x2E; // 单个指令的耗时统计 MsgTraceHistogram
+        public const byte MSG_SET_REARM_INTERVAL = 0x2F; // 设置比对结束后重新接受触摸的最小间隔（毫秒）
+        public const byte MSG_IMAGE_UPLOAD = 0x30; // 诊断：采图并上传原始图像 [flags]，结束时返回 MsgImageResult
+        public const byte MSG_IMAGE_DATA = 0x31; // 原始图像数据块 [序号, data]
+        public const byte MSG_TX_BENCHMARK = 0x32; // 通知发送吞吐量测试 [数量高, 数量低, 长度]，结束时返回 MsgTxBenchmark
+        public const byte MSG_TX_BENCHMARK_DATA = 0x33; // 吞吐量测试数据 [序号高, 序号低, 填充]
+        public const byte MSG_BULK_OPEN = 0x34; // 打开批量数据通道，返回 [结果, 初始额度]
+        public const byte MSG_BULK_CREDIT = 0x35; // 批量数据通道归还的额度 [额度]
+        public const byte MSG_FRAGMENT = 0xF0; // 长消息分片 [flags, 序号, 原消息的一段]
+
+        public const byte TRACE_FLAG_RESET = 0x01; //读取后清除统计
+
+        public const byte IMAGE_FLAG_RLE = 0x01; //图像数据按 PackBits 压缩
+
+        public const byte FRAGMENT_FLAG_FIRST = 0x01; //消息的第一个分片
+        public const byte FRAGMENT_FLAG_LAST = 0x02; //消息的最后一个分片
+        public const int MAX_MESSAGE_SIZE = 2048; //分片传输的单条消息最大数据长度
+        public const int MAX_WRITE_SIZE = 200; //设备没有返回链路参数时单次写入的最大长度，超过时分片发送
+        public const int BULK_OPEN_TIMEOUT_MS = 2000; //等待设备打开批量通道的时间，旧固件不应答
+        public const int BULK_CREDIT_TIMEOUT_MS = 3000; //批量通道等待设备归还额度的最长时间
+
+        public const byte TEMPLATE_FLAG_FIRST = 0x01; //模板的第一块
+        public const byte TEMPLATE_FLAG_LAST = 0x02; //模板的最后一块
+        public const int TEMPLATE_CHUNK_SIZE = 240; //模板数据块最大长度
+
+        public const byte MATCH_MODE_SEARCH = 0x00; //分步搜索（采图、生成特征、搜索）
+        public const byte MATCH_MODE_AUTO_IDENTIFY = 0x01; //自动验证（一条指令完成）
+
+        public const byte SENSOR_POWER_OFF = 0x00; //休眠时模组断电
+        public const byte SENSOR_POWER_SLEEP = 0x01; //休眠时模组进入低功耗休眠，唤醒更快
 
         public const byte MAX_FINGER_NAME_LENGTH = 32; //指纹名称最大长度
 
@@ -0,0 +1,101 @@
+using System;
+using System.Collections.Generic;
+using System.IO;
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+namespace SparkinLib.Bluetooth
+{
+    /// <summary>
+    /// 长消息分片和重组，与固件格式相同：MSG_FRAGMENT 的数据为 [flags, 序号, 原消息的一段]
+    /// </summary>
+    public class MessageFragmenter
+    {
+        private readonly MemoryStream buffer = new MemoryStream();
+        private bool active;
+        private byte nextSequence;
+        private byte sendSequence;
+
+        /// <summary>
+        /// 最近一次丢弃的原因，没有丢弃时为 null
+        /// </summary>
+        public string LastError { get; private set; }
+
+        /// <summary>
+        /// 把一条 [类型, data] 的命令切成每条不超过 writeSize 字节的分片写入
+        /// </summary>
+        public List<byte[]> Split(byte[] message, int writeSize)
+        {
+            int chunkSize = writeSize - 3;
+            List<byte[]> fragments = new List<byte[]>();
+            for (int offset = 0; offset < message.Length; offset += chunkSize)
+            {
+                int length = Math.Min(chunkSize, message.Length - offset);
+                byte flags = 0;
+                if (offset == 0)
+                    flags |= CmdMessage.FRAGMENT_FLAG_FIRST;
+                if (offset + length >= message.Length)
+                    flags |= CmdMessage.FRAGMENT_FLAG_LAST;
+
+                byte[] fragment = new byte[3 + length];
+                fragment[0] = CmdMessage.MSG_FRAGMENT;
+                fragment[1] = flags;
+                fragment[2] = sendSequence++;
+                Array.Copy(message, offset, fragment, 3, length);
+                fragments.Add(fragment);
+            }
+            return fragments;
+        }
+
+        /// <summary>
+        /// 处理收到的一条分片通知 [0xF0, 长度高, 长度低, flags, 序号, data]，
+        /// 收到最后一片时返回重组的 [类型, 长度高, 长度低, data]，否则返回 null
+        /// </summary>
+        public byte[] Receive(byte[] notification)
+        {
+            LastError = null;
+            if (notification.Length < 5)
+                return null;
+            byte flags = notification[3];
+            byte sequence = notification[4];
+
+            if ((flags & CmdMessage.FRAGMENT_FLAG_FIRST) != 0)
+            {
+                if (active)
+                    LastError = $"未完成的消息被丢弃，已收到 {buffer.Length} 字节";
+                active = true;
+                buffer.SetLength(0);
+            }
+            else if (!active || sequence != nextSequence)
+            {
+                LastError = $"分片序号 {sequence} 不连续，应为 {nextSequence}";
+                active = false;
+                return null;
+            }
+            if (buffer.Length + notification.Length - 5 > CmdMessage.MAX_MESSAGE_SIZE + 3)
+            {
+                LastError = "消息超过最大长度";
+                active = false;
+                return null;
+            }
+            buffer.Write(notification, 5, notification.Length - 5);
+            nextSequence = (byte)(sequence + 1);
+
+            if ((flags & CmdMessage.FRAGMENT_FLAG_LAST) == 0)
+                return null;
+            active = false;
+            return buffer.ToArray();
+        }
+
+        /// <summary>
+        /// 断开连接时丢弃未完成的消息
+        /// </summary>
+        public void Reset()
+        {
+            active = false;
+            buffer.SetLength(0);
+        }
+    }
+}
@@ -0,0 +1,28 @@
+using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Runtime.InteropServices;
+using System.Text;
+using System.Threading.Tasks;
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+namespace SparkinLib.Structs
+{
+    [StructLayout(LayoutKind.Sequential, Pack = 1)]
+    public struct MsgImageResult
+    {
+        public byte result;         // MSG_CMD_SUCCESS / MSG_CMD_FAILURE
+        public byte flags;          // 数据块的格式（IMAGE_FLAG_RLE）
+        public byte captureCode;    // 采图确认码
+        public byte featureCode;    // 生成特征确认码，反映图像质量
+        public uint imageBytes;     // 原始图像长度
+        public uint sentBytes;      // 数据块中的数据总长度（压缩后）
+        public ushort chunks;       // 数据块数量
+        public ushort captureMs;    // 等待手指并采图的耗时
+        public ushort uploadMs;     // 模组上传图像的耗时
+        public ushort totalMs;      // 从收到请求到最后一块发出的耗时
+    }
+}
@@ -0,0 +1,27 @@
+using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Runtime.InteropServices;
+using System.Text;
+using System.Threading.Tasks;
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+namespace SparkinLib.Structs
+{
+    /// <summary>
+    /// 新固件在 MSG_GET_INFO 的 MsgInfo 之后附带的链路参数
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential, Pack = 1)]
+    public struct MsgLinkInfo
+    {
+        public ushort mtu;          // 协商的ATT MTU
+        public ushort maxPayload;   // 一条通知或一次写入的最大长度（MTU 减去ATT头）
+        public ushort txDataLength; // 链路层每包发送字节数（LE Data Length）
+        public ushort rxDataLength; // 链路层每包接收字节数
+        public ushort connInterval; // 当前连接间隔（1.25ms）
+        public ushort connLatency;  // 当前从机延迟
+    }
+}
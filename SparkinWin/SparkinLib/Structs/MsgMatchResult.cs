@@ -0,0 +1,27 @@
+using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Runtime.InteropServices;
+using System.Text;
+using System.Threading.Tasks;
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+namespace SparkinLib.Structs
+{
+    [StructLayout(LayoutKind.Sequential, Pack = 1)]
+    public struct MsgMatchResult
+    {
+        public byte result;         // 1：成功
+        public ushort templateId;   // 匹配的模板ID
+        public ushort score;        // 匹配得分
+        public byte attempts;       // 采图次数
+        public byte matchMode;      // 比对方式
+        public ushort captureMs;    // 采图耗时
+        public ushort extractMs;    // 生成特征耗时
+        public ushort searchMs;     // 搜索耗时
+        public ushort totalMs;      // 比对总耗时
+    }
+}
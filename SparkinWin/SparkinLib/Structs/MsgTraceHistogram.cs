@@ -0,0 +1,26 @@
+using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Runtime.InteropServices;
+using System.Text;
+using System.Threading.Tasks;
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+namespace SparkinLib.Structs
+{
+    [StructLayout(LayoutKind.Sequential, Pack = 1)]
+    public struct MsgTraceHistogram
+    {
+        public byte cmd;            // 模组指令码
+        public uint count;          // 指令次数
+        public uint timeouts;       // 没有应答的次数
+        public uint errors;         // 确认码不为0的次数
+        public uint totalMs;        // 累计耗时
+        public uint maxMs;          // 最大耗时
+        [MarshalAs(UnmanagedType.ByValArray, SizeConst = 12)]
+        public ushort[] buckets;    // 按毫秒对数分桶：<1 <2 <4 ... <1024 >=1024
+    }
+}
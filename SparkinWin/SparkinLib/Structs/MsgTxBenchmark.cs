@@ -0,0 +1,27 @@
+using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Runtime.InteropServices;
+using System.Text;
+using System.Threading.Tasks;
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+namespace SparkinLib.Structs
+{
+    [StructLayout(LayoutKind.Sequential, Pack = 1)]
+    public struct MsgTxBenchmark
+    {
+        public byte result;         // MSG_CMD_SUCCESS / MSG_CMD_FAILURE
+        public ushort count;        // 成功入队的消息数量
+        public uint bytes;          // 发出的总字节数（含消息头）
+        public uint elapsedMs;      // 从第一条入队到全部发出的耗时
+        public uint messagesPerSec;
+        public uint bytesPerSec;
+        public uint queueFull;      // 入队时发送队列已满的次数
+        public uint congested;      // 协议栈拥塞次数
+        public uint confirmTimeouts; // 等待协议栈确认超时的次数
+    }
+}
@@ -0,0 +1,117 @@
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+/*
+ * Copyright (c) 2026 Tomosawa
+ * https://github.com/Tomosawa/
+ * All rights reserved
+ */
+namespace SparkinLib.Tools
+{
+    /// <summary>
+    /// 拼接设备上传的指纹原始图像数据块，解压后保存为灰度图，用于诊断采图质量
+    /// 模组图像每像素4位，一个字节两个像素（高4位在前），图像为正方形
+    /// </summary>
+    public class FingerprintImageAssembler
+    {
+        private static readonly string FolderImagePath = Path.Combine(
+            Environment.GetFolderPath(Environment.SpecialFolder.CommonApplicationData), "Sparkin", "Images");
+
+        private readonly MemoryStream data = new MemoryStream();
+        private int nextSequence;
+
+        /// <summary>
+        /// 丢失或重复的数据块数量
+        /// </summary>
+        public int MissingChunks { get; private set; }
+
+        /// <summary>
+        /// 已收到的数据长度（压缩后）
+        /// </summary>
+        public long ReceivedBytes => data.Length;
+
+        /// <summary>
+        /// 开始接收新的图像
+        /// </summary>
+        public void Reset()
+        {
+            data.SetLength(0);
+            nextSequence = 0;
+            MissingChunks = 0;
+        }
+
+        /// <summary>
+        /// 添加一个数据块，chunk 为 [序号, data]
+        /// </summary>
+        public void AddChunk(byte[] chunk, int offset, int length)
+        {
+            if (length < 1)
+                return;
+            byte sequence = chunk[offset];
+            if (sequence != (byte)nextSequence)
+                MissingChunks++;
+            nextSequence = sequence + 1;
+            data.Write(chunk, offset + 1, length - 1);
+        }
+
+        /// <summary>
+        /// 按上传标志解压数据并保存为 PGM 灰度图，返回文件路径；数据不完整时返回 null
+        /// </summary>
+        public string Save(byte flags, uint imageBytes)
+        {
+            byte[] packed = data.ToArray();
+            byte[] image = (flags & Bluetooth.CmdMessage.IMAGE_FLAG_RLE) != 0 ? UnpackBits(packed) : packed;
+            if (image.Length == 0 || image.Length != imageBytes || MissingChunks > 0)
+                return null;
+
+            int size = (int)Math.Round(Math.Sqrt(image.Length * 2.0));
+            if (size * size != image.Length * 2)
+                return null;
+
+            Directory.CreateDirectory(FolderImagePath);
+            string path = Path.Combine(FolderImagePath, $"fp_{DateTime.Now:yyyyMMdd_HHmmss}.pgm");
+            using (FileStream file = new FileStream(path, FileMode.Create, FileAccess.Write))
+            {
+                byte[] header = Encoding.ASCII.GetBytes($"P5\n{size} {size}\n255\n");
+                file.Write(header, 0, header.Length);
+                byte[] pixels = new byte[image.Length * 2];
+                for (int i = 0; i < image.Length; i++)
+                {
+                    // 4位灰度扩展到8位
+                    pixels[i * 2] = (byte)((image[i] >> 4) * 0x11);
+                    pixels[i * 2 + 1] = (byte)((image[i] & 0x0F) * 0x11);
+                }
+                file.Write(pixels, 0, pixels.Length);
+            }
+            return path;
+        }
+
+        /// <summary>
+        /// PackBits 解压：控制字节 0~127 后跟 n+1 个原样字节，-1~-127 表示下一个字节重复 1-n 次
+        /// </summary>
+        public static byte[] UnpackBits(byte[] packed)
+        {
+            List<byte> output = new List<byte>(packed.Length * 2);
+            int i = 0;
+            while (i < packed.Length)
+            {
+                sbyte control = (sbyte)packed[i++];
+                if (control >= 0)
+                {
+                    int count = Math.Min(control + 1, packed.Length - i);
+                    for (int j = 0; j < count; j++)
+                        output.Add(packed[i + j]);
+                    i += count;
+                }
+                else if (control != -128 && i < packed.Length)
+                {
+                    for (int j = 0; j < 1 - control; j++)
+                        output.Add(packed[i]);
+                    i++;
+                }
+            }
+            return output.ToArray();
+        }
+    }
+}
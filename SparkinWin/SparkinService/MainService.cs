@@ -2,9 +2,11 @@
 using NLog;
 using SparkinLib;
 using SparkinLib.Bluetooth;
+using SparkinLib.Structs;
 using SparkinLib.Tools;
 using System;
 using System.Linq;
+using System.Runtime.InteropServices;
 using System.ServiceProcess;
 using System.Threading.Tasks;
 /*
@@ -23,6 +25,15 @@ namespace SparkinService
         private PipeServer pipeServer;
         // 配置文件
         private ConfigFile configFile = null;
+        // 诊断图像拼接
+        private FingerprintImageAssembler imageAssembler = new FingerprintImageAssembler();
+        // 吞吐量测试接收统计
+        private int benchmarkReceived = 0;
+        private long benchmarkBytes = 0;
+        private int benchmarkMissing = 0;
+        private int benchmarkNextSeq = 0;
+        private DateTime benchmarkFirst;
+        private DateTime benchmarkLast;
         // 日志记录器
         private Logger log = LogUtil.GetLogger();
 
@@ -220,6 +231,13 @@ namespace SparkinService
                 {
                     case CmdMessage.MSG_FINGERPRINT_SEARCH:
                         log.Info("[BT_DataReceived]收到解锁屏幕请求");
+                        // 新固件在消息中附带比对结果
+                        if (data.Length >= 3 + Marshal.SizeOf(typeof(MsgMatchResult)))
+                        {
+                            MsgMatchResult match = StructConverter.ByteArrayToStructure<MsgMatchResult>(data, 3);
+                            log.Info($"[BT_DataReceived]比对结果：ID={match.templateId} 得分={match.score} 采图次数={match.attempts} 模式={match.matchMode} " +
+                                $"采图={match.captureMs}ms 特征={match.extractMs}ms 搜索={match.searchMs}ms 总计={match.totalMs}ms");
+                        }
 
                         // 解锁屏幕
                         if (!string.IsNullOrEmpty(configFile.LoginUserName) && !string.IsNullOrEmpty(configFile.LoginPassword))
@@ -228,6 +246,69 @@ namespace SparkinService
                         }
                         break;
                         
+                    case CmdMessage.MSG_TRACE_DATA:
+                        if (data.Length >= 3 + Marshal.SizeOf(typeof(MsgTraceHistogram)))
+                        {
+                            MsgTraceHistogram trace = StructConverter.ByteArrayToStructure<MsgTraceHistogram>(data, 3);
+                            log.Info($"[BT_DataReceived]指令0x{trace.cmd:X2}耗时：次数={trace.count} 超时={trace.timeouts} 错误={trace.errors} " +
+                                $"平均={(trace.count > 0 ? trace.totalMs / trace.count : 0)}ms 最大={trace.maxMs}ms 分布=[{string.Join(",", trace.buckets)}]");
+                        }
+                        break;
+
+                    case CmdMessage.MSG_TRACE_STATS:
+                        log.Info($"[BT_DataReceived]耗时统计读取完成，结果=0x{(data.Length > 3 ? data[3] : 0):X2} 指令数={(data.Length > 4 ? data[4] : 0)}");
+                        break;
+
+                    case CmdMessage.MSG_IMAGE_DATA:
+                        imageAssembler.AddChunk(data, 3, data.Length - 3);
+                        break;
+
+                    case CmdMessage.MSG_IMAGE_UPLOAD:
+                        if (data.Length >= 3 + Marshal.SizeOf(typeof(MsgImageResult)))
+                        {
+                            MsgImageResult image = StructConverter.ByteArrayToStructure<MsgImageResult>(data, 3);
+                            string imagePath = image.result == CmdMessage.MSG_CMD_SUCCESS ? imageAssembler.Save(image.flags, image.imageBytes) : null;
+                            log.Info($"[BT_DataReceived]图像上传完成，结果=0x{image.result:X2} 采图=0x{image.captureCode:X2} 特征=0x{image.featureCode:X2} " +
+                                $"图像={image.imageBytes}字节 传输={image.sentBytes}字节/{image.chunks}块 收到={imageAssembler.ReceivedBytes}字节 丢块={imageAssembler.MissingChunks} " +
+                                $"采图={image.captureMs}ms 上传={image.uploadMs}ms 总计={image.totalMs}ms 文件={imagePath ?? "无"}");
+                        }
+                        imageAssembler.Reset();
+                        break;
+
+                    case CmdMessage.MSG_TX_BENCHMARK_DATA:
+                        if (data.Length >= 5)
+                        {
+                            int seq = (data[3] << 8) | data[4];
+                            if (benchmarkReceived == 0)
+                                benchmarkFirst = DateTime.Now;
+                            else if (seq != benchmarkNextSeq)
+                                benchmarkMissing++;
+                            benchmarkNextSeq = seq + 1;
+                            benchmarkLast = DateTime.Now;
+                            benchmarkReceived++;
+                            benchmarkBytes += data.Length;
+                        }
+                        break;
+
+                    case CmdMessage.MSG_TX_BENCHMARK:
+                        if (data.Length >= 3 + Marshal.SizeOf(typeof(MsgTxBenchmark)))
+                        {
+                            MsgTxBenchmark bench = StructConverter.ByteArrayToStructure<MsgTxBenchmark>(data, 3);
+                            double seconds = (benchmarkLast - benchmarkFirst).TotalSeconds;
+                            log.Info($"[BT_DataReceived]吞吐量测试完成，结果=0x{bench.result:X2} 设备端：{bench.count}条/{bench.bytes}字节/{bench.elapsedMs}ms " +
+                                $"{bench.messagesPerSec}条/秒 {bench.bytesPerSec}字节/秒 队列满={bench.queueFull} 拥塞={bench.congested} 确认超时={bench.confirmTimeouts}；" +
+                                $"接收端：{benchmarkReceived}条/{benchmarkBytes}字节 丢失={benchmarkMissing} " +
+                                $"{(seconds > 0 ? benchmarkReceived / seconds : 0):F0}条/秒 {(seconds > 0 ? benchmarkBytes / seconds : 0):F0}字节/秒");
+                        }
+                        else
+                        {
+                            log.Info($"[BT_DataReceived]吞吐量测试失败，结果=0x{(data.Length > 3 ? data[3] : 0):X2}");
+                        }
+                        benchmarkReceived = 0;
+                        benchmarkBytes = 0;
+                        benchmarkMissing = 0;
+                        break;
+
                     case CmdMessage.MSG_LOCKSCREEN_STATUS:
                         log.Info("[BT_DataReceived]收到锁屏状态请求");
                         
@@ -252,6 +333,16 @@ namespace SparkinService
                     case CmdMessage.MSG_FIRMWARE_UPDATE_START:
                     case CmdMessage.MSG_FIRMWARE_UPDATE_CHUNK:
                     case CmdMessage.MSG_FIRMWARE_UPDATE_END:
+                        // 新固件在设备信息后附带协商的链路参数，按此确定单次写入长度
+                        if (header.cmd == CmdMessage.MSG_GET_INFO &&
+                            data.Length >= 3 + Marshal.SizeOf(typeof(MsgInfo)) + Marshal.SizeOf(typeof(MsgLinkInfo)))
+                        {
+                            MsgLinkInfo link = StructConverter.ByteArrayToStructure<MsgLinkInfo>(data, 3 + Marshal.SizeOf(typeof(MsgInfo)));
+                            log.Info($"[BT_DataReceived]链路参数：MTU={link.mtu} 最大载荷={link.maxPayload} 链路层包长={link.txDataLength}/{link.rxDataLength} 连接间隔={link.connInterval * 1.25}ms 从机延迟={link.connLatency}");
+                            if (link.maxPayload >= 20)
+                                bluetoothManager.MaxWriteSize = link.maxPayload;
+                        }
+
                         // 将这些数据转发给客户端
                         if (pipeServer != null)
                         {
@@ -496,7 +587,17 @@ namespace SparkinService
                             {
                                 Task.Run(async () =>
                                 {
-                                    await bluetoothManager.SendFirmwareUpdateChunkAsync(message.Data);
+                                    bool bulk = bluetoothManager.BulkChannelOpen;
+                                    bool sent = await bluetoothManager.SendFirmwareUpdateChunkAsync(message.Data);
+                                    // 批量通道中的数据块设备不逐块应答，写入成功后代为应答，客户端继续发送下一块
+                                    if (bulk && sent && pipeServer != null)
+                                    {
+                                        pipeServer.SendMessage(new PipeMessage
+                                        {
+                                            Type = PipeMessage.MessageType.BluetoothDataReceived,
+                                            Data = new byte[] { CmdMessage.MSG_FIRMWARE_UPDATE_CHUNK, 0x00, 0x01, CmdMessage.MSG_CMD_SUCCESS }
+                                        });
+                                    }
                                 });
                             }
                             break;